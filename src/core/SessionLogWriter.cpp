@@ -0,0 +1,774 @@
+#include "SessionLogWriter.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMap>
+#include <QRegularExpression>
+#include <QThread>
+
+#include <condition_variable>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef QSHELL_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef QSHELL_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <chrono>
+#include <utility>
+
+struct SessionLogWriter::Record {
+    enum Type { Open, Data, Lines, Close, Stop };
+
+    std::atomic<Record *> next{nullptr};
+    Type type = Data;
+    quint64 id = 0;
+    QFile *file = nullptr;
+    QString filePath;
+    Rotation rotation;
+    int segment = 0;
+    QByteArray data;     // Data 的内容，Open 的日志头或 Close 的日志尾
+    QStringList lines;
+    qint64 msecs = 0;
+    bool timestamp = false;
+    qint64 cost = 0;     // 计入内存上限的字节数
+    qint64 dropped = 0;  // 这条记录之前丢弃的字节数
+};
+
+struct SessionLogWriter::LogFile {
+    QFile *file = nullptr;
+    QByteArray buffer;
+    qint64 bufferCost = 0;  // 缓冲中的记录计入内存上限的字节数
+    qint64 lastFlush = 0;
+    qint64 lastWrite = 0;
+    qint64 lastSync = 0;
+    bool unsynced = false;
+    bool failed = false;
+
+    // 轮转状态，filePath 是打开时传入的路径
+    QString filePath;
+    Rotation rotation;
+    int segment = 0;
+    qint64 segmentBytes = 0;
+    qint64 segmentStart = 0;
+};
+
+namespace {
+const QIODevice::OpenMode LOG_OPEN_MODE =
+    QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text | QIODevice::Unbuffered;
+const int COMPRESS_CHUNK_SIZE = 256 * 1024;
+
+// 文本转成 UTF-8 后的字节数，省得在 GUI 线程真正转一遍
+qint64 utf8Length(const QString &text) {
+    qint64 length = 0;
+    for (const QChar c : text) {
+        const char16_t unit = c.unicode();
+        if (unit < 0x80) {
+            length += 1;
+        } else if (unit < 0x800) {
+            length += 2;
+        } else if (c.isSurrogate()) {
+            // 代理对共 4 字节，孤立的代理转成 3 字节的替换字符，按 2 字节估算即可
+            length += 2;
+        } else {
+            length += 3;
+        }
+    }
+    return length;
+}
+
+QString segmentStem(const QString &filePath) {
+    const QFileInfo info(filePath);
+    return info.suffix() == "log" ? info.completeBaseName() : info.fileName();
+}
+
+// filePath 已有的分段，序号 -> 文件（压缩前后的文件可能同时存在）
+QMap<int, QStringList> existingSegments(const QString &filePath) {
+    const QFileInfo info(filePath);
+    const QString stem = segmentStem(filePath);
+    const QRegularExpression pattern(
+        "^" + QRegularExpression::escape(stem) + R"(\.(\d+)\.log(\.gz|\.zst)?$)");
+
+    QMap<int, QStringList> segments;
+    const QDir dir = info.dir();
+    const QStringList names = dir.entryList({stem + ".*.log*"}, QDir::Files);
+    for (const QString &name : names) {
+        const QRegularExpressionMatch match = pattern.match(name);
+        if (match.hasMatch()) {
+            segments[match.captured(1).toInt()].append(dir.filePath(name));
+        }
+    }
+    return segments;
+}
+
+#ifdef QSHELL_HAVE_ZLIB
+bool gzipFile(QFile &in, QFile &out) {
+    z_stream stream = {};
+    // windowBits 加 16 输出 gzip 格式
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+
+    QByteArray input(COMPRESS_CHUNK_SIZE, Qt::Uninitialized);
+    QByteArray output(COMPRESS_CHUNK_SIZE, Qt::Uninitialized);
+    bool ok = true;
+    int mode = Z_NO_FLUSH;
+    while (ok && mode != Z_FINISH) {
+        const qint64 len = in.read(input.data(), input.size());
+        if (len < 0) {
+            ok = false;
+            break;
+        }
+        mode = len < input.size() ? Z_FINISH : Z_NO_FLUSH;
+        stream.next_in = reinterpret_cast<Bytef *>(input.data());
+        stream.avail_in = static_cast<uInt>(len);
+        do {
+            stream.next_out = reinterpret_cast<Bytef *>(output.data());
+            stream.avail_out = static_cast<uInt>(output.size());
+            deflate(&stream, mode);
+            const qint64 have = output.size() - stream.avail_out;
+            if (out.write(output.constData(), have) != have) {
+                ok = false;
+                break;
+            }
+        } while (stream.avail_out == 0);
+    }
+    deflateEnd(&stream);
+    return ok;
+}
+#endif
+
+#ifdef QSHELL_HAVE_ZSTD
+bool zstdFile(QFile &in, QFile &out) {
+    ZSTD_CCtx *context = ZSTD_createCCtx();
+    if (!context) {
+        return false;
+    }
+
+    QByteArray input(static_cast<qsizetype>(ZSTD_CStreamInSize()), Qt::Uninitialized);
+    QByteArray output(static_cast<qsizetype>(ZSTD_CStreamOutSize()), Qt::Uninitialized);
+    bool ok = true;
+    bool last = false;
+    while (ok && !last) {
+        const qint64 len = in.read(input.data(), input.size());
+        if (len < 0) {
+            ok = false;
+            break;
+        }
+        last = len < input.size();
+        const ZSTD_EndDirective mode = last ? ZSTD_e_end : ZSTD_e_continue;
+        ZSTD_inBuffer inBuffer = {input.constData(), static_cast<size_t>(len), 0};
+        bool done = false;
+        while (ok && !done) {
+            ZSTD_outBuffer outBuffer = {output.data(), static_cast<size_t>(output.size()), 0};
+            const size_t remaining = ZSTD_compressStream2(context, &outBuffer, &inBuffer, mode);
+            if (ZSTD_isError(remaining)
+                || out.write(output.constData(), static_cast<qint64>(outBuffer.pos)) != static_cast<qint64>(outBuffer.pos)) {
+                ok = false;
+                break;
+            }
+            done = last ? remaining == 0 : inBuffer.pos == inBuffer.size;
+        }
+    }
+    ZSTD_freeCCtx(context);
+    return ok;
+}
+#endif
+
+// 把写完的分段压缩到 <分段>.gz / <分段>.zst，成功后删除原文件
+void compressSegment(const QString &source, SessionLogWriter::Compression compression) {
+    const QString target = source + (compression == SessionLogWriter::Gzip ? ".gz" : ".zst");
+    const QString temp = target + ".tmp";
+
+    QFile in(source);
+    QFile out(temp);
+    if (!in.open(QIODevice::ReadOnly) || !out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Failed to compress log" << source << in.errorString() << out.errorString();
+        return;
+    }
+
+    bool ok = false;
+    switch (compression) {
+#ifdef QSHELL_HAVE_ZLIB
+    case SessionLogWriter::Gzip:
+        ok = gzipFile(in, out);
+        break;
+#endif
+#ifdef QSHELL_HAVE_ZSTD
+    case SessionLogWriter::Zstd:
+        ok = zstdFile(in, out);
+        break;
+#endif
+    default:
+        break;
+    }
+    in.close();
+    out.close();
+
+    if (!ok) {
+        qWarning() << "Failed to compress log" << source;
+        QFile::remove(temp);
+        return;
+    }
+    // 压缩期间分段可能已被保留策略删除，这时压缩结果也不要了
+    if (!QFile::remove(source)) {
+        QFile::remove(temp);
+        return;
+    }
+    QFile::remove(target);
+    QFile::rename(temp, target);
+}
+}
+
+// 一个写线程和它的队列，负责 id 落在它上面的所有日志文件
+class SessionLogWriter::Worker {
+public:
+    Worker(SessionLogWriter *writer, int index);
+    ~Worker();
+
+    void push(Record *record);
+
+private:
+    void enqueue(Record *record);
+    Record *pop();
+
+    void run();
+    bool drain();
+    void handle(Record *record);
+    void appendTimestamp(QByteArray &buffer, qint64 msecs);
+    void flush(LogFile &file, qint64 now);
+    void sync(LogFile &file, qint64 now);
+    void rotate(LogFile &file, qint64 now);
+    void removeOldSegments(const LogFile &file);
+    void closeFile(LogFile *file, qint64 now);
+
+    SessionLogWriter *writer_;
+    QThread *thread_ = nullptr;
+
+    // 多生产者单消费者的无锁队列，head_ 由生产者交换，tail_ 只在写线程访问
+    std::atomic<Record *> head_;
+    Record *tail_ = nullptr;
+    Record *stub_ = nullptr;
+
+    // 只用于写线程空闲时的休眠和唤醒，入队本身不加锁
+    std::atomic<bool> wakePending_{false};
+    std::mutex wakeMutex_;
+    std::condition_variable wakeCondition_;
+
+    // 以下只在写线程访问
+    QHash<quint64, LogFile *> files_;
+    QElapsedTimer clock_;
+    qint64 timestampSecond_ = -1;
+    QByteArray timestampPrefix_;
+};
+
+SessionLogWriter *SessionLogWriter::instance() {
+    static SessionLogWriter *instance = nullptr;
+    if (!instance) {
+        instance = new SessionLogWriter();
+        // QApplication 析构时（所有终端都已关闭日志之后）写完剩余数据再退出
+        qAddPostRoutine([]() {
+            delete instance;
+            instance = nullptr;
+        });
+    }
+    return instance;
+}
+
+SessionLogWriter::SessionLogWriter() {
+    // 写日志主要在等磁盘，少量线程就能承担所有会话
+    const int workerCount = qBound(1, QThread::idealThreadCount() / 4, 4);
+    for (int i = 0; i < workerCount; i++) {
+        workers_.append(new Worker(this, i));
+    }
+    compressPool_.setMaxThreadCount(1);
+}
+
+SessionLogWriter::~SessionLogWriter() {
+    qDeleteAll(workers_);
+    workers_.clear();
+    // 关闭时提交的压缩做完再退出
+    compressPool_.waitForDone();
+}
+
+bool SessionLogWriter::isCompressionSupported(Compression compression) {
+    switch (compression) {
+    case NoCompression:
+        return true;
+    case Gzip:
+#ifdef QSHELL_HAVE_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    case Zstd:
+#ifdef QSHELL_HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+QString SessionLogWriter::segmentPath(const QString &filePath, int segment) {
+    const QFileInfo info(filePath);
+    return info.dir().filePath(QString("%1.%2.log").arg(segmentStem(filePath)).arg(segment));
+}
+
+quint64 SessionLogWriter::open(const QString &filePath, const Rotation &rotation, QString *errorString,
+                               const QByteArray &header) {
+    Rotation effectiveRotation = rotation;
+    if (!isCompressionSupported(effectiveRotation.compression)) {
+        qWarning() << "Log compression" << effectiveRotation.compression << "is not available in this build";
+        effectiveRotation.compression = NoCompression;
+    }
+
+    // 轮转时接着最后一个分段写，它已经压缩过就开新分段
+    QString path = filePath;
+    int segment = 0;
+    if (effectiveRotation.enabled()) {
+        const QMap<int, QStringList> segments = existingSegments(filePath);
+        segment = segments.isEmpty() ? 1 : segments.lastKey();
+        if (!segments.isEmpty() && !segments.last().contains(segmentPath(filePath, segment))) {
+            segment++;
+        }
+        path = segmentPath(filePath, segment);
+    }
+
+    auto *file = new QFile(path);
+    // 缓冲由写线程自己管理，QFile 不再多拷贝一次
+    if (!file->open(LOG_OPEN_MODE)) {
+        if (errorString) {
+            *errorString = file->errorString();
+        }
+        delete file;
+        return 0;
+    }
+    // 之后只在写线程使用
+    file->moveToThread(nullptr);
+
+    auto *record = new Record();
+    record->type = Record::Open;
+    record->id = nextId_++;
+    record->file = file;
+    record->filePath = filePath;
+    record->rotation = effectiveRotation;
+    record->segment = segment;
+    // 日志头不计入内存上限
+    record->data = header;
+    const quint64 id = record->id;
+    push(record);
+    return id;
+}
+
+void SessionLogWriter::write(quint64 id, const QByteArray &data) {
+    if (id == 0 || data.isEmpty() || !reserve(id, data.size())) {
+        return;
+    }
+    auto *record = new Record();
+    record->type = Record::Data;
+    record->id = id;
+    record->data = data;
+    record->cost = data.size();
+    push(record);
+}
+
+void SessionLogWriter::writeLines(quint64 id, const QStringList &lines, bool timestamp) {
+    if (id == 0 || lines.isEmpty()) {
+        return;
+    }
+    // 换行 1 字节，时间戳 "[yyyy-MM-dd HH:mm:ss.zzz] " 26 字节
+    qint64 cost = 0;
+    for (const QString &line : lines) {
+        cost += utf8Length(line) + 1 + (timestamp ? 26 : 0);
+    }
+    if (!reserve(id, cost)) {
+        return;
+    }
+
+    auto *record = new Record();
+    record->type = Record::Lines;
+    record->id = id;
+    record->lines = lines;
+    record->timestamp = timestamp;
+    record->cost = cost;
+    if (timestamp) {
+        // 同一批行共用一个时间戳，格式化留给写线程
+        record->msecs = QDateTime::currentMSecsSinceEpoch();
+    }
+    push(record);
+}
+
+void SessionLogWriter::close(quint64 id, const QByteArray &footer) {
+    if (id == 0) {
+        return;
+    }
+    auto *record = new Record();
+    record->type = Record::Close;
+    record->id = id;
+    // 日志尾不计入内存上限
+    record->data = footer;
+    push(record);
+}
+
+void SessionLogWriter::setFsyncInterval(int seconds) {
+    fsyncIntervalMs_ = qMax(0, seconds) * 1000;
+}
+
+qint64 SessionLogWriter::pendingBytes() const {
+    return pendingBytes_;
+}
+
+qint64 SessionLogWriter::droppedBytes() const {
+    return droppedBytes_;
+}
+
+bool SessionLogWriter::reserve(quint64 id, qint64 cost) {
+    if (pendingBytes_.fetch_add(cost) + cost <= MAX_PENDING_BYTES) {
+        return true;
+    }
+    pendingBytes_ -= cost;
+    droppedBytes_ += cost;
+
+    std::lock_guard<std::mutex> locker(droppedMutex_);
+    dropped_[id] += cost;
+    hasDropped_ = true;
+    return false;
+}
+
+void SessionLogWriter::push(Record *record) {
+    // 丢过数据的会话，把丢弃的字节数带给下一条能写的记录
+    if (hasDropped_ && (record->type == Record::Data || record->type == Record::Lines || record->type == Record::Close)) {
+        std::lock_guard<std::mutex> locker(droppedMutex_);
+        record->dropped = dropped_.take(record->id);
+        hasDropped_ = !dropped_.isEmpty();
+    }
+    workers_.at(static_cast<int>(record->id % workers_.size()))->push(record);
+}
+
+void SessionLogWriter::release(qint64 cost) {
+    pendingBytes_ -= cost;
+}
+
+void SessionLogWriter::compressLater(const QString &path, Compression compression) {
+    compressPool_.start([path, compression]() {
+        compressSegment(path, compression);
+    });
+}
+
+SessionLogWriter::Worker::Worker(SessionLogWriter *writer, int index)
+    : writer_(writer) {
+    stub_ = new Record();
+    head_.store(stub_);
+    tail_ = stub_;
+
+    thread_ = QThread::create([this]() {
+        run();
+    });
+    thread_->setObjectName(QString("session-log-%1").arg(index));
+    thread_->start(QThread::LowPriority);
+}
+
+SessionLogWriter::Worker::~Worker() {
+    auto *record = new Record();
+    record->type = Record::Stop;
+    push(record);
+    thread_->wait();
+    delete thread_;
+    delete stub_;
+}
+
+void SessionLogWriter::Worker::push(Record *record) {
+    enqueue(record);
+    // 写线程已被唤醒时不再重复通知
+    if (!wakePending_.exchange(true)) {
+        std::lock_guard<std::mutex> locker(wakeMutex_);
+        wakeCondition_.notify_one();
+    }
+}
+
+void SessionLogWriter::Worker::enqueue(Record *record) {
+    record->next.store(nullptr, std::memory_order_relaxed);
+    Record *previous = head_.exchange(record, std::memory_order_acq_rel);
+    previous->next.store(record, std::memory_order_release);
+}
+
+SessionLogWriter::Record *SessionLogWriter::Worker::pop() {
+    Record *tail = tail_;
+    Record *next = tail->next.load(std::memory_order_acquire);
+    if (tail == stub_) {
+        if (!next) {
+            return nullptr;
+        }
+        tail_ = next;
+        tail = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+    if (next) {
+        tail_ = next;
+        return tail;
+    }
+    if (tail != head_.load(std::memory_order_acquire)) {
+        // 生产者交换了 head_ 还没链上 next，它入队完成后会再唤醒写线程
+        return nullptr;
+    }
+    enqueue(stub_);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next) {
+        tail_ = next;
+        return tail;
+    }
+    return nullptr;
+}
+
+void SessionLogWriter::Worker::run() {
+    clock_.start();
+
+    bool stop = false;
+    while (!stop) {
+        wakePending_ = false;
+        stop = drain();
+
+        const qint64 now = clock_.elapsed();
+        const int fsyncInterval = writer_->fsyncIntervalMs_;
+        bool pending = false;
+        bool open = false;
+        for (LogFile *file : std::as_const(files_)) {
+            if (!file->buffer.isEmpty() && (stop || now - file->lastFlush >= FLUSH_INTERVAL_MS)) {
+                flush(*file, now);
+            }
+            if (file->unsynced && fsyncInterval > 0 && (stop || now - file->lastSync >= fsyncInterval)) {
+                sync(*file, now);
+            }
+            const bool dirty = !file->buffer.isEmpty() || (file->unsynced && fsyncInterval > 0);
+            // 长时间没有输出的会话先释放文件句柄
+            if (!dirty && file->file->isOpen() && now - file->lastWrite >= IDLE_CLOSE_MS) {
+                file->file->close();
+            }
+            pending = pending || dirty;
+            open = open || file->file->isOpen();
+        }
+        if (stop) {
+            break;
+        }
+
+        // 还有数据没写出时定时醒来，还有打开的文件时等它们空闲后关闭，否则一直睡到有新记录
+        std::unique_lock<std::mutex> locker(wakeMutex_);
+        auto woken = [this]() { return wakePending_.load(); };
+        if (pending) {
+            wakeCondition_.wait_for(locker, std::chrono::milliseconds(FLUSH_INTERVAL_MS / 4), woken);
+        } else if (open) {
+            wakeCondition_.wait_for(locker, std::chrono::milliseconds(IDLE_CLOSE_MS), woken);
+        } else {
+            wakeCondition_.wait(locker, woken);
+        }
+    }
+
+    const qint64 now = clock_.elapsed();
+    for (LogFile *file : std::as_const(files_)) {
+        closeFile(file, now);
+    }
+    files_.clear();
+}
+
+bool SessionLogWriter::Worker::drain() {
+    bool stop = false;
+    while (Record *record = pop()) {
+        if (record->type == Record::Stop) {
+            stop = true;
+        } else {
+            handle(record);
+        }
+        delete record;
+    }
+    return stop;
+}
+
+void SessionLogWriter::Worker::handle(Record *record) {
+    const qint64 now = clock_.elapsed();
+
+    if (record->type == Record::Open) {
+        auto *file = new LogFile();
+        file->file = record->file;
+        file->lastFlush = now;
+        file->lastWrite = now;
+        file->lastSync = now;
+        file->filePath = record->filePath;
+        file->rotation = record->rotation;
+        file->segment = record->segment;
+        file->segmentBytes = file->file->size();
+        file->segmentStart = now;
+        file->buffer = record->data;
+        files_.insert(record->id, file);
+        return;
+    }
+
+    LogFile *file = files_.value(record->id);
+    if (!file) {
+        writer_->release(record->cost);
+        return;
+    }
+
+    if (record->dropped > 0) {
+        file->buffer += QString("\n========== 磁盘写入跟不上，丢弃了约 %1 字节日志 ==========\n")
+            .arg(record->dropped).toUtf8();
+        qWarning() << "Dropped" << record->dropped << "bytes of log" << file->filePath;
+    }
+    file->bufferCost += record->cost;
+
+    switch (record->type) {
+    case Record::Data:
+        file->buffer += record->data;
+        break;
+    case Record::Lines:
+        for (const QString &line : std::as_const(record->lines)) {
+            if (record->timestamp) {
+                appendTimestamp(file->buffer, record->msecs);
+            }
+            file->buffer += line.toUtf8();
+            file->buffer += '\n';
+        }
+        break;
+    case Record::Close:
+        file->buffer += record->data;
+        files_.remove(record->id);
+        closeFile(file, now);
+        return;
+    default:
+        break;
+    }
+
+    if (file->buffer.size() >= FLUSH_BYTES) {
+        flush(*file, now);
+    }
+}
+
+void SessionLogWriter::Worker::appendTimestamp(QByteArray &buffer, qint64 msecs) {
+    // 同一秒内只格式化一次日期，毫秒直接拼数字
+    const qint64 second = msecs / 1000;
+    if (second != timestampSecond_) {
+        timestampSecond_ = second;
+        timestampPrefix_ = QDateTime::fromSecsSinceEpoch(second).toString("[yyyy-MM-dd HH:mm:ss.").toUtf8();
+    }
+    const int millisecond = static_cast<int>(msecs % 1000);
+    const char suffix[] = {
+        static_cast<char>('0' + millisecond / 100),
+        static_cast<char>('0' + millisecond / 10 % 10),
+        static_cast<char>('0' + millisecond % 10),
+        ']', ' '
+    };
+    buffer += timestampPrefix_;
+    buffer.append(suffix, sizeof(suffix));
+}
+
+void SessionLogWriter::Worker::flush(LogFile &file, qint64 now) {
+    file.lastFlush = now;
+    writer_->release(file.bufferCost);
+    file.bufferCost = 0;
+    if (file.buffer.isEmpty()) {
+        return;
+    }
+    file.lastWrite = now;
+
+    // 只在整批写出前轮转，分段里不会出现半行
+    const Rotation &rotation = file.rotation;
+    if (file.segmentBytes > 0
+        && ((rotation.maxBytes > 0 && file.segmentBytes + file.buffer.size() > rotation.maxBytes)
+            || (rotation.maxAgeMs > 0 && now - file.segmentStart >= rotation.maxAgeMs))) {
+        rotate(file, now);
+    }
+    // 空闲时关闭的文件在这里重新打开
+    if (!file.file->isOpen() && !file.file->open(LOG_OPEN_MODE) && !file.failed) {
+        file.failed = true;
+        qWarning() << "Failed to open log" << file.file->fileName() << file.file->errorString();
+    }
+
+    const qint64 written = file.file->write(file.buffer);
+    if (written < 0 && !file.failed) {
+        // 只报告一次，避免磁盘写满时刷屏
+        file.failed = true;
+        qWarning() << "Failed to write log" << file.file->fileName() << file.file->errorString();
+    }
+    file.segmentBytes += qMax<qint64>(0, written);
+    file.buffer.clear();
+    file.unsynced = true;
+}
+
+void SessionLogWriter::Worker::rotate(LogFile &file, qint64 now) {
+    if (writer_->fsyncIntervalMs_ > 0) {
+        sync(file, now);
+    }
+    file.file->close();
+    const QString closedPath = file.file->fileName();
+    delete file.file;
+    if (file.rotation.compression != NoCompression) {
+        writer_->compressLater(closedPath, file.rotation.compression);
+    }
+
+    file.segment++;
+    file.file = new QFile(segmentPath(file.filePath, file.segment));
+    if (!file.file->open(LOG_OPEN_MODE)) {
+        qWarning() << "Failed to open log" << file.file->fileName() << file.file->errorString();
+    }
+    file.failed = false;
+    file.unsynced = false;
+    file.segmentBytes = file.file->size();
+    file.segmentStart = now;
+    file.lastSync = now;
+
+    removeOldSegments(file);
+}
+
+void SessionLogWriter::Worker::removeOldSegments(const LogFile &file) {
+    if (file.rotation.maxSegments <= 0) {
+        return;
+    }
+    // 至少保留正在写的和刚写完（可能正在压缩）的分段
+    const int keep = qMax(2, file.rotation.maxSegments);
+    const QMap<int, QStringList> segments = existingSegments(file.filePath);
+    for (auto it = segments.cbegin(); it != segments.cend() && it.key() <= file.segment - keep; ++it) {
+        for (const QString &path : it.value()) {
+            QFile::remove(path);
+        }
+    }
+}
+
+void SessionLogWriter::Worker::closeFile(LogFile *file, qint64 now) {
+    flush(*file, now);
+    if (writer_->fsyncIntervalMs_ > 0) {
+        sync(*file, now);
+    }
+    file->file->close();
+    // 轮转的日志关闭后最后一个分段也压缩
+    if (file->rotation.enabled() && file->rotation.compression != NoCompression && file->segmentBytes > 0) {
+        writer_->compressLater(file->file->fileName(), file->rotation.compression);
+    }
+    delete file->file;
+    delete file;
+}
+
+void SessionLogWriter::Worker::sync(LogFile &file, qint64 now) {
+    file.lastSync = now;
+    if (!file.unsynced || !file.file->isOpen()) {
+        return;
+    }
+#if defined(Q_OS_WIN)
+    _commit(file.file->handle());
+#else
+    fsync(file.file->handle());
+#endif
+    file.unsynced = false;
+}
@@ -0,0 +1,100 @@
+#ifndef QSHELL_SESSION_LOG_WRITER_H
+#define QSHELL_SESSION_LOG_WRITER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <atomic>
+#include <mutex>
+
+// 进程内共享的会话日志写线程池。
+// 各会话在 GUI 线程把日志行压入所属写线程的无锁队列后立即返回，格式化、UTF-8 转换
+// 和写文件都在写线程完成：同一文件的数据先攒在缓冲里，达到 FLUSH_BYTES 或距上次写入
+// 超过 FLUSH_INTERVAL_MS 才一次写出，fsync 间隔可配置。少量写线程分担所有会话，
+// 空闲超过 IDLE_CLOSE_MS 的文件先关闭，有数据时再打开，标签页再多也不会占满文件句柄。
+//
+// 排队和缓冲中的数据总量（按 UTF-8 字节数计）不超过 MAX_PENDING_BYTES，磁盘跟不上时
+// 丢弃新数据，并在该会话日志里记下丢弃的字节数。随 open() 和 close() 传入的日志头尾
+// 不受这个上限限制，总会写进日志。
+//
+// 开启轮转后日志按大小或时间切分为 <名称>.N.log 分段，写完的分段在后台线程压缩为
+// <名称>.N.log.gz 或 <名称>.N.log.zst，超出保留数量的旧分段自动删除。
+class SessionLogWriter {
+public:
+    enum Compression {
+        NoCompression,
+        Gzip,
+        Zstd
+    };
+
+    struct Rotation {
+        qint64 maxBytes = 0;    // 单个分段的大小上限，0 表示不按大小轮转
+        qint64 maxAgeMs = 0;    // 单个分段的时长上限，0 表示不按时间轮转
+        Compression compression = NoCompression;
+        int maxSegments = 0;    // 最多保留的分段数（含正在写的），0 表示不限制
+
+        bool enabled() const { return maxBytes > 0 || maxAgeMs > 0; }
+    };
+
+    static SessionLogWriter *instance();
+    // 编译时是否带了对应的压缩库
+    static bool isCompressionSupported(Compression compression);
+    // 轮转时第 segment 个分段的文件名，filePath 去掉 .log 后缀作为名称
+    static QString segmentPath(const QString &filePath, int segment);
+
+    // 在调用线程打开日志文件（追加模式），失败时返回 0 并通过 errorString 返回原因。
+    // 开启轮转时打开的是 filePath 对应的最后一个分段。header 是最先写入的日志头。
+    quint64 open(const QString &filePath, const Rotation &rotation = Rotation(),
+                 QString *errorString = nullptr, const QByteArray &header = QByteArray());
+    // 原样写入一段文本
+    void write(quint64 id, const QByteArray &data);
+    // 写入若干行，timestamp 为 true 时每行前加同一个时间戳
+    void writeLines(quint64 id, const QStringList &lines, bool timestamp);
+    // 写入日志尾 footer，写出剩余数据并关闭文件
+    void close(quint64 id, const QByteArray &footer = QByteArray());
+
+    // 写入后最多隔多少秒 fsync 一次，0 表示只交给系统缓存，不主动 fsync
+    void setFsyncInterval(int seconds);
+
+    // 排队和缓冲中还没写出的字节数
+    qint64 pendingBytes() const;
+    // 因磁盘跟不上而丢弃的字节总数
+    qint64 droppedBytes() const;
+
+private:
+    struct Record;
+    struct LogFile;
+    class Worker;
+
+    SessionLogWriter();
+    ~SessionLogWriter();
+
+    bool reserve(quint64 id, qint64 cost);
+    void push(Record *record);
+    void release(qint64 cost);
+    void compressLater(const QString &path, Compression compression);
+
+    static const int FLUSH_BYTES = 256 * 1024;
+    static const int FLUSH_INTERVAL_MS = 1000;
+    static const int IDLE_CLOSE_MS = 30 * 1000;
+    static const qint64 MAX_PENDING_BYTES = 64 * 1024 * 1024;
+
+    QList<Worker *> workers_;
+    std::atomic<quint64> nextId_{1};
+    std::atomic<int> fsyncIntervalMs_{0};
+
+    // 内存上限和丢弃统计，dropped_ 记录还没写进日志的丢弃字节数
+    std::atomic<qint64> pendingBytes_{0};
+    std::atomic<qint64> droppedBytes_{0};
+    std::atomic<bool> hasDropped_{false};
+    std::mutex droppedMutex_;
+    QHash<quint64, qint64> dropped_;
+
+    // 压缩写完的分段，单线程以免和终端抢 CPU
+    QThreadPool compressPool_;
+};
+
+#endif//QSHELL_SESSION_LOG_WRITER_H
@@ -128,6 +128,7 @@ struct SessionData {
     SSHConfig sshConfig;
     SerialConfig serialConfig;
     int sortOrder = 0;  // 排序顺序
+    bool unlimitedHistory = false;  // 无限回滚缓冲，历史行写入磁盘临时文件
 
     SessionData() {
         id = QUuid::createUuid().toString(QUuid::WithoutBraces);
@@ -145,6 +146,7 @@ struct SessionData {
             obj["serialConfig"] = serialConfig.toJson();
         }
         obj["sortOrder"] = sortOrder;
+        obj["unlimitedHistory"] = unlimitedHistory;
         return obj;
     }
 
@@ -160,6 +162,7 @@ struct SessionData {
             data.serialConfig = SerialConfig::fromJson(obj["serialConfig"].toObject());
         }
         data.sortOrder = obj["sortOrder"].toInt(0);
+        data.unlimitedHistory = obj["unlimitedHistory"].toBool(false);
         return data;
     }
 
@@ -279,6 +282,15 @@ struct GlobalSettings {
     bool copyOnSelect = false;
     bool debug = true;
     bool logTimestamp = true;
+    int logFsyncIntervalSec = 0;  // 会话日志写入后最多隔多少秒 fsync 一次，0 表示不主动 fsync
+    int logRotateSizeMB = 0;      // 日志分段大小上限，0 表示不按大小轮转
+    int logRotateHours = 0;       // 日志分段时长上限，0 表示不按时间轮转
+    QString logCompression = "zstd";  // 写完的分段压缩格式：none、gzip 或 zstd
+    int logKeepSegments = 0;      // 每个会话最多保留的分段数，0 表示不限制
+    bool autoLog = false;         // 自动记录所有会话的日志
+    QString autoLogDirectory = "~/qshell_logs/{session}";  // 自动日志目录，支持 {session} 和 {date}
+    bool tableDrivenParser = false;
+    int scrollbackBudgetMB = 1024;  // 所有标签页回滚缓冲共享的内存上限，0 表示不限制
     bool mcpEnabled = false;
     int mcpPort = 8765;
     QString mcpBearerToken;
@@ -291,6 +303,15 @@ struct GlobalSettings {
         obj["copyOnSelect"] = copyOnSelect;
         obj["debug"] = debug;
         obj["logTimestamp"] = logTimestamp;
+        obj["logFsyncIntervalSec"] = logFsyncIntervalSec;
+        obj["logRotateSizeMB"] = logRotateSizeMB;
+        obj["logRotateHours"] = logRotateHours;
+        obj["logCompression"] = logCompression;
+        obj["logKeepSegments"] = logKeepSegments;
+        obj["autoLog"] = autoLog;
+        obj["autoLogDirectory"] = autoLogDirectory;
+        obj["tableDrivenParser"] = tableDrivenParser;
+        obj["scrollbackBudgetMB"] = scrollbackBudgetMB;
         obj["mcpEnabled"] = mcpEnabled;
         obj["mcpPort"] = mcpPort;
         obj["mcpBearerToken"] = mcpBearerToken;
@@ -305,6 +326,15 @@ struct GlobalSettings {
         settings.copyOnSelect = obj["copyOnSelect"].toBool();
         settings.debug = obj["debug"].toBool();
         settings.logTimestamp = obj["logTimestamp"].toBool(true);
+        settings.logFsyncIntervalSec = obj["logFsyncIntervalSec"].toInt(0);
+        settings.logRotateSizeMB = obj["logRotateSizeMB"].toInt(0);
+        settings.logRotateHours = obj["logRotateHours"].toInt(0);
+        settings.logCompression = obj["logCompression"].toString("zstd");
+        settings.logKeepSegments = obj["logKeepSegments"].toInt(0);
+        settings.autoLog = obj["autoLog"].toBool(false);
+        settings.autoLogDirectory = obj["autoLogDirectory"].toString("~/qshell_logs/{session}");
+        settings.tableDrivenParser = obj["tableDrivenParser"].toBool(false);
+        settings.scrollbackBudgetMB = obj["scrollbackBudgetMB"].toInt(1024);
         settings.mcpEnabled = obj["mcpEnabled"].toBool(false);
         settings.mcpPort = obj["mcpPort"].toInt(8765);
         settings.mcpBearerToken = obj["mcpBearerToken"].toString();
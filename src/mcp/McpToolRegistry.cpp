@@ -1,6 +1,7 @@
 #include "McpToolRegistry.h"
 
 #include "core/ConfigManager.h"
+#include "core/SessionLogWriter.h"
 #include "ui/MainWindow.h"
 #include "ui/terminal/BaseTerminal.h"
 
@@ -323,6 +324,18 @@ McpToolRegistry::ToolResponse McpToolRegistry::getStatus() const {
     structuredContent["tabCount"] = mainWindow_->tabCount();
     structuredContent["currentSessionName"] = mainWindow_->currentTabName();
     structuredContent["mcp"] = mcp;
+
+    QJsonObject logging;
+    logging["autoLog"] = settings.autoLog;
+    logging["pendingBytes"] = SessionLogWriter::instance()->pendingBytes();
+    logging["droppedBytes"] = SessionLogWriter::instance()->droppedBytes();
+    structuredContent["logging"] = logging;
+    if (BaseTerminal *terminal = mainWindow_->getCurrentSession()) {
+        QJsonObject io;
+        io["queueDepth"] = terminal->receiveQueueDepth();
+        io["bytesPerSecond"] = terminal->receiveBytesPerSecond();
+        structuredContent["currentSessionIo"] = io;
+    }
     return makeResponse(structuredContent);
 }
 
@@ -572,9 +585,12 @@ void McpToolRegistry::startWaitForString(const QString &text, int timeoutMs, con
         context->deleteLater();
     };
 
-    *connection = QObject::connect(terminal, &QTermWidget::onNewLine, context, [complete, text](const QString &line) {
-        if (line.contains(text)) {
-            complete(true, line);
+    *connection = QObject::connect(terminal, &QTermWidget::newLines, context, [complete, text](quint64, const QStringList &lines) {
+        for (const QString &line : lines) {
+            if (line.contains(text)) {
+                complete(true, line);
+                return;
+            }
         }
     });
 
@@ -639,10 +655,13 @@ void McpToolRegistry::startWaitForRegex(const QString &pattern, int timeoutMs, c
         context->deleteLater();
     };
 
-    *connection = QObject::connect(terminal, &QTermWidget::onNewLine, context, [complete, regex](const QString &line) {
-        const QRegularExpressionMatch match = regex.match(line);
-        if (match.hasMatch()) {
-            complete(true, line, match.captured(0));
+    *connection = QObject::connect(terminal, &QTermWidget::newLines, context, [complete, regex](quint64, const QStringList &lines) {
+        for (const QString &line : lines) {
+            const QRegularExpressionMatch match = regex.match(line);
+            if (match.hasMatch()) {
+                complete(true, line, match.captured(0));
+                return;
+            }
         }
     });
 
@@ -317,7 +317,7 @@ void LuaScriptEngine::registerScreenModule(sol::table& qshell)
         waitForString_ = QString::fromStdString(str);
         findWaitForString_ = false;
         auto currentSession = mainWindow_->getCurrentSession();
-        QObject::connect(currentSession, &QTermWidget::onNewLine, this, &LuaScriptEngine::onDisplayOutput);
+        QObject::connect(currentSession, &QTermWidget::newLines, this, &LuaScriptEngine::onDisplayOutput);
         
         auto endTime = std::chrono::steady_clock::now()
                           + std::chrono::milliseconds(timeoutSeconds * 1000);
@@ -326,7 +326,7 @@ void LuaScriptEngine::registerScreenModule(sol::table& qshell)
         constexpr int pollInterval = 4;  // 每4次循环检查一次屏幕内容（约200ms）
         while (std::chrono::steady_clock::now() < endTime) {
             if (gShouldStop.load()) {
-                QObject::disconnect(currentSession, &QTermWidget::onNewLine, this, &LuaScriptEngine::onDisplayOutput);
+                QObject::disconnect(currentSession, &QTermWidget::newLines, this, &LuaScriptEngine::onDisplayOutput);
                 throw std::runtime_error("interrupted during waitForString");
             }
 
@@ -335,7 +335,7 @@ void LuaScriptEngine::registerScreenModule(sol::table& qshell)
 
             if (findWaitForString_) {
                 isWaitForString_ = false;
-                QObject::disconnect(currentSession, &QTermWidget::onNewLine, this, &LuaScriptEngine::onDisplayOutput);
+                QObject::disconnect(currentSession, &QTermWidget::newLines, this, &LuaScriptEngine::onDisplayOutput);
                 return true;
             }
 
@@ -346,7 +346,7 @@ void LuaScriptEngine::registerScreenModule(sol::table& qshell)
                 if (lastLine.contains(waitForString_)) {
                     findWaitForString_ = true;
                     isWaitForString_ = false;
-                    QObject::disconnect(currentSession, &QTermWidget::onNewLine, this, &LuaScriptEngine::onDisplayOutput);
+                    QObject::disconnect(currentSession, &QTermWidget::newLines, this, &LuaScriptEngine::onDisplayOutput);
                     return true;
                 }
             }
@@ -355,7 +355,7 @@ void LuaScriptEngine::registerScreenModule(sol::table& qshell)
         }
 
         isWaitForString_ = false;
-        QObject::disconnect(currentSession, &QTermWidget::onNewLine, this, &LuaScriptEngine::onDisplayOutput);
+        QObject::disconnect(currentSession, &QTermWidget::newLines, this, &LuaScriptEngine::onDisplayOutput);
         return false;
     });
 
@@ -373,7 +373,7 @@ void LuaScriptEngine::registerScreenModule(sol::table& qshell)
         }
 
         auto currentSession = mainWindow_->getCurrentSession();
-        QObject::connect(currentSession, &QTermWidget::onNewLine,
+        QObject::connect(currentSession, &QTermWidget::newLines,
                          this, &LuaScriptEngine::onDisplayOutput);
 
         auto endTime = std::chrono::steady_clock::now()
@@ -384,7 +384,7 @@ void LuaScriptEngine::registerScreenModule(sol::table& qshell)
         while (std::chrono::steady_clock::now() < endTime) {
             if (gShouldStop.load()) {
                 isWaitForRegexp_ = false;
-                QObject::disconnect(currentSession, &QTermWidget::onNewLine,
+                QObject::disconnect(currentSession, &QTermWidget::newLines,
                                    this, &LuaScriptEngine::onDisplayOutput);
                 throw std::runtime_error("interrupted during waitForRegexp");
             }
@@ -394,7 +394,7 @@ void LuaScriptEngine::registerScreenModule(sol::table& qshell)
 
             if (findWaitForRegexp_) {
                 isWaitForRegexp_ = false;
-                QObject::disconnect(currentSession, &QTermWidget::onNewLine,
+                QObject::disconnect(currentSession, &QTermWidget::newLines,
                                    this, &LuaScriptEngine::onDisplayOutput);
                 return true;
             }
@@ -408,7 +408,7 @@ void LuaScriptEngine::registerScreenModule(sol::table& qshell)
                     findWaitForRegexp_ = true;
                     lastRegexpMatch_ = match.captured(0);
                     isWaitForRegexp_ = false;
-                    QObject::disconnect(currentSession, &QTermWidget::onNewLine,
+                    QObject::disconnect(currentSession, &QTermWidget::newLines,
                                         this, &LuaScriptEngine::onDisplayOutput);
                     return true;
                 }
@@ -419,7 +419,7 @@ void LuaScriptEngine::registerScreenModule(sol::table& qshell)
         }
 
         isWaitForRegexp_ = false;
-        QObject::disconnect(currentSession, &QTermWidget::onNewLine,
+        QObject::disconnect(currentSession, &QTermWidget::newLines,
                            this, &LuaScriptEngine::onDisplayOutput);
         return false;
     });
@@ -789,18 +789,20 @@ void LuaScriptEngine::stopScript()
     gShouldStop = true;
 }
 
-void LuaScriptEngine::onDisplayOutput(const QString &line) {
-    if (isWaitForString_) {
-        if (line.contains(waitForString_)) {
-            findWaitForString_ = true;
+void LuaScriptEngine::onDisplayOutput(quint64 /*firstSequence*/, const QStringList &lines) {
+    for (const QString &line : lines) {
+        if (isWaitForString_ && !findWaitForString_) {
+            if (line.contains(waitForString_)) {
+                findWaitForString_ = true;
+            }
         }
-    }
 
-    if (isWaitForRegexp_) {
-        QRegularExpressionMatch match = waitForRegexp_.match(line);
-        if (match.hasMatch()) {
-            findWaitForRegexp_ = true;
-            lastRegexpMatch_ = match.captured(0);
+        if (isWaitForRegexp_ && !findWaitForRegexp_) {
+            QRegularExpressionMatch match = waitForRegexp_.match(line);
+            if (match.hasMatch()) {
+                findWaitForRegexp_ = true;
+                lastRegexpMatch_ = match.captured(0);
+            }
         }
     }
 }
@@ -35,7 +35,7 @@ private:
     void registerSessionModule(sol::table &qshell);
     void registerTimerModule(sol::table &qshell);
     void registerHttpModule(sol::table &qshell);
-    void onDisplayOutput(const QString &line);
+    void onDisplayOutput(quint64 firstSequence, const QStringList &lines);
 
     // 定时器处理
     void processTimers();
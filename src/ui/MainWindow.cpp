@@ -2,6 +2,7 @@
 #include "SettingDialog.h"
 #include "command/CommandButtonBar.h"
 #include "core/ConfigManager.h"
+#include "core/SessionLogWriter.h"
 #include "mcp/McpHttpServer.h"
 #include "scriptengine/LuaScriptEngine.h"
 #include "scriptengine/ScriptRunner.h"
@@ -45,6 +46,13 @@ MainWindow::MainWindow(QWidget *parent)
     initButtonBar();
     restoreLayoutState();
     initMcpServer();
+
+    connect(ConfigManager::instance(), &ConfigManager::globalSettingsChanged,
+            this, &MainWindow::syncScrollbackBudget);
+    syncScrollbackBudget();
+    connect(ConfigManager::instance(), &ConfigManager::globalSettingsChanged,
+            this, &MainWindow::syncLogWriter);
+    syncLogWriter();
 }
 
 void MainWindow::initLuaEngine() {
@@ -179,6 +187,29 @@ void MainWindow::initMcpServer() {
     syncMcpServer();
 }
 
+void MainWindow::syncScrollbackBudget() {
+    const GlobalSettings settings = ConfigManager::instance()->globalSettings();
+    QTermWidget::setHistoryMemoryBudget(static_cast<qint64>(settings.scrollbackBudgetMB) * 1024 * 1024);
+}
+
+void MainWindow::syncLogWriter() {
+    const GlobalSettings settings = ConfigManager::instance()->globalSettings();
+    SessionLogWriter::instance()->setFsyncInterval(settings.logFsyncIntervalSec);
+
+    // 打开自动日志时，已经打开的会话也开始记录；关闭时停止自动打开的日志
+    for (int i = 0; i < tabWidget_->count(); ++i) {
+        auto *terminal = dynamic_cast<BaseTerminal *>(tabWidget_->widget(i));
+        if (terminal == nullptr) {
+            continue;
+        }
+        if (settings.autoLog) {
+            terminal->startAutoLogging();
+        } else {
+            terminal->stopAutoLogging();
+        }
+    }
+}
+
 void MainWindow::syncMcpServer() {
     if (mcpServer_ == nullptr) {
         return;
@@ -948,7 +979,13 @@ bool MainWindow::openSessionById(const QString &sessionId) {
         return false;
     }
 
+    if (session.unlimitedHistory) {
+        terminal->setHistorySize(-1);
+    }
     terminal->connect();
+    if (ConfigManager::instance()->globalSettings().autoLog) {
+        terminal->startAutoLogging();
+    }
     QObject::connect(terminal, &BaseTerminal::onSessionError, this, &MainWindow::onSessionError);
     tabWidget_->addTab(terminal, *connectStateIcon_, session.name);
     tabWidget_->setCurrentWidget(terminal);
@@ -75,6 +75,8 @@ private slots:
     static void onDocAction();
     void onAboutAction();
     void syncMcpServer();
+    void syncScrollbackBudget();
+    void syncLogWriter();
 
 private:
     void initLuaEngine();
@@ -1,6 +1,7 @@
 #include "SettingDialog.h"
 #include "qtermwidget.h"
 #include "core/ConfigManager.h"
+#include "core/SessionLogWriter.h"
 
 #include <QIntValidator>
 
@@ -15,6 +16,15 @@ SettingDialog::SettingDialog(QWidget *parent) :QDialog(parent) {
     copyOnSelectCheckBox_->setChecked(settings.copyOnSelect);
     debugCheckBox_->setChecked(settings.debug);
     logTimestampCheckBox_->setChecked(settings.logTimestamp);
+    logFsyncIntervalEdit_->setText(QString::number(settings.logFsyncIntervalSec));
+    logRotateSizeEdit_->setText(QString::number(settings.logRotateSizeMB));
+    logRotateHoursEdit_->setText(QString::number(settings.logRotateHours));
+    logCompressionEdit_->setCurrentIndex(qMax(0, logCompressionEdit_->findData(settings.logCompression)));
+    logKeepSegmentsEdit_->setText(QString::number(settings.logKeepSegments));
+    autoLogCheckBox_->setChecked(settings.autoLog);
+    autoLogDirectoryEdit_->setText(settings.autoLogDirectory);
+    tableDrivenParserCheckBox_->setChecked(settings.tableDrivenParser);
+    scrollbackBudgetEdit_->setText(QString::number(settings.scrollbackBudgetMB));
     mcpEnabledCheckBox_->setChecked(settings.mcpEnabled);
     mcpPortEdit_->setText(QString::number(settings.mcpPort));
     mcpBearerTokenEdit_->setText(settings.mcpBearerToken);
@@ -50,6 +60,54 @@ void SettingDialog::initWidgets() {
     logTimestampCheckBox_->setToolTip(tr("Add a system timestamp before each saved log line"));
     formLayout_->addRow(tr("Log Timestamp:"), logTimestampCheckBox_);
 
+    logFsyncIntervalEdit_ = new QLineEdit(this);
+    logFsyncIntervalEdit_->setValidator(new QIntValidator(0, 3600, logFsyncIntervalEdit_));
+    logFsyncIntervalEdit_->setToolTip(tr("Sync saved logs to disk at most this many seconds after writing, 0 to leave it to the system"));
+    formLayout_->addRow(tr("Log Fsync Interval (s):"), logFsyncIntervalEdit_);
+
+    logRotateSizeEdit_ = new QLineEdit(this);
+    logRotateSizeEdit_->setValidator(new QIntValidator(0, 1024 * 1024, logRotateSizeEdit_));
+    logRotateSizeEdit_->setToolTip(tr("Start a new log segment when the current one reaches this size, 0 to disable"));
+    formLayout_->addRow(tr("Log Rotate Size (MB):"), logRotateSizeEdit_);
+
+    logRotateHoursEdit_ = new QLineEdit(this);
+    logRotateHoursEdit_->setValidator(new QIntValidator(0, 24 * 365, logRotateHoursEdit_));
+    logRotateHoursEdit_->setToolTip(tr("Start a new log segment after this many hours, 0 to disable"));
+    formLayout_->addRow(tr("Log Rotate Interval (h):"), logRotateHoursEdit_);
+
+    logCompressionEdit_ = new QComboBox(this);
+    logCompressionEdit_->addItem(tr("None"), "none");
+    if (SessionLogWriter::isCompressionSupported(SessionLogWriter::Gzip)) {
+        logCompressionEdit_->addItem(tr("gzip"), "gzip");
+    }
+    if (SessionLogWriter::isCompressionSupported(SessionLogWriter::Zstd)) {
+        logCompressionEdit_->addItem(tr("zstd"), "zstd");
+    }
+    logCompressionEdit_->setToolTip(tr("Compress finished log segments in the background"));
+    formLayout_->addRow(tr("Log Compression:"), logCompressionEdit_);
+
+    logKeepSegmentsEdit_ = new QLineEdit(this);
+    logKeepSegmentsEdit_->setValidator(new QIntValidator(0, 100000, logKeepSegmentsEdit_));
+    logKeepSegmentsEdit_->setToolTip(tr("Delete the oldest segments of a session log beyond this many, 0 to keep all"));
+    formLayout_->addRow(tr("Log Segments Kept:"), logKeepSegmentsEdit_);
+
+    autoLogCheckBox_ = new QCheckBox(this);
+    autoLogCheckBox_->setToolTip(tr("Save the log of every session automatically"));
+    formLayout_->addRow(tr("Auto Log:"), autoLogCheckBox_);
+
+    autoLogDirectoryEdit_ = new QLineEdit(this);
+    autoLogDirectoryEdit_->setToolTip(tr("Directory of automatic logs, {session} and {date} are replaced by the session name and yyyyMMdd"));
+    formLayout_->addRow(tr("Auto Log Directory:"), autoLogDirectoryEdit_);
+
+    tableDrivenParserCheckBox_ = new QCheckBox(this);
+    tableDrivenParserCheckBox_->setToolTip(tr("Parse terminal output with the table driven VT500 state machine (experimental)"));
+    formLayout_->addRow(tr("VT500 Parser:"), tableDrivenParserCheckBox_);
+
+    scrollbackBudgetEdit_ = new QLineEdit(this);
+    scrollbackBudgetEdit_->setValidator(new QIntValidator(0, 1024 * 1024, scrollbackBudgetEdit_));
+    scrollbackBudgetEdit_->setToolTip(tr("Memory shared by the scrollback of all tabs, 0 for unlimited"));
+    formLayout_->addRow(tr("Scrollback Budget (MB):"), scrollbackBudgetEdit_);
+
     mcpEnabledCheckBox_ = new QCheckBox(this);
     mcpEnabledCheckBox_->setToolTip(tr("Enable local MCP control endpoint on 127.0.0.1"));
     formLayout_->addRow(tr("Enable MCP:"), mcpEnabledCheckBox_);
@@ -97,6 +155,18 @@ void SettingDialog::onOK() {
     settings.copyOnSelect = copyOnSelectCheckBox_->isChecked();
     settings.debug = debugCheckBox_->isChecked();
     settings.logTimestamp = logTimestampCheckBox_->isChecked();
+    settings.logFsyncIntervalSec = qMax(0, logFsyncIntervalEdit_->text().toInt());
+    settings.logRotateSizeMB = qMax(0, logRotateSizeEdit_->text().toInt());
+    settings.logRotateHours = qMax(0, logRotateHoursEdit_->text().toInt());
+    settings.logCompression = logCompressionEdit_->currentData().toString();
+    settings.logKeepSegments = qMax(0, logKeepSegmentsEdit_->text().toInt());
+    settings.autoLog = autoLogCheckBox_->isChecked();
+    settings.autoLogDirectory = autoLogDirectoryEdit_->text().trimmed();
+    if (settings.autoLogDirectory.isEmpty()) {
+        settings.autoLogDirectory = GlobalSettings().autoLogDirectory;
+    }
+    settings.tableDrivenParser = tableDrivenParserCheckBox_->isChecked();
+    settings.scrollbackBudgetMB = qMax(0, scrollbackBudgetEdit_->text().toInt());
     settings.mcpEnabled = mcpEnabledCheckBox_->isChecked();
     settings.mcpPort = mcpPortEdit_->text().toInt();
     if (settings.mcpPort < 1 || settings.mcpPort > 65535) {
@@ -34,6 +34,15 @@ private:
     QCheckBox *copyOnSelectCheckBox_ = nullptr;
     QCheckBox *debugCheckBox_ = nullptr;
     QCheckBox *logTimestampCheckBox_ = nullptr;
+    QLineEdit *logFsyncIntervalEdit_ = nullptr;
+    QLineEdit *logRotateSizeEdit_ = nullptr;
+    QLineEdit *logRotateHoursEdit_ = nullptr;
+    QComboBox *logCompressionEdit_ = nullptr;
+    QLineEdit *logKeepSegmentsEdit_ = nullptr;
+    QCheckBox *autoLogCheckBox_ = nullptr;
+    QLineEdit *autoLogDirectoryEdit_ = nullptr;
+    QCheckBox *tableDrivenParserCheckBox_ = nullptr;
+    QLineEdit *scrollbackBudgetEdit_ = nullptr;
     QCheckBox *mcpEnabledCheckBox_ = nullptr;
     QLineEdit *mcpPortEdit_ = nullptr;
     QLineEdit *mcpBearerTokenEdit_ = nullptr;
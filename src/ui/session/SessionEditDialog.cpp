@@ -95,6 +95,10 @@ QWidget* SessionEditDialog::createGeneralSection() {
             this, &SessionEditDialog::onProtocolChanged);
     layout->addRow(tr("Protocol:"), protocolCombo_);
 
+    unlimitedHistoryCheck_ = new QCheckBox(tr("Unlimited (spill to disk)"), groupBox);
+    unlimitedHistoryCheck_->setToolTip(tr("Keep the whole scrollback in a temporary file instead of the last 128000 lines in memory"));
+    layout->addRow(tr("Scrollback:"), unlimitedHistoryCheck_);
+
     return groupBox;
 }
 
@@ -261,6 +265,7 @@ void SessionEditDialog::setSessionData(const SessionData& data) {
 
     int protocolIndex = protocolCombo_->findData(static_cast<int>(data.protocolType));
     protocolCombo_->setCurrentIndex(protocolIndex >= 0 ? protocolIndex : 0);
+    unlimitedHistoryCheck_->setChecked(data.unlimitedHistory);
 
     // SSH
     hostEdit_->setText(data.sshConfig.host);
@@ -291,6 +296,7 @@ SessionData SessionEditDialog::sessionData() const {
     data.name = nameEdit_->text().trimmed();
     data.groupId = groupCombo_->currentData().toString();
     data.protocolType = static_cast<ProtocolType>(protocolCombo_->currentData().toInt());
+    data.unlimitedHistory = unlimitedHistoryCheck_->isChecked();
 
     // SSH
     data.sshConfig.host = hostEdit_->text().trimmed();
@@ -38,6 +38,7 @@ private:
     QLineEdit* nameEdit_ = nullptr;
     QComboBox* groupCombo_ = nullptr;
     QComboBox* protocolCombo_ = nullptr;
+    QCheckBox* unlimitedHistoryCheck_ = nullptr;
 
     // 协议参数区域
     QStackedWidget* protocolStack_ = nullptr;
@@ -1,8 +1,11 @@
 #include "SessionTabWidget.h"
+#include "qtermwidget.h"
 
+#include <QHelpEvent>
 #include <QInputDialog>
 #include <QMenu>
 #include <QTabBar>
+#include <QToolTip>
 
 SessionTabWidget::SessionTabWidget(QWidget *parent)
     : QTabWidget(parent) {
@@ -21,10 +24,15 @@ SessionTabWidget::SessionTabWidget(QWidget *parent)
 
     connect(tabBar(), &QTabBar::customContextMenuRequested,
             this, &SessionTabWidget::showTabContextMenu);
+    connect(this, &QTabWidget::currentChanged, this, &SessionTabWidget::updateBackgroundTabs);
+
+    // 悬停标签时显示后台模式节省的渲染开销
+    tabBar()->installEventFilter(this);
 }
 
 void SessionTabWidget::tabInserted(int index) {
     QTabWidget::tabInserted(index);
+    updateBackgroundTabs();
 #ifdef Q_OS_MACOS
     tabBar()->setExpanding(false);
 #endif
@@ -71,3 +79,35 @@ void SessionTabWidget::renameTab() {
         setTabText(m_contextMenuTabIndex, newName);
     }
 }
+
+void SessionTabWidget::updateBackgroundTabs() {
+    const int current = currentIndex();
+    for (int i = 0; i < count(); ++i) {
+        if (auto *terminal = qobject_cast<QTermWidget *>(widget(i))) {
+            terminal->setBackgroundTab(i != current);
+        }
+    }
+}
+
+bool SessionTabWidget::eventFilter(QObject *watched, QEvent *event) {
+    if (watched == tabBar() && event->type() == QEvent::ToolTip) {
+        auto *helpEvent = static_cast<QHelpEvent *>(event);
+        const int index = tabBar()->tabAt(helpEvent->pos());
+        auto *terminal = qobject_cast<QTermWidget *>(widget(index));
+        if (terminal) {
+            QString text = tr("%1\nScrollback: %2 lines, %3 of %4 total")
+                               .arg(tabText(index))
+                               .arg(terminal->historyLinesCount())
+                               .arg(locale().formattedDataSize(terminal->historyMemoryUsage()))
+                               .arg(locale().formattedDataSize(QTermWidget::totalHistoryMemoryUsage()));
+            if (terminal->backgroundFramesSkipped() > 0) {
+                text += tr("\nBackground: %1 frames skipped, ~%2 ms rendering saved")
+                            .arg(terminal->backgroundFramesSkipped())
+                            .arg(terminal->backgroundTimeSavedMsecs());
+            }
+            QToolTip::showText(helpEvent->globalPos(), text, tabBar());
+            return true;
+        }
+    }
+    return QTabWidget::eventFilter(watched, event);
+}
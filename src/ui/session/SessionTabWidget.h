@@ -45,10 +45,13 @@ public:
 protected:
     void tabInserted(int index) override;
     void tabRemoved(int index) override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
 
 private slots:
     void showTabContextMenu(const QPoint &pos);
     void renameTab();
+    // 非当前标签页的终端进入后台模式，只保持仿真器状态，不做渲染
+    void updateBackgroundTabs();
 
 private:
     int m_contextMenuTabIndex = -1;
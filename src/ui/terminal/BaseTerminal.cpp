@@ -4,6 +4,8 @@
 #include "ptyqt.h"
 #include <QDebug>
 #include <QDir>
+#include <QFileInfo>
+#include <QInputDialog>
 #include <QProcess>
 #include <QContextMenuEvent>
 #include <QMenu>
@@ -12,11 +14,12 @@
 #include <QDateTime>
 #include <QColorDialog>
 #include <QRandomGenerator>
+#include <QRegularExpression>
 
 BaseTerminal::BaseTerminal(QWidget *parent) : QTermWidget(parent, parent) {
     connect_ = false;
     logging_ = false;
-    logFile_ = nullptr;
+    logId_ = 0;
 
     auto globalSettings = ConfigManager::instance()->globalSettings();
 
@@ -30,20 +33,28 @@ BaseTerminal::BaseTerminal(QWidget *parent) : QTermWidget(parent, parent) {
     setColorScheme(globalSettings.colorScheme);
     setScrollBarPosition(ScrollBarRight);
     setConfirmMultilinePaste(false);
+    setTableDrivenParser(globalSettings.tableDrivenParser);
 
     if (globalSettings.copyOnSelect) {
         QObject::connect(this, &QTermWidget::copyAvailable, this, &BaseTerminal::onCopyAvailable);
     }
 
-    QObject::connect(this, &QTermWidget::onNewLine, this, &BaseTerminal::onDisplayOutput);
-
     // 启用右键菜单
     setContextMenuPolicy(Qt::DefaultContextMenu);
 }
 
 BaseTerminal::~BaseTerminal() {
-    // 确保关闭日志文件
+    // 确保关闭日志文件和录制文件
     stopLogging();
+    stopRecording();
+    delete recordFile_;
+    recordFile_ = nullptr;
+    // 回放窗口跟着会话一起关闭
+    delete replayViewer_;
+
+    // 先停止 pty 读线程，它会回调到本对象
+    delete localShell_;
+    localShell_ = nullptr;
 
     delete font_;
     font_ = nullptr;
@@ -83,6 +94,11 @@ void BaseTerminal::startLocalShell() {
         }
     });
 
+    // 在 pty 读线程中直接入队，由 GUI 线程分片交给终端解析
+    localShell_->setReadCallback([this](const char *data, qint64 len) {
+        enqueueData(data, static_cast<int>(len));
+    });
+
     // 启动进程
     bool ret = localShell_->startProcess(
         shellPath,
@@ -98,18 +114,6 @@ void BaseTerminal::startLocalShell() {
         return;
     }
 
-    // 连接 notifier（如果可用）
-    if (QIODevice* notifier = localShell_->notifier()) {
-        QObject::connect(notifier, &QIODevice::readyRead, this, [this]() {
-            QByteArray data = localShell_->readAll();
-            if (!data.isEmpty()) {
-                this->recvData(data.data(), static_cast<int>(data.size()));
-            }
-        });
-    } else {
-        qDebug() << "localShell_->notifier() is nullptr";
-    }
-
     connect_ = true;
 }
 
@@ -129,10 +133,11 @@ QString BaseTerminal::getSessionName() const {
     return sessionData_.name;
 }
 
-void BaseTerminal::onDisplayOutput(const QString &line) {
-    // 如果正在记录日志，写入数据
-    if (logging_ && logFile_ && logFile_->isOpen()) {
-        writeToLog(line);
+void BaseTerminal::onDisplayOutput(quint64 /*firstSequence*/, const QStringList &lines) {
+    // 如果正在记录日志，整批交给日志写线程
+    if (logging_ && logId_ != 0) {
+        SessionLogWriter::instance()->writeLines(logId_, lines,
+            ConfigManager::instance()->globalSettings().logTimestamp);
     }
 }
 
@@ -180,6 +185,27 @@ void BaseTerminal::contextMenuEvent(QContextMenuEvent *event) {
     }
     QObject::connect(logAction, &QAction::triggered, this, &BaseTerminal::onToggleLogging);
 
+    // 录制与回放操作
+    QAction *recordAction = nullptr;
+    if (isRecording()) {
+        recordAction = menu.addAction(tr("停止录制"));
+        recordAction->setIcon(QIcon::fromTheme("media-playback-stop"));
+    } else {
+        recordAction = menu.addAction(tr("录制会话..."));
+        recordAction->setIcon(QIcon::fromTheme("media-record"));
+    }
+    QObject::connect(recordAction, &QAction::triggered, this, &BaseTerminal::onToggleRecording);
+
+    QAction *replayAction = nullptr;
+    if (replayViewer_ && replayViewer_->isReplaying()) {
+        replayAction = menu.addAction(tr("停止回放"));
+        replayAction->setIcon(QIcon::fromTheme("media-playback-stop"));
+    } else {
+        replayAction = menu.addAction(tr("回放录制..."));
+        replayAction->setIcon(QIcon::fromTheme("media-playback-start"));
+    }
+    QObject::connect(replayAction, &QAction::triggered, this, &BaseTerminal::onReplayRecording);
+
     menu.addSeparator();
 
     // 清屏操作
@@ -304,14 +330,14 @@ QColor BaseTerminal::generateRandomColor() {
 
 void BaseTerminal::onToggleLogging() {
     if (logging_) {
-        // 停止日志记录
+        // 停止日志记录，之后改动设置也不会再自动打开
+        autoLogStoppedByUser_ = true;
         stopLogging();
         QMessageBox::information(this, tr("日志保存"),
             tr("日志保存已停止。\n文件: %1").arg(logFilePath_));
     } else {
         // 开始日志记录 - 打开文件选择对话框
-        QString defaultFileName = QString("terminal_log_%1.log")
-            .arg(QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss"));
+        QString defaultFileName = defaultLogFileName();
 
         QString filePath = QFileDialog::getSaveFileName(
             this,
@@ -356,76 +382,236 @@ void BaseTerminal::onToggleLogging() {
     }
 }
 
-void BaseTerminal::startLogging(const QString &filePath) {
+void BaseTerminal::startLogging(const QString &filePath, bool interactive) {
     if (logging_) {
         stopLogging();
     }
 
-    logFile_ = new QFile(filePath);
-
     // 以追加模式打开（如果用户选择覆盖，文件已被删除）
-    if (!logFile_->open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
-        QMessageBox::critical(this, tr("错误"),
-            tr("无法打开文件进行写入:\n%1\n\n错误: %2")
-                .arg(filePath)
-                .arg(logFile_->errorString()));
-        delete logFile_;
-        logFile_ = nullptr;
+    QString errorString;
+    const GlobalSettings settings = ConfigManager::instance()->globalSettings();
+    // 日志头随打开一起交给写线程，不受排队数据上限影响
+    const QString header = QString("\n========== 日志开始: %1 ==========\n")
+        .arg(QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss"));
+    logId_ = SessionLogWriter::instance()->open(filePath, logRotation(settings), &errorString, header.toUtf8());
+    if (logId_ == 0) {
+        if (interactive) {
+            QMessageBox::critical(this, tr("错误"),
+                tr("无法打开文件进行写入:\n%1\n\n错误: %2")
+                    .arg(filePath)
+                    .arg(errorString));
+        } else {
+            qWarning() << "Failed to open log" << filePath << errorString;
+        }
         return;
     }
 
     logFilePath_ = filePath;
     logging_ = true;
+    autoLogging_ = false;
 
-    // 写入日志头
-    QString header = QString("\n========== 日志开始: %1 ==========\n")
-        .arg(QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss"));
-    logFile_->write(header.toUtf8());
-    logFile_->flush();
+    // 只在记录日志期间订阅行事件，未订阅时终端不会解码滚出的行
+    QObject::connect(this, &QTermWidget::newLines, this, &BaseTerminal::onDisplayOutput, Qt::UniqueConnection);
 
     emit loggingStateChanged(true);
 
     qDebug() << "Started logging to:" << filePath;
 }
 
+void BaseTerminal::startAutoLogging() {
+    // 用户手动停过的日志不再自动打开
+    if (logging_ || autoLogStoppedByUser_) {
+        return;
+    }
+
+    const GlobalSettings settings = ConfigManager::instance()->globalSettings();
+    QString directory = settings.autoLogDirectory;
+    if (directory.startsWith("~")) {
+        directory = QDir::homePath() + directory.mid(1);
+    }
+    directory.replace("{session}", logSessionName());
+    directory.replace("{date}", QDate::currentDate().toString("yyyyMMdd"));
+    if (!QDir().mkpath(directory)) {
+        qWarning() << "Failed to create log directory" << directory;
+        return;
+    }
+
+    startLogging(QDir(directory).filePath(defaultLogFileName()), false);
+    autoLogging_ = logging_;
+}
+
+void BaseTerminal::stopAutoLogging() {
+    // 用户手动打开的日志不受自动日志设置影响
+    if (autoLogging_) {
+        stopLogging();
+    }
+}
+
+QString BaseTerminal::logSessionName() const {
+    // 会话名用在文件名和目录名里，去掉路径分隔符等字符
+    QString name = sessionData_.name;
+    name.replace(QRegularExpression(R"([\\/:*?"<>|\s])"), "_");
+    if (name.isEmpty()) {
+        name = "session";
+    }
+    return name;
+}
+
+QString BaseTerminal::defaultLogFileName() const {
+    // 会话名作为文件名前缀，轮转时分段命名为 <会话名>_yyyyMMdd_HHmmss.N.log
+    return QString("%1_%2.log").arg(logSessionName(), QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss"));
+}
+
+SessionLogWriter::Rotation BaseTerminal::logRotation(const GlobalSettings &settings) {
+    SessionLogWriter::Rotation rotation;
+    rotation.maxBytes = static_cast<qint64>(settings.logRotateSizeMB) * 1024 * 1024;
+    rotation.maxAgeMs = static_cast<qint64>(settings.logRotateHours) * 3600 * 1000;
+    rotation.maxSegments = settings.logKeepSegments;
+    if (settings.logCompression == "gzip") {
+        rotation.compression = SessionLogWriter::Gzip;
+    } else if (settings.logCompression == "zstd") {
+        rotation.compression = SessionLogWriter::Zstd;
+    }
+    return rotation;
+}
+
 void BaseTerminal::stopLogging() {
-    if (!logging_ || !logFile_) {
+    if (!logging_ || logId_ == 0) {
         return;
     }
 
-    // 写入日志尾
-    QString footer = QString("\n========== 日志结束: %1 ==========\n")
-        .arg(QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss"));
-    logFile_->write(footer.toUtf8());
-    logFile_->flush();
+    QObject::disconnect(this, &QTermWidget::newLines, this, &BaseTerminal::onDisplayOutput);
 
-    logFile_->close();
-    delete logFile_;
-    logFile_ = nullptr;
+    // 日志尾随关闭一起交给写线程
+    const QString footer = QString("\n========== 日志结束: %1 ==========\n")
+        .arg(QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss"));
+    SessionLogWriter::instance()->close(logId_, footer.toUtf8());
+    logId_ = 0;
     logging_ = false;
+    autoLogging_ = false;
 
     emit loggingStateChanged(false);
 
     qDebug() << "Stopped logging to:" << logFilePath_;
 }
 
-void BaseTerminal::writeToLog(const QString &line) {
-    if (!logFile_ || !logFile_->isOpen()) {
+void BaseTerminal::onToggleRecording() {
+    if (isRecording()) {
+        stopRecording();
+        recordFile_->close();
+        const QString filePath = recordFile_->fileName();
+        delete recordFile_;
+        recordFile_ = nullptr;
+        QMessageBox::information(this, tr("录制会话"),
+            tr("录制已停止。\n文件: %1").arg(filePath));
         return;
     }
 
-    if (ConfigManager::instance()->globalSettings().logTimestamp) {
-        const QString timestamp = QDateTime::currentDateTime().toString("[yyyy-MM-dd HH:mm:ss.zzz] ");
-        logFile_->write(timestamp.toUtf8());
+    QString defaultFileName = QString("terminal_rec_%1.cast")
+        .arg(QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss"));
+    QString filePath = QFileDialog::getSaveFileName(
+        this,
+        tr("录制会话"),
+        QDir::homePath() + "/" + defaultFileName,
+        tr("asciicast 录制 (*.cast);;所有文件 (*)")
+    );
+    if (filePath.isEmpty()) {
+        return;
     }
 
-    logFile_->write(line.toUtf8());
-    logFile_->write("\n");
+    recordFile_ = new QFile(filePath);
+    if (!recordFile_->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        QMessageBox::critical(this, tr("错误"),
+            tr("无法打开文件进行写入:\n%1\n\n错误: %2")
+                .arg(filePath)
+                .arg(recordFile_->errorString()));
+        delete recordFile_;
+        recordFile_ = nullptr;
+        return;
+    }
+
+    // 录制进入终端的原始字节，颜色、光标移动和全屏程序都能原样回放
+    startRecording(recordFile_, sessionData_.name);
+    qDebug() << "Started recording to:" << filePath;
+}
+
+void BaseTerminal::onReplayRecording() {
+    if (replayViewer_ && replayViewer_->isReplaying()) {
+        replayViewer_->stopReplay();
+        return;
+    }
+
+    QString filePath = QFileDialog::getOpenFileName(
+        this,
+        tr("回放录制"),
+        QDir::homePath(),
+        tr("asciicast 录制 (*.cast);;所有文件 (*)")
+    );
+    if (filePath.isEmpty()) {
+        return;
+    }
+
+    const QStringList speeds = {tr("1x"), tr("2x"), tr("4x"), tr("8x"), tr("最大速度")};
+    bool ok = false;
+    const QString speedText = QInputDialog::getItem(this, tr("回放录制"), tr("回放速度:"),
+                                                    speeds, 0, false, &ok);
+    if (!ok) {
+        return;
+    }
+    // 最大速度回放可以作为解析和渲染吞吐量的基准测试
+    const int speedIndex = static_cast<int>(speeds.indexOf(speedText));
+    const double speed = speedIndex == speeds.size() - 1 ? 0 : (1 << speedIndex);
+    replayBenchmark_ = speed <= 0;
+
+    // 回放到单独的离线终端窗口：它不连接任何会话，录制里的终端查询得到的应答和键盘输入
+    // 不会发给远端，回放的输出也不会进日志或满足脚本的等待
+    delete replayViewer_;
+    const GlobalSettings settings = ConfigManager::instance()->globalSettings();
+    auto *viewer = new QTermWidget();
+    viewer->setAttribute(Qt::WA_DeleteOnClose);
+    viewer->setWindowTitle(tr("回放: %1").arg(QFileInfo(filePath).fileName()));
+    viewer->setTerminalFont(*font_);
+    viewer->setColorScheme(settings.colorScheme);
+    viewer->setScrollBarPosition(ScrollBarRight);
+    viewer->setTableDrivenParser(settings.tableDrivenParser);
+    QObject::connect(viewer, &QTermWidget::replayFinished, this, [this, viewer](qint64 bytes, qint64 msecs) {
+        onReplayFinished(viewer, bytes, msecs);
+    });
+    replayViewer_ = viewer;
+    viewer->show();
+
+    // 录制在开始回放前已全部读入内存
+    QFile file(filePath);
+    QString errorString;
+    bool started = false;
+    if (file.open(QIODevice::ReadOnly)) {
+        started = viewer->startReplay(&file, speed, &errorString);
+    } else {
+        errorString = file.errorString();
+    }
+    if (!started) {
+        viewer->close();
+        QMessageBox::critical(this, tr("错误"),
+            tr("无法回放录制:\n%1\n\n错误: %2").arg(filePath, errorString));
+    }
+}
 
-    // 定期刷新确保数据写入磁盘
-    static int writeCount = 0;
-    if (++writeCount >= 10) {  // 每10次写入刷新一次
-        logFile_->flush();
-        writeCount = 0;
+void BaseTerminal::onReplayFinished(QTermWidget *viewer, qint64 bytes, qint64 msecs) {
+    const double seconds = qMax<qint64>(msecs, 1) / 1000.0;
+    const double mbPerSecond = bytes / seconds / (1024 * 1024);
+    // 帧耗时是最近几帧的滑动平均，包括准备图像和绘制
+    const int frames = viewer->paintedFrames();
+    const double frameMsecs = viewer->frameCostNsecs() / 1000000.0;
+    qDebug() << "Replay finished:" << bytes << "bytes in" << msecs << "ms," << mbPerSecond << "MB/s,"
+             << frames << "frames, frame cost" << frameMsecs << "ms";
+
+    if (replayBenchmark_) {
+        QMessageBox::information(viewer, tr("回放录制"),
+            tr("回放完成。\n数据量: %1 字节\n耗时: %2 毫秒\n吞吐量: %3 MB/s\n绘制帧数: %4\n平均帧耗时: %5 毫秒")
+                .arg(bytes)
+                .arg(msecs)
+                .arg(mbPerSecond, 0, 'f', 2)
+                .arg(frames)
+                .arg(frameMsecs, 0, 'f', 3));
     }
 }
@@ -3,8 +3,10 @@
 
 #include "qtermwidget.h"
 #include "core/datatype.h"
+#include "core/SessionLogWriter.h"
 #include <QFile>
 #include <QMenu>
+#include <QPointer>
 #include <QColorDialog>
 
 class IPtyProcess;
@@ -26,13 +28,17 @@ public:
     bool isLogging() const;
     QString logFilePath() const;
     QString getSessionName() const;
+    // 按全局设置的自动日志目录开始记录，已在记录或用户手动停止过日志时什么都不做
+    void startAutoLogging();
+    // 停止自动打开的日志，用户手动打开的日志继续记录
+    void stopAutoLogging();
 
     signals:
         void onSessionError(BaseTerminal *terminal);
     void loggingStateChanged(bool isLogging);
 
 protected:
-    void onDisplayOutput(const QString &line);
+    void onDisplayOutput(quint64 firstSequence, const QStringList &lines);
     void onCopyAvailable(bool copyAvailable);
 
     // 右键菜单事件
@@ -40,11 +46,16 @@ protected:
 
 private slots:
     void onToggleLogging();
+    void onToggleRecording();
+    void onReplayRecording();
 
 private:
-    void startLogging(const QString &filePath);
+    void startLogging(const QString &filePath, bool interactive = true);
     void stopLogging();
-    void writeToLog(const QString &line);
+    QString logSessionName() const;
+    QString defaultLogFileName() const;
+    static SessionLogWriter::Rotation logRotation(const GlobalSettings &settings);
+    void onReplayFinished(QTermWidget *viewer, qint64 bytes, qint64 msecs);
 
     // 高亮菜单相关方法
     void buildHighlightMenu(QMenu *parentMenu);
@@ -59,8 +70,15 @@ protected:
 private:
     // 日志相关成员
     bool logging_ = false;
-    QFile *logFile_ = nullptr;
+    quint64 logId_ = 0;  // SessionLogWriter 中的文件，0 表示未打开
     QString logFilePath_;
+    bool autoLogging_ = false;           // 当前日志是按自动日志设置打开的
+    bool autoLogStoppedByUser_ = false;  // 用户手动停止过日志
+
+    // 录制相关成员，录制原始输出为 asciicast 文件
+    QFile *recordFile_ = nullptr;
+    bool replayBenchmark_ = false;  // 以最大速度回放时，结束后报告吞吐量
+    QPointer<QTermWidget> replayViewer_;  // 回放用的离线终端窗口，关闭后自动置空
 };
 
 #endif//QSHELL_BASE_TERMINAL_H
@@ -0,0 +1,971 @@
+#include "SSHTerminal.h"
+#include "qtermwidget.h"
+#include <QDebug>
+#include <QMessageBox>
+#include <QCoreApplication>
+#include <QProcess>
+
+#if defined(Q_OS_WIN)
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// ==================== 平台相关的 socket 辅助函数 ====================
+
+static int lastSocketError() {
+#if defined(Q_OS_WIN)
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
+}
+
+static bool isWouldBlock(int err) {
+#if defined(Q_OS_WIN)
+    return err == WSAEWOULDBLOCK;
+#else
+    return err == EAGAIN || err == EWOULDBLOCK || err == EINTR;
+#endif
+}
+
+static void setSocketNonBlocking(libssh2_socket_t sock) {
+#if defined(Q_OS_WIN)
+    u_long nb = 1;
+    ioctlsocket(sock, FIONBIO, &nb);
+#else
+    int flags = fcntl(sock, F_GETFL, 0);
+    fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+#endif
+}
+
+static void setSocketTimeout(libssh2_socket_t sock, int msecs) {
+#if defined(Q_OS_WIN)
+    DWORD timeout = msecs;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+#else
+    struct timeval timeout {};
+    timeout.tv_sec = msecs / 1000;
+    timeout.tv_usec = (msecs % 1000) * 1000;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#endif
+}
+
+// 等待 sock 或 wakeSock 可读，返回 wakeSock 是否可读
+static bool waitSocketReadable(libssh2_socket_t sock, libssh2_socket_t wakeSock, int msecs) {
+#if defined(Q_OS_WIN)
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(sock, &readSet);
+    if (wakeSock != LIBSSH2_INVALID_SOCKET) {
+        FD_SET(wakeSock, &readSet);
+    }
+    struct timeval timeout {};
+    timeout.tv_sec = msecs / 1000;
+    timeout.tv_usec = (msecs % 1000) * 1000;
+    if (select(0, &readSet, nullptr, nullptr, &timeout) <= 0) {
+        return false;
+    }
+    return wakeSock != LIBSSH2_INVALID_SOCKET && FD_ISSET(wakeSock, &readSet);
+#else
+    // poll 而不是 select，fd 可能超过 FD_SETSIZE
+    struct pollfd pfds[2] = { { sock, POLLIN, 0 }, { wakeSock, POLLIN, 0 } };
+    const nfds_t count = wakeSock != LIBSSH2_INVALID_SOCKET ? 2 : 1;
+    if (poll(pfds, count, msecs) <= 0) {
+        return false;
+    }
+    return count == 2 && (pfds[1].revents & POLLIN);
+#endif
+}
+
+// 连到自身的回环 UDP socket，GUI 线程往里发一个字节就能唤醒等待中的 I/O 线程。
+// 用 socket 而不是 pipe，Windows 的 select 也能等待它
+static libssh2_socket_t createWakeSocket() {
+    libssh2_socket_t wakeSock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (wakeSock == LIBSSH2_INVALID_SOCKET) {
+        return LIBSSH2_INVALID_SOCKET;
+    }
+
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = 0;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLen = sizeof(addr);
+    if (::bind(wakeSock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+        || getsockname(wakeSock, reinterpret_cast<sockaddr*>(&addr), &addrLen) != 0
+        || ::connect(wakeSock, reinterpret_cast<sockaddr*>(&addr), addrLen) != 0) {
+        LIBSSH2_SOCKET_CLOSE(wakeSock);
+        return LIBSSH2_INVALID_SOCKET;
+    }
+    setSocketNonBlocking(wakeSock);
+    return wakeSock;
+}
+
+// 关闭 socket 的读写，阻塞在其上的 libssh2 调用会立即出错返回
+static void shutdownSocket(libssh2_socket_t sock) {
+#if defined(Q_OS_WIN)
+    shutdown(sock, SD_BOTH);
+#else
+    shutdown(sock, SHUT_RDWR);
+#endif
+}
+
+// 读取本地 X server 的 MIT-MAGIC-COOKIE-1（xauth 会按 XAUTHORITY 查找授权文件），
+// 远端的 X11 客户端用它通过本地 X server 的认证。读不到时返回空
+static QByteArray localX11Cookie() {
+#if defined(Q_OS_WIN)
+    return {};
+#else
+    QProcess xauth;
+    xauth.start("xauth", {"list", qEnvironmentVariable("DISPLAY")});
+    if (!xauth.waitForFinished(2000) || xauth.exitCode() != 0) {
+        xauth.kill();
+        return {};
+    }
+
+    // 每行形如 "host/unix:0  MIT-MAGIC-COOKIE-1  <十六进制 cookie>"
+    const QList<QByteArray> lines = xauth.readAllStandardOutput().split('\n');
+    for (const QByteArray &line : lines) {
+        const QList<QByteArray> fields = line.simplified().split(' ');
+        if (fields.size() >= 3 && fields.at(1) == "MIT-MAGIC-COOKIE-1") {
+            return fields.at(2);
+        }
+    }
+    return {};
+#endif
+}
+
+// DISPLAY 形如 ":1" 或 ":1.0"，返回屏幕号
+static int localX11Screen() {
+    const QString displayEnv = qEnvironmentVariable("DISPLAY");
+    const int colon = displayEnv.lastIndexOf(':');
+    if (colon < 0) {
+        return 0;
+    }
+    return displayEnv.mid(colon + 1).section('.', 1, 1).toInt();
+}
+
+// ==================== SSHTerminal ====================
+
+SSHTerminal::SSHTerminal(const SessionData &session, QWidget *parent)
+    : BaseTerminal(parent) {
+
+    sessionData_ = session;
+#if defined(Q_OS_WIN)
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+    libssh2_init(0);
+
+    // 终端输入 -> SSH发送
+    QObject::connect(this, &QTermWidget::sendData, [this](const char *data, int size) {
+        sendData(QByteArray(data, size));
+    });
+
+    // 终端大小改变时通知 SSH
+    QObject::connect(this, &QTermWidget::termSizeChange, [this](int lines, int columns) {
+        resizePty(columns, lines);
+    });
+}
+
+SSHTerminal::~SSHTerminal() {
+    disconnect();
+    libssh2_exit();
+#if defined(Q_OS_WIN)
+    WSACleanup();
+#endif
+}
+
+void SSHTerminal::connect() {
+    if (connectThread_) {
+        return;
+    }
+    qDebug() << "Connecting to" << sessionData_.sshConfig.host;
+
+    QString error;
+    if (!createSocket(&error)) {
+        QMessageBox::critical(this, tr("SSH Error"), error);
+        emit onSessionError(this);
+        cleanup();
+        return;
+    }
+
+    // 域名解析、握手和认证都是阻塞调用，放到连接线程里执行，完成后回到 GUI 线程。
+    // 连接期间就算作已连接，用户可以随时断开
+    connect_ = true;
+    connectAborted_ = false;
+    const int serial = ++connectSerial_;
+    const int columns = screenColumnsCount();
+    const int lines = screenLinesCount();
+    connectThread_ = QThread::create([this, serial, columns, lines]() {
+        QString error;
+        // TCP 连接期间已断开时不再握手，结果会被 onConnectFinished 忽略
+        const bool ok = connectToHost(&error)
+                        && !connectAborted_
+                        && initSession(&error)
+                        && verifyHostKey(&error)
+                        && authenticate(&error)
+                        && openChannel(columns, lines, &error);
+        QMetaObject::invokeMethod(this, [this, serial, ok, error]() {
+            onConnectFinished(serial, ok, error);
+        }, Qt::QueuedConnection);
+    });
+    connectThread_->setObjectName("ssh-connect");
+    connectThread_->start();
+}
+
+void SSHTerminal::onConnectFinished(int serial, bool ok, const QString &error) {
+    // 连接完成前已断开或重新连接
+    if (serial != connectSerial_) {
+        return;
+    }
+
+    connectThread_->wait();
+    delete connectThread_;
+    connectThread_ = nullptr;
+
+    if (!ok) {
+        QMessageBox::critical(this, tr("SSH Error"), error);
+        emit onSessionError(this);
+        disconnect();
+        return;
+    }
+
+    // 设置非阻塞模式
+    libssh2_session_set_blocking(session_, 0);
+
+    running_ = true;
+
+    // 创建失败时 I/O 线程退化为每 100ms 检查一次 libssh2 缓存的数据
+    wakeSock_ = createWakeSocket();
+    if (wakeSock_ == LIBSSH2_INVALID_SOCKET) {
+        qWarning() << "Failed to create wake socket:" << lastSocketError();
+    }
+
+    // 在独立的 I/O 线程中读取，大量输出时不阻塞界面
+    readThread_ = QThread::create([this]() {
+        readLoop();
+    });
+    readThread_->setObjectName("ssh-io");
+    readThread_->start();
+
+    // 连接期间终端的大小可能已经改变
+    resizePty(screenColumnsCount(), screenLinesCount());
+
+    qDebug() << "SSH connection established to" << sessionData_.name;
+}
+
+void SSHTerminal::disconnect() {
+    running_ = false;
+    connect_ = false;
+    ++connectSerial_;
+
+    if (connectThread_) {
+        // 让连接线程中阻塞的握手或认证尽快失败返回；域名解析和 TCP 连接无法打断，
+        // 最多等到 socket 超时
+        connectAborted_ = true;
+        shutdownSocket(sock_);
+        connectThread_->wait();
+        delete connectThread_;
+        connectThread_ = nullptr;
+    }
+
+    if (readThread_) {
+        readThread_->requestInterruption();
+        readThread_->wait();
+        delete readThread_;
+        readThread_ = nullptr;
+    }
+
+    if (wakeSock_ != LIBSSH2_INVALID_SOCKET) {
+        LIBSSH2_SOCKET_CLOSE(wakeSock_);
+        wakeSock_ = LIBSSH2_INVALID_SOCKET;
+    }
+
+    cleanup();
+    qDebug() << "SSH disconnected from" << sessionData_.name;
+}
+
+void SSHTerminal::readLoop() {
+    char buffer[65536];
+
+    while (running_ && !QThread::currentThread()->isInterruptionRequested()) {
+        ssize_t bytesRead = 0;
+        bool eof = false;
+        {
+            QMutexLocker locker(&sshMutex_);
+            if (!channel_) {
+                break;
+            }
+
+            // 读取标准输出，没有数据时再读取标准错误
+            bytesRead = libssh2_channel_read(channel_, buffer, sizeof(buffer));
+            if (bytesRead == LIBSSH2_ERROR_EAGAIN || bytesRead == 0) {
+                ssize_t stderrRead = libssh2_channel_read_stderr(channel_, buffer, sizeof(buffer));
+                bytesRead = stderrRead > 0 ? stderrRead : LIBSSH2_ERROR_EAGAIN;
+            }
+            eof = libssh2_channel_eof(channel_);
+        }
+
+        if (bytesRead > 0) {
+            // 不持有锁入队，队列满时 GUI 线程仍可以发送数据
+            enqueueData(buffer, static_cast<int>(bytesRead));
+            continue;
+        }
+
+        // 检查连接是否关闭
+        if (eof || bytesRead != LIBSSH2_ERROR_EAGAIN) {
+            const bool readError = !eof;
+            QMetaObject::invokeMethod(this, [this, readError]() {
+                onChannelClosed(readError);
+            }, Qt::QueuedConnection);
+            break;
+        }
+
+        // shell 数据已读完，X11 子通道的数据可能已被 libssh2 缓存
+        if (x11Active_ && !x11PumpPending_.exchange(true)) {
+            QMetaObject::invokeMethod(this, &SSHTerminal::onX11Activity, Qt::QueuedConnection);
+        }
+
+        // GUI 线程写入或处理 X11 时，libssh2 可能已把 shell 的数据读进内部缓存，
+        // socket 不再可读，所以它在那之后会通过 wakeSock_ 唤醒这里重新读取
+        if (waitSocketReadable(sock_, wakeSock_, 100)) {
+            wakePending_ = false;
+            char drain[64];
+            while (recv(wakeSock_, drain, sizeof(drain), 0) > 0) {
+            }
+        }
+    }
+}
+
+void SSHTerminal::wakeReader() {
+    if (wakeSock_ != LIBSSH2_INVALID_SOCKET && !wakePending_.exchange(true)) {
+        send(wakeSock_, "w", 1, 0);
+    }
+}
+
+void SSHTerminal::onChannelClosed(bool readError) {
+    if (!running_) return;
+
+    if (readError) {
+        QMessageBox::critical(this, tr("SSH Error"), tr("Read error"));
+    } else {
+        QMessageBox::information(this, tr("SSH"), tr("Connection closed by remote host"));
+    }
+    emit onSessionError(this);
+    disconnect();
+}
+
+void SSHTerminal::onX11Activity() {
+    x11PumpPending_ = false;
+    if (!running_) return;
+
+    QMutexLocker locker(&sshMutex_);
+    pumpRemoteX11();       // 远端→本地 累积与下发
+    // 把本地积压（EAGAIN 时未写完）继续推送到远端
+    for (auto *xf : x11Chans_) {
+        flushX11ToRemote(xf);
+    }
+    wakeReader();
+}
+
+QString SSHTerminal::getKnownHostsPath() {
+    QString homePath = QDir::homePath();
+    QString sshDir = homePath + "/.ssh";
+
+    QDir dir(sshDir);
+    if (!dir.exists()) {
+        dir.mkpath(sshDir);
+    }
+
+    return sshDir + "/known_hosts";
+}
+
+bool SSHTerminal::createSocket(QString *error) {
+    sock_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock_ == LIBSSH2_INVALID_SOCKET) {
+        *error = tr("Failed to create socket: %1").arg(lastSocketError());
+        return false;
+    }
+
+    // 设置 socket 超时
+    setSocketTimeout(sock_, 30000);
+
+    // 禁用 Nagle 算法，减少延迟
+    int flag = 1;
+    setsockopt(sock_, IPPROTO_TCP, TCP_NODELAY, (const char*)&flag, sizeof(flag));
+
+    return true;
+}
+
+bool SSHTerminal::connectToHost(QString *error) {
+    struct addrinfo hints = {0};
+    struct addrinfo *result = nullptr;
+
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+
+    QString portStr = QString::number(sessionData_.sshConfig.port);
+
+    int rc = getaddrinfo(
+        sessionData_.sshConfig.host.toUtf8().constData(),
+        portStr.toUtf8().constData(),
+        &hints,
+        &result
+    );
+
+    if (rc != 0) {
+        *error = tr("Failed to resolve hostname '%1'").arg(sessionData_.sshConfig.host);
+        return false;
+    }
+
+    bool connected = false;
+    for (struct addrinfo *ptr = result; ptr != nullptr; ptr = ptr->ai_next) {
+        if (::connect(sock_, ptr->ai_addr, (int)ptr->ai_addrlen) == 0) {
+            connected = true;
+            break;
+        }
+    }
+
+    freeaddrinfo(result);
+
+    if (!connected) {
+        *error = tr("Failed to connect to %1:%2")
+                     .arg(sessionData_.sshConfig.host)
+                     .arg(sessionData_.sshConfig.port);
+        return false;
+    }
+
+    qDebug() << "TCP connected to" << sessionData_.sshConfig.host;
+    return true;
+}
+
+bool SSHTerminal::initSession(QString *error) {
+    session_ = libssh2_session_init();
+    if (!session_) {
+        *error = tr("Failed to create SSH session");
+        return false;
+    }
+
+    libssh2_session_set_blocking(session_, 1);
+    libssh2_session_set_timeout(session_, 30000);
+
+    int rc = libssh2_session_handshake(session_, sock_);
+    if (rc) {
+        char *errmsg = nullptr;
+        libssh2_session_last_error(session_, &errmsg, nullptr, 0);
+        *error = tr("SSH handshake failed: %1").arg(errmsg ? errmsg : "Unknown");
+        return false;
+    }
+
+    // 注册 X11 回调
+    void **abs = libssh2_session_abstract(session_);
+    *abs = this;
+    libssh2_session_callback_set(session_, LIBSSH2_CALLBACK_X11, (void*)x11Callback);
+
+    qDebug() << "SSH handshake completed";
+    return true;
+}
+
+bool SSHTerminal::verifyHostKey(QString *error) {
+    LIBSSH2_KNOWNHOSTS *knownHosts = libssh2_knownhost_init(session_);
+    if (!knownHosts) {
+        qWarning() << "Failed to init known_hosts, continuing anyway";
+        return true;
+    }
+
+    QString knownHostsPath = getKnownHostsPath();
+
+    libssh2_knownhost_readfile(knownHosts, knownHostsPath.toUtf8().constData(),
+                                LIBSSH2_KNOWNHOST_FILE_OPENSSH);
+
+    size_t keyLen = 0;
+    int keyType = 0;
+    const char *key = libssh2_session_hostkey(session_, &keyLen, &keyType);
+
+    if (!key) {
+        libssh2_knownhost_free(knownHosts);
+        *error = tr("Failed to get host key");
+        return false;
+    }
+
+    const char *fingerprint = libssh2_hostkey_hash(session_, LIBSSH2_HOSTKEY_HASH_SHA256);
+    QString fingerprintStr;
+    if (fingerprint) {
+        QByteArray fp(fingerprint, 32);
+        fingerprintStr = fp.toBase64();
+        qDebug() << "Host fingerprint (SHA256):" << fingerprintStr;
+    }
+
+    struct libssh2_knownhost *host = nullptr;
+    int checkResult = libssh2_knownhost_checkp(
+        knownHosts,
+        sessionData_.sshConfig.host.toUtf8().constData(),
+        sessionData_.sshConfig.port,
+        key, keyLen,
+        LIBSSH2_KNOWNHOST_TYPE_PLAIN | LIBSSH2_KNOWNHOST_KEYENC_RAW,
+        &host
+    );
+
+    bool result = true;
+
+    switch (checkResult) {
+        case LIBSSH2_KNOWNHOST_CHECK_MATCH:
+            qDebug() << "Host key verified";
+            break;
+
+        case LIBSSH2_KNOWNHOST_CHECK_NOTFOUND: {
+            qDebug() << "New host, adding to known_hosts";
+
+            int typeFlag = LIBSSH2_KNOWNHOST_TYPE_PLAIN | LIBSSH2_KNOWNHOST_KEYENC_RAW;
+
+            switch (keyType) {
+                case LIBSSH2_HOSTKEY_TYPE_RSA:
+                    typeFlag |= LIBSSH2_KNOWNHOST_KEY_SSHRSA;
+                    break;
+                case LIBSSH2_HOSTKEY_TYPE_DSS:
+                    typeFlag |= LIBSSH2_KNOWNHOST_KEY_SSHDSS;
+                    break;
+#ifdef LIBSSH2_HOSTKEY_TYPE_ECDSA_256
+                case LIBSSH2_HOSTKEY_TYPE_ECDSA_256:
+                    typeFlag |= LIBSSH2_KNOWNHOST_KEY_ECDSA_256;
+                    break;
+                case LIBSSH2_HOSTKEY_TYPE_ECDSA_384:
+                    typeFlag |= LIBSSH2_KNOWNHOST_KEY_ECDSA_384;
+                    break;
+                case LIBSSH2_HOSTKEY_TYPE_ECDSA_521:
+                    typeFlag |= LIBSSH2_KNOWNHOST_KEY_ECDSA_521;
+                    break;
+#endif
+#ifdef LIBSSH2_HOSTKEY_TYPE_ED25519
+                case LIBSSH2_HOSTKEY_TYPE_ED25519:
+                    typeFlag |= LIBSSH2_KNOWNHOST_KEY_ED25519;
+                    break;
+#endif
+                default:
+                    typeFlag |= LIBSSH2_KNOWNHOST_KEY_UNKNOWN;
+                    break;
+            }
+
+            int addResult = libssh2_knownhost_addc(
+                knownHosts,
+                sessionData_.sshConfig.host.toUtf8().constData(),
+                nullptr, key, keyLen,
+                nullptr, 0, typeFlag, nullptr
+            );
+
+            if (addResult == 0) {
+                libssh2_knownhost_writefile(knownHosts, knownHostsPath.toUtf8().constData(),
+                                            LIBSSH2_KNOWNHOST_FILE_OPENSSH);
+                qDebug() << "Host key saved to" << knownHostsPath;
+            }
+            break;
+        }
+
+        case LIBSSH2_KNOWNHOST_CHECK_MISMATCH:
+            *error = tr("WARNING: HOST KEY MISMATCH!\n\n"
+                        "The host key for '%1' has changed.\n"
+                        "This could indicate a man-in-the-middle attack.\n\n"
+                        "Fingerprint: %2\n\n"
+                        "Remove the old entry from:\n%3")
+                         .arg(sessionData_.sshConfig.host)
+                         .arg(fingerprintStr)
+                         .arg(knownHostsPath);
+            result = false;
+            break;
+
+        default:
+            qWarning() << "Known host check returned:" << checkResult;
+            break;
+    }
+
+    libssh2_knownhost_free(knownHosts);
+    return result;
+}
+
+bool SSHTerminal::authenticate(QString *error) {
+    int rc = -1;
+
+    if (!sessionData_.sshConfig.privateKeyPath.isEmpty()) {
+        QFile keyFile(sessionData_.sshConfig.privateKeyPath);
+        if (keyFile.exists()) {
+            qDebug() << "Trying public key authentication";
+
+            QString pubKeyPath = sessionData_.sshConfig.privateKeyPath + ".pub";
+
+            rc = libssh2_userauth_publickey_fromfile(
+                session_,
+                sessionData_.sshConfig.username.toUtf8().constData(),
+                QFile::exists(pubKeyPath) ? pubKeyPath.toUtf8().constData() : nullptr,
+                sessionData_.sshConfig.privateKeyPath.toUtf8().constData(),
+                sessionData_.sshConfig.passphrase.isEmpty() ? nullptr :
+                    sessionData_.sshConfig.passphrase.toUtf8().constData()
+            );
+
+            if (rc == 0) {
+                qDebug() << "Public key authentication successful";
+                return true;
+            }
+            qDebug() << "Public key authentication failed";
+        }
+    }
+
+    if (!sessionData_.sshConfig.password.isEmpty()) {
+        qDebug() << "Trying password authentication";
+
+        rc = libssh2_userauth_password(
+            session_,
+            sessionData_.sshConfig.username.toUtf8().constData(),
+            sessionData_.sshConfig.password.toUtf8().constData()
+        );
+
+        if (rc == 0) {
+            qDebug() << "Password authentication successful";
+            return true;
+        }
+        qDebug() << "Password authentication failed";
+    }
+
+    *error = tr("Authentication failed for user '%1'").arg(sessionData_.sshConfig.username);
+    return false;
+}
+
+bool SSHTerminal::openChannel(int columns, int lines, QString *error) {
+    channel_ = libssh2_channel_open_session(session_);
+    if (!channel_) {
+        char *errmsg = nullptr;
+        libssh2_session_last_error(session_, &errmsg, nullptr, 0);
+        *error = tr("Failed to open channel: %1").arg(errmsg ? errmsg : "Unknown");
+        return false;
+    }
+
+    int rc = libssh2_channel_request_pty(channel_, "xterm-256color");
+    if (rc) {
+        *error = tr("Failed to request PTY");
+        return false;
+    }
+
+    // —— 请求 X11 转发（0=允许多连接）——
+    // 服务端未开启 X11Forwarding 时不影响 shell 的使用。
+    // 把本地 X server 的真实 cookie 交给远端，转发的连接原样送到本地即可通过认证；
+    // 读不到 cookie 时（如 Windows 上的 VcXsrv）由 libssh2 生成随机 cookie
+#if !defined(Q_OS_WIN)
+    if (!qEnvironmentVariableIsEmpty("DISPLAY"))
+#endif
+    {
+        const QByteArray cookie = localX11Cookie();
+        if (cookie.isEmpty()) {
+            rc = libssh2_channel_x11_req(channel_, 0);
+        } else {
+            rc = libssh2_channel_x11_req_ex(channel_, 0, "MIT-MAGIC-COOKIE-1",
+                                            cookie.constData(), localX11Screen());
+        }
+        if (rc) {
+            qWarning() << "X11 forwarding request rejected by" << sessionData_.sshConfig.host;
+        }
+    }
+
+    libssh2_channel_request_pty_size(channel_, columns, lines);
+
+    rc = libssh2_channel_shell(channel_);
+    if (rc) {
+        *error = tr("Failed to start shell");
+        return false;
+    }
+
+    qDebug() << "SSH channel opened";
+    return true;
+}
+
+void SSHTerminal::sendData(const QByteArray &data) {
+    // 先检查 running_，连接线程可能正在写 channel_
+    if (!running_ || !channel_) return;
+
+    const char *ptr = data.constData();
+    int remaining = data.size();
+
+    while (remaining > 0) {
+        ssize_t written = 0;
+        {
+            // 每次写入单独加锁，处理事件循环时不能持有锁
+            QMutexLocker locker(&sshMutex_);
+            if (!channel_) return;
+            written = libssh2_channel_write(channel_, ptr, remaining);
+        }
+        wakeReader();
+
+        if (written == LIBSSH2_ERROR_EAGAIN) {
+            // 处理事件循环，避免死锁
+            QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents, 1);
+            continue;
+        }
+
+        if (written < 0) {
+            QMessageBox::critical(this, tr("SSH Error"), tr("Failed to send data"));
+            emit onSessionError(this);
+            return;
+        }
+
+        ptr += written;
+        remaining -= written;
+    }
+}
+
+void SSHTerminal::resizePty(int cols, int rows) {
+    if (!running_ || !channel_) return;
+
+    {
+        QMutexLocker locker(&sshMutex_);
+        libssh2_channel_request_pty_size(channel_, cols, rows);
+    }
+    wakeReader();
+}
+
+// ====== X11 ======
+
+void SSHTerminal::x11Callback(LIBSSH2_SESSION*,
+                              LIBSSH2_CHANNEL* channel,
+                              char*, int,
+                              void **abstract)
+{
+    auto *self = static_cast<SSHTerminal*>(*abstract);
+    if (!self) return;
+    // 回调发生在 libssh2 调用内部（可能在 I/O 线程且持有锁），转到 GUI 线程建立本地连接
+    QMetaObject::invokeMethod(self, [self, channel]() {
+        self->handleNewX11Channel(channel);
+    }, Qt::QueuedConnection);
+}
+
+libssh2_socket_t SSHTerminal::openLocalX11Socket()
+{
+    int display = 0;
+#if !defined(Q_OS_WIN)
+    // DISPLAY 形如 ":1" 或 ":1.0"，优先使用本地 unix socket
+    const QString displayEnv = qEnvironmentVariable("DISPLAY");
+    const int colon = displayEnv.lastIndexOf(':');
+    if (colon >= 0) {
+        display = displayEnv.mid(colon + 1).section('.', 0, 0).toInt();
+    }
+
+    libssh2_socket_t usock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (usock != LIBSSH2_INVALID_SOCKET) {
+        sockaddr_un uaddr {};
+        uaddr.sun_family = AF_UNIX;
+        snprintf(uaddr.sun_path, sizeof(uaddr.sun_path), "/tmp/.X11-unix/X%d", display);
+        if (::connect(usock, reinterpret_cast<sockaddr*>(&uaddr), sizeof(uaddr)) == 0) {
+            return usock;
+        }
+        LIBSSH2_SOCKET_CLOSE(usock);
+    }
+#endif
+
+    // 连接 127.0.0.1:(6000 + display)（Windows 上为 VcXsrv，DISPLAY :0）
+    libssh2_socket_t xsock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (xsock == LIBSSH2_INVALID_SOCKET) {
+        return LIBSSH2_INVALID_SOCKET;
+    }
+
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(6000 + display);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // 127.0.0.1
+
+    if (::connect(xsock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        LIBSSH2_SOCKET_CLOSE(xsock);
+        return LIBSSH2_INVALID_SOCKET;
+    }
+    return xsock;
+}
+
+void SSHTerminal::handleNewX11Channel(LIBSSH2_CHANNEL *chan)
+{
+    libssh2_socket_t xsock = openLocalX11Socket();
+    if (xsock == LIBSSH2_INVALID_SOCKET) {
+        QMutexLocker locker(&sshMutex_);
+        libssh2_channel_free(chan);
+        qWarning() << "Failed to connect to local X server";
+        return;
+    }
+
+    // 非阻塞
+    setSocketNonBlocking(xsock);
+
+    auto *xf = new X11Forward;
+    xf->chan  = chan;
+    xf->xsock = xsock;
+
+    // 本地 -> 远端：读就绪，从 xsock 读，存入 toRemote，再 flush
+    xf->notifier = new QSocketNotifier((qintptr)xsock, QSocketNotifier::Read, this);
+    QObject::connect(xf->notifier, &QSocketNotifier::activated,
+                     this, [this, xf](qintptr){
+        QMutexLocker locker(&sshMutex_);
+        char buf[16384];
+        for (;;) {
+            int n = (int) recv(xf->xsock, buf, sizeof(buf), 0);
+            if (n > 0) {
+                xf->toRemote.append(buf, n);
+            } else if (n == 0) {
+                if (xf->notifier) xf->notifier->deleteLater();
+                libssh2_channel_send_eof(xf->chan);
+                break;
+            } else {
+                if (isWouldBlock(lastSocketError())) break;
+                if (xf->notifier) xf->notifier->deleteLater();
+                libssh2_channel_send_eof(xf->chan);
+                break;
+            }
+        }
+        flushX11ToRemote(xf);
+    });
+
+    // 远端 -> 本地：写就绪（当 send() 返回 EWOULDBLOCK 时启用）
+    xf->writable = new QSocketNotifier((qintptr)xsock, QSocketNotifier::Write, this);
+    xf->writable->setEnabled(false);
+    QObject::connect(xf->writable, &QSocketNotifier::activated,
+                     this, [this, xf](qintptr){
+        QMutexLocker locker(&sshMutex_);
+        flushX11ToLocal(xf);
+    });
+
+    x11Chans_.push_back(xf);
+    x11Active_ = true;
+    qDebug() << "X11 channel bridged to local X server";
+}
+
+void SSHTerminal::pumpRemoteX11()
+{
+    char buf[16384];
+
+    for (auto it = x11Chans_.begin(); it != x11Chans_.end(); ) {
+        X11Forward *xf = *it;
+
+        // 远端可读 -> 累积到 toLocal
+        for (;;) {
+            ssize_t r = libssh2_channel_read(xf->chan, buf, sizeof(buf));
+            if (r > 0) {
+                xf->toLocal.append(buf, int(r));
+                continue;
+            } else if (r == LIBSSH2_ERROR_EAGAIN) {
+                break;
+            } else { // 关闭或错误
+                if (xf->notifier) xf->notifier->deleteLater();
+                if (xf->writable) xf->writable->deleteLater();
+                if (xf->xsock != LIBSSH2_INVALID_SOCKET) LIBSSH2_SOCKET_CLOSE(xf->xsock);
+                if (xf->chan) libssh2_channel_free(xf->chan);
+                delete xf;
+                it = x11Chans_.erase(it);
+                goto next_iter;
+            }
+        }
+
+        // 将累积的 toLocal 写到本地 X server
+        flushX11ToLocal(xf);
+        ++it;
+    next_iter:
+        ;
+    }
+    x11Active_ = !x11Chans_.empty();
+}
+
+void SSHTerminal::flushX11ToLocal(X11Forward *xf)
+{
+    while (!xf->toLocal.isEmpty()) {
+        int w = (int) send(xf->xsock, xf->toLocal.constData(), xf->toLocal.size(), MSG_NOSIGNAL);
+        if (w > 0) {
+            xf->toLocal.remove(0, w);
+        } else if (w == 0) {
+            if (xf->notifier) xf->notifier->deleteLater();
+            if (xf->writable) xf->writable->deleteLater();
+            LIBSSH2_SOCKET_CLOSE(xf->xsock);
+            libssh2_channel_free(xf->chan);
+            xf->xsock = LIBSSH2_INVALID_SOCKET;
+            break;
+        } else {
+            if (isWouldBlock(lastSocketError())) {
+                if (xf->writable) xf->writable->setEnabled(true);
+                break;
+            }
+            if (xf->notifier) xf->notifier->deleteLater();
+            if (xf->writable) xf->writable->deleteLater();
+            if (xf->xsock != LIBSSH2_INVALID_SOCKET) LIBSSH2_SOCKET_CLOSE(xf->xsock);
+            if (xf->chan) libssh2_channel_free(xf->chan);
+            xf->xsock = LIBSSH2_INVALID_SOCKET;
+            break;
+        }
+    }
+    if (xf->toLocal.isEmpty() && xf->writable) {
+        xf->writable->setEnabled(false);
+    }
+}
+
+void SSHTerminal::flushX11ToRemote(X11Forward *xf)
+{
+    while (!xf->toRemote.isEmpty()) {
+        int w = libssh2_channel_write(xf->chan, xf->toRemote.constData(), xf->toRemote.size());
+        if (w > 0) {
+            xf->toRemote.remove(0, w);
+            continue;
+        } else if (w == LIBSSH2_ERROR_EAGAIN) {
+            break; // 等下一轮 onX11Activity()
+        } else {
+            if (xf->notifier) xf->notifier->deleteLater();
+            if (xf->writable) xf->writable->deleteLater();
+            if (xf->xsock != LIBSSH2_INVALID_SOCKET) LIBSSH2_SOCKET_CLOSE(xf->xsock);
+            if (xf->chan) libssh2_channel_free(xf->chan);
+            xf->xsock = LIBSSH2_INVALID_SOCKET;
+            break;
+        }
+    }
+}
+
+void SSHTerminal::cleanup() {
+    running_ = false;
+    QMutexLocker locker(&sshMutex_);
+
+    // 关闭 X11 子通道与本地 socket
+    for (auto *xf : x11Chans_) {
+        if (xf->notifier) xf->notifier->deleteLater();
+        if (xf->writable) xf->writable->deleteLater();
+        if (xf->chan)     libssh2_channel_free(xf->chan);
+        if (xf->xsock != LIBSSH2_INVALID_SOCKET) LIBSSH2_SOCKET_CLOSE(xf->xsock);
+        delete xf;
+    }
+    x11Chans_.clear();
+    x11Active_ = false;
+
+    if (channel_) {
+        libssh2_channel_send_eof(channel_);
+        libssh2_channel_close(channel_);
+        libssh2_channel_free(channel_);
+        channel_ = nullptr;
+    }
+
+    if (session_) {
+        libssh2_session_disconnect(session_, "Normal shutdown");
+        libssh2_session_free(session_);
+        session_ = nullptr;
+    }
+
+    if (sock_ != LIBSSH2_INVALID_SOCKET) {
+        LIBSSH2_SOCKET_CLOSE(sock_);
+        sock_ = LIBSSH2_INVALID_SOCKET;
+    }
+}
@@ -5,10 +5,15 @@
 #include "core/datatype.h"
 #include <QDir>
 #include <QFile>
+#include <QMutex>
 #include <QSocketNotifier>
+#include <QThread>
+#include <atomic>
 
-#if defined(Q_CC_MSVC)
+#if !defined(QSHELL_SSH_EXPECT_BACKEND)
+#if defined(Q_OS_WIN)
 #include <winsock2.h>
+#endif
 #include <libssh2.h>
 #include <vector>
 #endif
@@ -21,52 +26,74 @@ public:
     void connect() override;
     void disconnect() override;
 
-#if defined(Q_CC_MSVC)
+#if !defined(QSHELL_SSH_EXPECT_BACKEND)
 private:
-    bool createSocket();
-    bool connectToHost();
-    bool initSession();
-    bool verifyHostKey();
-    bool authenticate();
-    bool openChannel();
+    // 连接步骤，失败时返回 false 并把原因写入 error。
+    // 除 createSocket 外都在连接线程中执行，不能访问界面
+    bool createSocket(QString *error);
+    bool connectToHost(QString *error);
+    bool initSession(QString *error);
+    bool verifyHostKey(QString *error);
+    bool authenticate(QString *error);
+    bool openChannel(int columns, int lines, QString *error);
+    // GUI 线程：连接线程结束，serial 不是最近一次连接时忽略
+    void onConnectFinished(int serial, bool ok, const QString &error);
 
     QString getKnownHostsPath();
     void cleanup();
     void sendData(const QByteArray &data);
     void resizePty(int cols, int rows);
-    void readAvailableData();
 
-private slots:
-    void onSocketReadyRead();
+    // I/O 线程：读取 shell 输出并送入终端的接收队列
+    void readLoop();
+    // 任意线程：唤醒在 socket 上等待的 I/O 线程
+    void wakeReader();
+    // GUI 线程：连接被远端关闭或读出错
+    void onChannelClosed(bool readError);
+    // GUI 线程：I/O 线程发现 socket 有数据后处理 X11 子通道
+    void onX11Activity();
 
 private:
-    // ===== X11 Forwarding（Windows） =====
+    // ===== X11 Forwarding =====
     struct X11Forward {
-        LIBSSH2_CHANNEL *chan = nullptr;          // 远端 X11 子通道
-        SOCKET           xsock = INVALID_SOCKET;   // 本地到 VcXsrv 的 TCP
-        QSocketNotifier *notifier = nullptr;       // xsock 可读
-        QSocketNotifier *writable = nullptr;       // xsock 可写（背压用）
-        QByteArray toLocal;                        // 远端→本地 待写缓冲
-        QByteArray toRemote;                       // 本地→远端 待写缓冲
+        LIBSSH2_CHANNEL *chan = nullptr;                  // 远端 X11 子通道
+        libssh2_socket_t xsock = LIBSSH2_INVALID_SOCKET;  // 到本地 X server 的连接
+        QSocketNotifier *notifier = nullptr;              // xsock 可读
+        QSocketNotifier *writable = nullptr;              // xsock 可写（背压用）
+        QByteArray toLocal;                               // 远端→本地 待写缓冲
+        QByteArray toRemote;                              // 本地→远端 待写缓冲
     };
 
     static void x11Callback(LIBSSH2_SESSION *session,
                             LIBSSH2_CHANNEL *channel,
                             char *shost, int sport,
                             void **abstract);
+    static libssh2_socket_t openLocalX11Socket();
     void handleNewX11Channel(LIBSSH2_CHANNEL *chan);
     void pumpRemoteX11();
     void flushX11ToLocal(X11Forward *xf);
     void flushX11ToRemote(X11Forward *xf);
 
 private:
-    SOCKET sock_ = INVALID_SOCKET;
+    libssh2_socket_t sock_ = LIBSSH2_INVALID_SOCKET;
     LIBSSH2_SESSION *session_ = nullptr;
     LIBSSH2_CHANNEL *channel_ = nullptr;
-    bool running_ = false;
-    QSocketNotifier *readNotifier_ = nullptr;
+    std::atomic<bool> running_{false};
+
+    // 执行连接步骤的线程，连接完成后销毁
+    QThread *connectThread_ = nullptr;
+    std::atomic<bool> connectAborted_{false};
+    int connectSerial_ = 0;
+
+    // libssh2 会话不是线程安全的，I/O 线程与 GUI 线程的所有调用都需持有该锁
+    QMutex sshMutex_;
+    QThread *readThread_ = nullptr;
+    libssh2_socket_t wakeSock_ = LIBSSH2_INVALID_SOCKET;
+    std::atomic<bool> wakePending_{false};
 
     std::vector<X11Forward*> x11Chans_;
+    std::atomic<bool> x11Active_{false};
+    std::atomic<bool> x11PumpPending_{false};
 #endif
 };
 
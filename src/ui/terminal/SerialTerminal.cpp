@@ -6,47 +6,76 @@
 SerialTerminal::SerialTerminal(const SessionData &session, QWidget *parent) : BaseTerminal(parent) {
     sessionData_ = session;
 
-    serial_ = new QSerialPort(this);
+    // 串口读写放在独立线程，大量输出时不阻塞界面
+    ioThread_ = new QThread(this);
+    ioThread_->setObjectName("serial-io");
+    serial_ = new QSerialPort();
+    serial_->moveToThread(ioThread_);
+    QObject::connect(ioThread_, &QThread::finished, serial_, &QObject::deleteLater);
+    ioThread_->start();
+
     // 把在终端的输入传给串口
-    QObject::connect(this, &QTermWidget::sendData, [this](const char *data, int size) {
-        serial_->write(data);
+    QObject::connect(this, &QTermWidget::sendData, this, [this](const char *data, int size) {
+        QByteArray bytes(data, size);
+        QMetaObject::invokeMethod(serial_, [this, bytes]() {
+            serial_->write(bytes);
+        }, Qt::QueuedConnection);
     });
 
-    // 把串口传过来的数据传给终端
-    QObject::connect(serial_, &QSerialPort::readyRead, [this]() {
+    // 把串口传过来的数据传给终端（在 I/O 线程中执行）
+    QObject::connect(serial_, &QSerialPort::readyRead, serial_, [this]() {
         const QByteArray data = serial_->readAll();
-        this->recvData(data.data(), (int)data.size());
+        enqueueData(data.constData(), static_cast<int>(data.size()));
     });
 
-    // 串口发生错误时的回调处理
+    // 串口发生错误时的回调处理（回到 GUI 线程）
     QObject::connect(serial_, &QSerialPort::errorOccurred, this, &SerialTerminal::handleError);
 }
 
 SerialTerminal::~SerialTerminal() {
-    delete serial_;
+    // serial_ 在线程结束时通过 deleteLater 释放
+    ioThread_->requestInterruption();
+    ioThread_->quit();
+    ioThread_->wait();
 }
 
 void SerialTerminal::connect() {
-    serial_->setPortName(sessionData_.serialConfig.portName);
-    serial_->setBaudRate(sessionData_.serialConfig.baudRate);
-    serial_->setDataBits(static_cast<QSerialPort::DataBits>(sessionData_.serialConfig.dataBits));
-    serial_->setParity(static_cast<QSerialPort::Parity>(sessionData_.serialConfig.parity));
-    serial_->setStopBits(static_cast<QSerialPort::StopBits>(sessionData_.serialConfig.stopBits));
-    serial_->setFlowControl(static_cast<QSerialPort::FlowControl>(sessionData_.serialConfig.flowControl));
-    if (serial_->open(QIODevice::ReadWrite)) {
+    // 不能阻塞等待 I/O 线程：它可能正卡在 enqueueData() 里等 GUI 线程消费接收队列。
+    // 打开串口投递到 I/O 线程执行，结果再投递回 GUI 线程处理
+    const SerialConfig config = sessionData_.serialConfig;
+    QMetaObject::invokeMethod(serial_, [this, config]() {
+        serial_->setPortName(config.portName);
+        serial_->setBaudRate(config.baudRate);
+        serial_->setDataBits(static_cast<QSerialPort::DataBits>(config.dataBits));
+        serial_->setParity(static_cast<QSerialPort::Parity>(config.parity));
+        serial_->setStopBits(static_cast<QSerialPort::StopBits>(config.stopBits));
+        serial_->setFlowControl(static_cast<QSerialPort::FlowControl>(config.flowControl));
+        const bool opened = serial_->open(QIODevice::ReadWrite);
+        const QString errorString = serial_->errorString();
+        QMetaObject::invokeMethod(this, [this, opened, errorString]() {
+            onOpenFinished(opened, errorString);
+        }, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
+
+    connect_ = true;
+}
+
+void SerialTerminal::onOpenFinished(bool opened, const QString &errorString) {
+    if (opened) {
         qDebug() << "open serial " << sessionData_.name << " sucess";
     } else {
-        QMessageBox::critical(this, tr("Error"), serial_->errorString());
+        QMessageBox::critical(this, tr("Error"), errorString);
     }
-
-    connect_ = true;
 }
 
 void SerialTerminal::disconnect() {
     connect_ = false;
-    if (serial_->isOpen()) {
-        serial_->close();
-    }
+    // 与 connect() 一样只投递不等待，同一线程上的关闭总在之前的打开之后执行
+    QMetaObject::invokeMethod(serial_, [this]() {
+        if (serial_->isOpen()) {
+            serial_->close();
+        }
+    }, Qt::QueuedConnection);
 }
 
 void SerialTerminal::handleError(QSerialPort::SerialPortError error) {
@@ -3,6 +3,7 @@
 
 #include "BaseTerminal.h"
 #include "core/datatype.h"
+#include <QThread>
 #include <QtSerialPort/QSerialPort>
 
 class SerialTerminal : public BaseTerminal {
@@ -14,6 +15,10 @@ public:
 
 private:
     void handleError(QSerialPort::SerialPortError error);
+    // GUI 线程：I/O 线程打开串口后回调
+    void onOpenFinished(bool opened, const QString &errorString);
+    // 串口对象运行在独立的 I/O 线程中，所有操作都需投递到该线程执行
+    QThread *ioThread_ = nullptr;
     QSerialPort *serial_ = nullptr;
 };
 
@@ -998,7 +998,9 @@ bool ConPtyProcess::startProcess(const QString &executable,
             BOOL result = ReadFile(m_hPipeIn, szBuffer, BUFF_SIZE, &dwBytesRead, NULL);
 
             const bool needMoreData = !result && GetLastError() == ERROR_MORE_DATA;
-            if (result || needMoreData) {
+            if ((result || needMoreData) && m_readCallback) {
+                m_readCallback(szBuffer, dwBytesRead);
+            } else if (result || needMoreData) {
                 QMutexLocker locker(&m_bufferMutex);
                 m_buffer.m_readBuffer.append(szBuffer, dwBytesRead);
                 m_buffer.emitReadyRead();
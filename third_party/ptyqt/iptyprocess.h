@@ -4,6 +4,7 @@
 #include <QDebug>
 #include <QString>
 #include <QThread>
+#include <functional>
 
 #ifdef Q_OS_WIN
 #include <QLocalSocket>
@@ -28,6 +29,9 @@ public:
         QList<pidTree_t> children;
     };
 
+    // Receives output on the pty read thread; must be thread-safe
+    using ReadCallback = std::function<void(const char *data, qint64 len)>;
+
     IPtyProcess() = default;
     IPtyProcess(const IPtyProcess &) = delete;
     IPtyProcess &operator=(const IPtyProcess &) = delete;
@@ -48,10 +52,15 @@ public:
     virtual QIODevice *notifier() = 0;
     virtual QByteArray readAll() = 0;
     virtual QString currentDir() = 0;
+    // Returns the number of bytes accepted or -1; input the shell cannot
+    // take at once may be queued and written later
     virtual qint64 write(const QByteArray &byteArray) = 0;
     virtual void moveToThread(QThread *targetThread) = 0;
     virtual bool hasChildProcess() = 0;
     virtual pidTree_t processInfoTree() = 0;
+    // When set (before startProcess), output is handed to the callback on the
+    // read thread instead of being buffered for notifier()/readAll()
+    void setReadCallback(ReadCallback callback) { m_readCallback = std::move(callback); }
     qint64 pid() { return m_pid; }
     QPair<qint16, qint16> size() { return m_size; }
     const QString lastError() { return m_lastError; }
@@ -72,6 +81,7 @@ protected:
     QPair<qint16, qint16> m_size; //cols / rows
     bool m_trace{false};
     PtyInputFlags m_inputFlags;
+    ReadCallback m_readCallback;
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(IPtyProcess::PtyInputFlags)
@@ -1,13 +1,18 @@
 #include "unixptyprocess.h"
 #include <QStandardPaths>
+#include <poll.h>
 
 #include <QDir>
 #include <QFileInfo>
 #include <QCoreApplication>
+#include <QDebug>
+
+//bounds of the adaptive buffer used by the read thread
+static const int READ_BUFFER_MIN_SIZE = 64 * 1024;
+static const int READ_BUFFER_MAX_SIZE = 1024 * 1024;
 
 UnixPtyProcess::UnixPtyProcess()
     : IPtyProcess()
-    , m_readMasterNotify(0)
 {
     m_shellProcess.setWorkingDirectory(QStandardPaths::writableLocation(QStandardPaths::HomeLocation));
 }
@@ -153,28 +158,111 @@ bool UnixPtyProcess::startProcess(const QString &executable,
         return false;
     }
 
-    m_readMasterNotify = new QSocketNotifier(m_shellProcess.m_handleMaster, QSocketNotifier::Read, &m_shellProcess);
-    m_readMasterNotify->setEnabled(true);
-    m_readMasterNotify->moveToThread(m_shellProcess.thread());
-    QObject::connect(m_readMasterNotify, &QSocketNotifier::activated, [this](int socket)
+    //the read thread drains the master until EAGAIN and only then sleeps in poll(),
+    //so a flood costs one read() per few KB and no poll() per chunk
+    rc = fcntl(m_shellProcess.m_handleMaster, F_SETFL, fcntl(m_shellProcess.m_handleMaster, F_GETFL) | O_NONBLOCK);
+    if (rc == -1)
     {
-        Q_UNUSED(socket)
+        m_lastError = QString("UnixPty Error: unable to set non-blocking master -> %1").arg(strerror(errno));
+        kill();
+        return false;
+    }
+
+    //input the shell does not take at once waits until the master is writable again
+    m_writeNotifier = new QSocketNotifier(m_shellProcess.m_handleMaster, QSocketNotifier::Write);
+    m_writeNotifier->setEnabled(false);
+    QObject::connect(m_writeNotifier, &QSocketNotifier::activated, [this]() { flushWriteQueue(); });
 
-        QByteArray buffer;
-        int size = 1025;
-        int readSize = 1024;
-        QByteArray data;
-        do
+    //this code runned in separate thread, so a busy shell never blocks the gui thread
+    m_readThread = QThread::create([this]()
+    {
+        const int masterFd = m_shellProcess.m_handleMaster;
+        //one reusable buffer: it starts small and grows while the shell keeps
+        //filling it, so bulk output is handed over in few large blocks
+        QByteArray buffer(READ_BUFFER_MIN_SIZE, Qt::Uninitialized);
+        int fullReads = 0;
+        int idleReads = 0;
+        bool drained = true;
+
+        while (!QThread::currentThread()->isInterruptionRequested())
         {
-            char nativeBuffer[size];
-            int len = ::read(m_shellProcess.m_handleMaster, nativeBuffer, readSize);
-            data = QByteArray(nativeBuffer, len);
-            buffer.append(data);
-        } while (data.size() == readSize); //last data block always < readSize
-
-        m_shellReadBuffer.append(buffer);
-        m_shellProcess.emitReadyRead();
+            if (drained)
+            {
+                // wake up periodically to notice interruption requests
+                struct pollfd pfd = { masterFd, POLLIN, 0 };
+                int rc = ::poll(&pfd, 1, 100);
+                if (rc == 0 || (rc < 0 && errno == EINTR))
+                    continue;
+                if (rc < 0)
+                    break;
+            }
+
+            //a pty read returns at most a few KB, keep reading until the master
+            //would block or the buffer is full instead of handing over every piece
+            char *data = buffer.data();
+            const qint64 capacity = buffer.size();
+            qint64 filled = 0;
+            bool closed = false;
+            drained = false;
+            while (filled < capacity)
+            {
+                ssize_t len = ::read(masterFd, data + filled, capacity - filled);
+                if (len > 0)
+                {
+                    filled += len;
+                    continue;
+                }
+                if (len < 0 && errno == EINTR)
+                    continue;
+                if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                {
+                    drained = true;
+                    break;
+                }
+                closed = true; //EIO: the slave side has been closed
+                break;
+            }
+
+            if (filled > 0)
+            {
+                if (m_readCallback)
+                {
+                    //the consumer copies what it needs, no intermediate buffers here
+                    m_readCallback(data, filled);
+                }
+                else
+                {
+                    QMutexLocker locker(&m_bufferMutex);
+                    m_shellReadBuffer.append(data, filled);
+                    m_shellProcess.emitReadyRead();
+                }
+            }
+            if (closed)
+                break;
+
+            //adapt the buffer size to the output rate
+            if (filled == capacity)
+            {
+                idleReads = 0;
+                if (++fullReads >= 2 && capacity < READ_BUFFER_MAX_SIZE)
+                {
+                    buffer.resize(capacity * 2);
+                    fullReads = 0;
+                }
+            }
+            else if (filled < capacity / 4)
+            {
+                fullReads = 0;
+                if (++idleReads >= 64 && capacity > READ_BUFFER_MIN_SIZE)
+                {
+                    buffer.resize(capacity / 2);
+                    buffer.squeeze();
+                    idleReads = 0;
+                }
+            }
+        }
     });
+    m_readThread->start();
 
     QStringList defaultVars;
 
@@ -242,8 +330,29 @@ bool UnixPtyProcess::resize(qint16 cols, qint16 rows)
     return res;
 }
 
+void UnixPtyProcess::stopReadThread()
+{
+    if (m_readThread)
+    {
+        //the thread notices the request within one poll timeout, also while it
+        //waits for space in the consumer's queue, so it can be joined safely
+        m_readThread->requestInterruption();
+        m_readThread->wait();
+        delete m_readThread;
+        m_readThread = nullptr;
+    }
+}
+
 bool UnixPtyProcess::kill()
 {
+    //stop reading before the master fd is closed and possibly reused
+    stopReadThread();
+
+    delete m_writeNotifier;
+    m_writeNotifier = nullptr;
+    m_writeQueue.clear();
+    m_writeOffset = 0;
+
     m_shellProcess.m_handleSlaveName = QString();
     if (m_shellProcess.m_handleSlave >= 0)
     {
@@ -258,9 +367,6 @@ bool UnixPtyProcess::kill()
 
     if (m_shellProcess.state() == QProcess::Running)
     {
-        m_readMasterNotify->disconnect();
-        m_readMasterNotify->deleteLater();
-
         m_shellProcess.terminate();
         m_shellProcess.waitForFinished(1000);
 
@@ -300,19 +406,58 @@ QIODevice *UnixPtyProcess::notifier()
 
 QByteArray UnixPtyProcess::readAll()
 {
-    QByteArray tmpBuffer =  m_shellReadBuffer;
-    m_shellReadBuffer.clear();
+    QByteArray tmpBuffer;
+    {
+        QMutexLocker locker(&m_bufferMutex);
+        tmpBuffer.swap(m_shellReadBuffer);
+    }
     return tmpBuffer;
 }
 
 qint64 UnixPtyProcess::write(const QByteArray &byteArray)
 {
-    int result = ::write(m_shellProcess.m_handleMaster, byteArray.constData(), byteArray.size());
-    Q_UNUSED(result)
-
+    if (m_shellProcess.m_handleMaster < 0)
+        return -1;
+
+    //the master is non-blocking for the read thread, so a large paste is taken
+    //in pieces: what does not fit now is queued behind earlier input and
+    //written once the shell has read some of it, nothing is dropped
+    m_writeQueue.append(byteArray);
+    flushWriteQueue();
     return byteArray.size();
 }
 
+void UnixPtyProcess::flushWriteQueue()
+{
+    while (m_writeOffset < m_writeQueue.size())
+    {
+        ssize_t len = ::write(m_shellProcess.m_handleMaster, m_writeQueue.constData() + m_writeOffset,
+                              m_writeQueue.size() - m_writeOffset);
+        if (len > 0)
+        {
+            m_writeOffset += len;
+            continue;
+        }
+        if (len < 0 && errno == EINTR)
+            continue;
+        if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+
+        qWarning() << "UnixPty: unable to write to the shell, dropping" << m_writeQueue.size() - m_writeOffset
+                   << "bytes:" << strerror(errno);
+        m_writeOffset = m_writeQueue.size();
+        break;
+    }
+
+    if (m_writeOffset == m_writeQueue.size())
+    {
+        m_writeQueue.clear();
+        m_writeOffset = 0;
+    }
+    if (m_writeNotifier)
+        m_writeNotifier->setEnabled(!m_writeQueue.isEmpty());
+}
+
 QString UnixPtyProcess::currentDir()
 {
     return QDir::currentPath();
@@ -390,5 +535,7 @@ bool UnixPtyProcess::isAvailable()
 void UnixPtyProcess::moveToThread(QThread *targetThread)
 {
     m_shellProcess.moveToThread(targetThread);
+    if (m_writeNotifier)
+        m_writeNotifier->moveToThread(targetThread);
 }
 
@@ -2,6 +2,7 @@
 #define UNIXPTYPROCESS_H
 
 #include "iptyprocess.h"
+#include <QMutex>
 #include <QProcess>
 #include <QSocketNotifier>
 
@@ -117,8 +118,15 @@ public:
     void moveToThread(QThread *targetThread);
 
 private:
+    void stopReadThread();
+    void flushWriteQueue();
+
     ShellProcess m_shellProcess;
-    QSocketNotifier *m_readMasterNotify;
+    QThread *m_readThread{nullptr};
+    QSocketNotifier *m_writeNotifier{nullptr};
+    QByteArray m_writeQueue;   //input the shell has not taken yet
+    qint64 m_writeOffset{0};   //bytes of m_writeQueue already written
+    QMutex m_bufferMutex;
     QByteArray m_shellReadBuffer;
 };
 
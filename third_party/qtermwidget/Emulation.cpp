@@ -22,8 +22,13 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <string>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include <QApplication>
 #include <QClipboard>
 #include <QHash>
@@ -50,8 +55,10 @@ Emulation::Emulation()
     _screen[1] = new Screen(40, 80);
     _currentScreen = _screen[0];
 
-    connect(&_bulkTimer1, &QTimer::timeout, this, &Emulation::showBulk);
-    connect(&_bulkTimer2, &QTimer::timeout, this, &Emulation::showBulk);
+    // lines dropped by the history memory budget move the screen windows
+    // just like new output does
+    connect(_screen[0], &Screen::historyTrimmed, this, &Emulation::bufferedUpdate);
+    connect(_screen[1], &Screen::historyTrimmed, this, &Emulation::bufferedUpdate);
 
     // listen for mouse status changes
     connect(this, &Emulation::programUsesMouseChanged, this,
@@ -141,6 +148,30 @@ const HistoryType &Emulation::history() const {
     return _screen[0]->getScroll();
 }
 
+qint64 Emulation::historyMemoryUsage() const {
+    return _screen[0]->historyMemoryUsage();
+}
+
+void Emulation::markHistoryViewed() {
+    _screen[0]->markHistoryViewed();
+}
+
+bool Emulation::findCandidateLines(const QStringList &literals, QVector<QPair<int, int>> *ranges) const {
+    return _currentScreen->findCandidateLines(literals, ranges);
+}
+
+ScreenSnapshot Emulation::snapshot() const {
+    return _currentScreen->snapshot();
+}
+
+int Emulation::droppedLinesSince(const ScreenSnapshot &snapshot) const {
+    // the current screen may have changed since, e.g. to the alternate one
+    const Screen *screen = snapshot.screen();
+    if (screen != _screen[0] && screen != _screen[1])
+        return 0;
+    return screen->droppedLinesSince(snapshot);
+}
+
 void Emulation::setCodec(QStringEncoder qtc) {
     if (qtc.isValid())
         _fromUtf16 = std::move(qtc);
@@ -149,6 +180,8 @@ void Emulation::setCodec(QStringEncoder qtc) {
 
     _toUtf16 = QStringDecoder{utf8() ? QStringConverter::Encoding::Utf8
                                     : QStringConverter::Encoding::System};
+    _utf8Input = utf8();
+    _utf8Pending = 0;
     emit useUtf8Request(utf8());
 }
 
@@ -219,6 +252,30 @@ void Emulation::sendMouseEvent(int /*buttons*/, int /*column*/, int /*row*/,
     // default implementation does nothing
 }
 
+// returns the first byte in [text, end) which is not 7-bit ASCII
+static const uchar *skipAscii(const uchar *text, const uchar *end) {
+#if defined(__SSE2__)
+    while (end - text >= 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text));
+        const int mask = _mm_movemask_epi8(block);
+        if (mask != 0)
+            return text + qCountTrailingZeroBits(static_cast<quint32>(mask));
+        text += 16;
+    }
+#else
+    while (end - text >= 8) {
+        quint64 block;
+        memcpy(&block, text, sizeof(block));
+        if (block & Q_UINT64_C(0x8080808080808080))
+            break;
+        text += 8;
+    }
+#endif
+    while (text < end && *text < 0x80)
+        ++text;
+    return text;
+}
+
 /*
    We are doing code conversion from locale to unicode first.
    TODO: Character composition from the old code.  See #96536
@@ -228,6 +285,11 @@ void Emulation::receiveData(const char *text, int length) {
 
     bufferedUpdate();
 
+    if (_utf8Input) {
+        receiveUtf8(text, length);
+        return;
+    }
+
     /* XXX: the following code involves encoding & decoding of "UTF-16
     * surrogate pairs", which does not work with characters higher than
     * U+10FFFF
@@ -237,8 +299,7 @@ void Emulation::receiveData(const char *text, int length) {
     std::wstring unicodeText = utf16Text.toStdWString();
 
     // send characters to terminal emulator
-    for (wchar_t i : unicodeText)
-        receiveChar(i);
+    receiveChars(unicodeText.data(), static_cast<int>(unicodeText.size()));
 
     // look for z-modem indicator
     //-- someone who understands more about z-modems that I do may be able to move
@@ -257,6 +318,114 @@ void Emulation::receiveData(const char *text, int length) {
     }
 }
 
+void Emulation::receiveChars(const wchar_t *chars, int count) {
+    for (int i = 0; i < count; ++i)
+        receiveChar(chars[i]);
+}
+
+/*
+ * Single pass over the raw bytes: runs of ASCII found by skipAscii() are
+ * widened into a small stack batch, multi-byte sequences are assembled in
+ * place and the z-modem indicators are looked for while walking the ASCII
+ * runs, so no QString or std::wstring is built.  The batch is handed to
+ * receiveChars() whenever it fills up.  Malformed input is replaced by
+ * U+FFFD like QStringDecoder does.
+ */
+void Emulation::receiveUtf8(const char *text, int length) {
+    constexpr int BATCH_SIZE = 1024;
+    wchar_t batch[BATCH_SIZE];
+    int batched = 0;
+
+    const auto appendCodePoint = [&](uint codePoint) {
+        if (batched + 2 > BATCH_SIZE) {
+            receiveChars(batch, batched);
+            batched = 0;
+        }
+        if (sizeof(wchar_t) == 2 && codePoint > 0xFFFF) {
+            // match what QString::toStdWString() hands out on Windows
+            codePoint -= 0x10000;
+            batch[batched++] = static_cast<wchar_t>(0xD800 + (codePoint >> 10));
+            batch[batched++] = static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF));
+        } else {
+            batch[batched++] = static_cast<wchar_t>(codePoint);
+        }
+    };
+
+    const auto *p = reinterpret_cast<const uchar *>(text);
+    const auto *end = p + length;
+    bool zmodemSend = false;
+    bool zmodemRecv = false;
+
+    while (p < end) {
+        if (_utf8Pending == 0) {
+            const uchar *runEnd = skipAscii(p, end);
+            for (; p < runEnd; ++p) {
+                if (*p == '\030') {
+                    const auto *marker = reinterpret_cast<const char *>(p) + 1;
+                    const auto remaining = end - p - 1;
+                    // ZRQINIT 0 Request receive init
+                    if (remaining > 3 && strncmp(marker, "B00", 3) == 0)
+                        zmodemSend = true;
+                    // ZRINIT	1	 Receive init
+                    if (remaining > 5 && strncmp(marker, "B0100", 5) == 0)
+                        zmodemRecv = true;
+                }
+                if (batched == BATCH_SIZE) {
+                    receiveChars(batch, batched);
+                    batched = 0;
+                }
+                batch[batched++] = *p;
+            }
+            if (p == end)
+                break;
+        }
+
+        const uchar c = *p;
+        if (_utf8Pending > 0) {
+            if ((c & 0xC0) != 0x80) {
+                // truncated sequence, the current byte starts something new
+                _utf8Pending = 0;
+                appendCodePoint(0xFFFD);
+                continue;
+            }
+            ++p;
+            _utf8CodePoint = (_utf8CodePoint << 6) | (c & 0x3F);
+            if (--_utf8Pending == 0) {
+                const bool valid = _utf8CodePoint >= _utf8MinCodePoint
+                                   && _utf8CodePoint <= 0x10FFFF
+                                   && (_utf8CodePoint < 0xD800 || _utf8CodePoint > 0xDFFF);
+                appendCodePoint(valid ? _utf8CodePoint : 0xFFFD);
+            }
+            continue;
+        }
+
+        ++p;
+        if (c >= 0xC2 && c <= 0xDF) {
+            _utf8CodePoint = c & 0x1F;
+            _utf8MinCodePoint = 0x80;
+            _utf8Pending = 1;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            _utf8CodePoint = c & 0x0F;
+            _utf8MinCodePoint = 0x800;
+            _utf8Pending = 2;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            _utf8CodePoint = c & 0x07;
+            _utf8MinCodePoint = 0x10000;
+            _utf8Pending = 3;
+        } else {
+            appendCodePoint(0xFFFD);
+        }
+    }
+
+    if (batched > 0)
+        receiveChars(batch, batched);
+
+    if (zmodemSend)
+        emit zmodemSendDetected();
+    if (zmodemRecv)
+        emit zmodemRecvDetected();
+}
+
 void Emulation::writeToStream(TerminalCharacterDecoder *_decoder, int startLine,
                               int endLine) {
     _currentScreen->writeLinesToStream(_decoder, startLine, endLine);
@@ -268,8 +437,7 @@ int Emulation::lineCount() const {
 }
 
 void Emulation::showBulk() {
-    _bulkTimer1.stop();
-    _bulkTimer2.stop();
+    _updatePending = false;
 
     emit outputChanged();
 
@@ -278,14 +446,11 @@ void Emulation::showBulk() {
 }
 
 void Emulation::bufferedUpdate() {
-    static const int BULK_TIMEOUT1 = 10;
-    static const int BULK_TIMEOUT2 = 40;
-
-    _bulkTimer1.setSingleShot(true);
-    _bulkTimer1.start(BULK_TIMEOUT1);
-    if (!_bulkTimer2.isActive()) {
-        _bulkTimer2.setSingleShot(true);
-        _bulkTimer2.start(BULK_TIMEOUT2);
+    // only the bookkeeping of the screen windows happens per update, the
+    // views decide when to repaint
+    if (!_updatePending) {
+        _updatePending = true;
+        QMetaObject::invokeMethod(this, &Emulation::showBulk, Qt::QueuedConnection);
     }
 }
 
@@ -342,6 +507,8 @@ bool ExtendedCharTable::extendedCharMatch(uint hash , uint* unicodePoints , usho
 }
 
 uint ExtendedCharTable::createExtendedChar(uint* unicodePoints , ushort length) {    
+    QWriteLocker locker(&_lock);
+
     // look for this sequence of points in the table
     uint hash = extendedCharHash(unicodePoints,length);
     const uint initialHash = hash;
@@ -402,6 +569,7 @@ uint ExtendedCharTable::createExtendedChar(uint* unicodePoints , ushort length)
 uint* ExtendedCharTable::lookupExtendedChar(uint hash , ushort& length) const {
     // lookup index in table and if found, set the length
     // argument and return a pointer to the character sequence
+    QReadLocker locker(&_lock);
     uint* buffer = extendedCharTable[hash];
     if (buffer) {
         length = buffer[0];
@@ -34,6 +34,7 @@
 
 class HistoryType;
 class Screen;
+class ScreenSnapshot;
 class ScreenWindow;
 class TerminalCharacterDecoder;
 
@@ -168,6 +169,22 @@ public:
     const HistoryType& history() const;
     /** Clears the history scroll. */
     void clearHistory();
+    /** Returns the number of bytes used by the history scroll. */
+    qint64 historyMemoryUsage() const;
+    /**
+     * Marks the history as recently viewed.  The shared history memory
+     * budget trims the histories which were viewed least recently first.
+     */
+    void markHistoryViewed();
+    /**
+     * Computes the ranges of lines which may contain all of @p literals,
+     * see Screen::findCandidateLines().
+     */
+    bool findCandidateLines(const QStringList &literals, QVector<QPair<int, int>> *ranges) const;
+    /** Takes a snapshot of the current screen, see Screen::snapshot(). */
+    ScreenSnapshot snapshot() const;
+    /** See Screen::droppedLinesSince(), counted on the screen @p snapshot was taken of. */
+    int droppedLinesSince(const ScreenSnapshot &snapshot) const;
 
     /**
      * Copies the output history from @p startLine to @p endLine
@@ -267,9 +284,9 @@ public slots:
      * character buffer using the current codec(), and then calls receiveChar() for
      * each unicode character in the resulting buffer.
      *
-     * receiveData() also starts a timer which causes the outputChanged() signal
-     * to be emitted when it expires.  The timer allows multiple updates in quick
-     * succession to be buffered into a single outputChanged() signal emission.
+     * receiveData() also schedules the outputChanged() signal to be emitted once
+     * control returns to the event loop, so that multiple updates in quick
+     * succession are buffered into a single outputChanged() signal emission.
      *
      * @param buffer A string of characters received from the terminal program.
      * @param len The length of @p buffer
@@ -342,9 +359,9 @@ signals:
 
     /**
      * Emitted when the contents of the screen image change.
-     * The emulation buffers the updates from successive image changes,
-     * and only emits outputChanged() at sensible intervals when
-     * there is a lot of terminal activity.
+     * The emulation buffers the updates from successive image changes
+     * and emits outputChanged() once control returns to the event loop.
+     * The views attached to the screen windows pace their repaints.
      *
      * Normally there is no need for objects other than the screen windows
      * created with createWindow() to listen for this signal.
@@ -455,6 +472,13 @@ protected:
      */
     virtual void receiveChar(wchar_t ch);
 
+    /**
+     * Processes @p count incoming characters.  The default implementation
+     * calls receiveChar() for each of them, emulations may override it to
+     * handle runs of characters at once.
+     */
+    virtual void receiveChars(const wchar_t *chars, int count);
+
     /**
      * Sets the active screen.  The terminal has two screens, primary and alternate.
      * The primary screen is used by default.  When certain interactive programs such
@@ -492,8 +516,9 @@ protected:
 protected slots:
     /**
      * Schedules an update of attached views.
-     * Repeated calls to bufferedUpdate() in close succession will result in only a single update,
-     * much like the Qt buffered update of widgets.
+     * Repeated calls to bufferedUpdate() before control returns to the event loop
+     * result in only a single update.  The views pace their own repaints, see
+     * TerminalDisplay::scheduleFrame().
      */
     void bufferedUpdate();
     
@@ -511,12 +536,21 @@ private slots:
     void bracketedPasteModeChanged(bool bracketedPasteMode);
 
 private:
+    // decodes UTF-8 straight into receiveChars() calls, see receiveData()
+    void receiveUtf8(const char *text, int length);
+
     bool _usesMouse;
     bool _bracketedPasteMode;
-    QTimer _bulkTimer1{this};
-    QTimer _bulkTimer2{this};
+    bool _updatePending = false;
     QStringEncoder _fromUtf8;
     QByteArray dupCache;
+
+    // UTF-8 decoder state, kept across receiveData() calls so that a
+    // multi-byte sequence may be split between two chunks
+    bool _utf8Input = false;
+    uint _utf8CodePoint = 0;
+    uint _utf8MinCodePoint = 0;
+    int _utf8Pending = 0;
 };
 
 #endif // EMULATION_H
@@ -21,6 +21,7 @@
 */
 #include "Screen.h"
 
+#include <algorithm>
 #include <cctype>
 #include <cstdio>
 #include <cstdlib>
@@ -62,6 +63,9 @@ Screen::Screen(int l, int c)
     lineProperties.resize(lines + 1);
     for (int i = 0; i < lines + 1; i++)
             lineProperties[i] = LINE_DEFAULT;
+    _lineGenerations.resize(lines + 1);
+    std::fill(_lineGenerations.begin(), _lineGenerations.end(), 0);
+    history->setTrimmedHandler([this](int count) { historyTrimmedBy(count); });
 
     initTabStops();
     clearSelection();
@@ -162,22 +166,37 @@ void Screen::index() {
         cuY += 1;
     }
 
-    QString result;
-    QTextStream stream(&result, QIODevice::ReadWrite);
-
-    PlainTextDecoder decoder;
-    decoder.begin(&stream);
-    copyLineToStream( startLine,
-                      0,
-                      -1,
-                      &decoder,
-                      false,
-                      false );
-    decoder.end();
-    emit onNewLine(result);
+    // only decode the line when somebody listens for it, see setLineCaptureEnabled()
+    if (_lineCaptureEnabled) {
+        QString result;
+        QTextStream stream(&result, QIODevice::ReadWrite);
+
+        PlainTextDecoder decoder;
+        decoder.begin(&stream);
+        copyLineToStream( startLine,
+                          0,
+                          -1,
+                          &decoder,
+                          false,
+                          false );
+        decoder.end();
+        _capturedLines.append(result);
+    }
     //qiushao patch end
 }
 
+void Screen::setLineCaptureEnabled(bool enable) {
+    _lineCaptureEnabled = enable;
+    if (!enable)
+        _capturedLines.clear();
+}
+
+QStringList Screen::takeCapturedLines() {
+    QStringList lines;
+    lines.swap(_capturedLines);
+    return lines;
+}
+
 void Screen::reverseIndex() {
     if (cuY == _topMargin)
         scrollDown(_topMargin, 1);
@@ -215,6 +234,7 @@ void Screen::deleteChars(int n) {
     Q_ASSERT(cuX + n <= screenLines[cuY].count());
 
     screenLines[cuY].remove(cuX, n);
+    markLinesDirty(cuY, cuY);
 }
 
 void Screen::insertChars(int n) {
@@ -228,6 +248,7 @@ void Screen::insertChars(int n) {
 
     if (screenLines[cuY].count() > columns)
         screenLines[cuY].resize(columns);
+    markLinesDirty(cuY, cuY);
 }
 
 void Screen::repeatChars(int count) {
@@ -326,6 +347,8 @@ void Screen::resizeImage(int new_lines, int new_columns) {
     lineProperties.resize(new_lines + 1);
     for (int i = lines; (i > 0) && (i < new_lines + 1); i++)
         lineProperties[i] = LINE_DEFAULT;
+    _lineGenerations.resize(new_lines + 1);
+    markAllLinesDirty();
 
     clearSelection();
 
@@ -485,6 +508,24 @@ void Screen::getImage(Character *dest, int size, int startLine,
         dest[cursorIndex].rendition |= RE_CURSOR;
 }
 
+void Screen::getImageLine(Character *dest, int line) const {
+    Q_ASSERT(line >= 0 && line < history->getLines() + lines);
+
+    const int histLines = history->getLines();
+    if (line < histLines)
+        copyFromHistory(dest, line, 1);
+    else
+        copyFromScreen(dest, line - histLines, 1);
+
+    if (getMode(MODE_Screen)) {
+        for (int i = 0; i < columns; i++)
+            reverseRendition(dest[i]);
+    }
+
+    if (getMode(MODE_Cursor) && line == histLines + cuY && cuX < columns)
+        dest[cuX].rendition |= RE_CURSOR;
+}
+
 QVector<LineProperty> Screen::getLineProperties(int startLine,
                                                                                                 int endLine) const {
     Q_ASSERT(startLine >= 0);
@@ -548,8 +589,10 @@ void Screen::backspace() {
     cuX = qMin(columns - 1, cuX); // nowrap!
     cuX = qMax(0, cuX - 1);
 
-    if (screenLines[cuY].size() < cuX + 1)
+    if (screenLines[cuY].size() < cuX + 1) {
         screenLines[cuY].resize(cuX + 1);
+        markLinesDirty(cuY, cuY);
+    }
 #if 0 // TODO: implement when unicode_width is fixed, we need more
     // backspace/cursorMove
     wchar_t c = 0;
@@ -697,6 +740,7 @@ void Screen::displayCharacter(wchar_t c) {
                 currentChar.character = ExtendedCharTable::instance.createExtendedChar(chars.get(), extendedCharLength + 1);
             }
         }
+        markLinesDirty(charToCombineWithY, charToCombineWithY);
         return;
     }
 
@@ -724,6 +768,8 @@ notcombine:
     // check if selection is still valid.
     checkSelection(lastPos, lastPos);
 
+    markLinesDirty(cuY, cuY);
+
     Character &currentChar = screenLines[cuY][cuX];
 
     currentChar.character = c;
@@ -752,6 +798,64 @@ notcombine:
     cuX = newCursorX;
 }
 
+// printable ASCII needs no lookup in the unicode tables
+static inline bool isSingleWidth(wchar_t c) {
+    return (c >= 0x20 && c < 0x7f) || CharWidth::unicode_width(c) == 1;
+}
+
+void Screen::displayCharacters(const wchar_t *chars, int count) {
+    if (getMode(MODE_Insert)) {
+        for (int i = 0; i < count; ++i)
+            displayCharacter(chars[i]);
+        return;
+    }
+
+    int i = 0;
+    while (i < count) {
+        // wide, combining and non-printable characters take the general path
+        if (!isSingleWidth(chars[i])) {
+            displayCharacter(chars[i++]);
+            continue;
+        }
+
+        // wrap before putting the character, see displayCharacter()
+        if (cuX + 1 > columns) {
+            if (getMode(MODE_Wrap)) {
+                lineProperties[cuY] = (LineProperty)(lineProperties[cuY] | LINE_WRAPPED);
+                nextLine();
+            } else {
+                cuX = columns - 1;
+            }
+        }
+
+        // the longest run of single-width characters which fits on this line
+        const int room = qMax(columns - cuX, 1);
+        int n = 1;
+        while (n < room && i + n < count && isSingleWidth(chars[i + n]))
+            ++n;
+
+        ImageLine &line = screenLines[cuY];
+        if (line.size() < cuX + n)
+            line.resize(cuX + n);
+
+        lastPos = loc(cuX + n - 1, cuY);
+        checkSelection(loc(cuX, cuY), lastPos);
+        markLinesDirty(cuY, cuY);
+
+        Character *cell = line.data() + cuX;
+        for (int k = 0; k < n; ++k, ++cell) {
+            cell->character = chars[i + k];
+            cell->foregroundColor = effectiveForeground;
+            cell->backgroundColor = effectiveBackground;
+            cell->rendition = effectiveRendition;
+        }
+
+        lastDrawnChar = chars[i + n - 1];
+        cuX += n;
+        i += n;
+    }
+}
+
 void Screen::compose(const QString & /*compose*/) {
     Q_ASSERT(0 /*Not implemented yet*/);
 
@@ -859,6 +963,7 @@ void Screen::clearImage(int loca, int loce, char c) {
 
     int topLine = loca / columns;
     int bottomLine = loce / columns;
+    markLinesDirty(topLine, bottomLine);
 
     Character clearCh(c, currentForeground, currentBackground, DEFAULT_RENDITION);
 
@@ -891,6 +996,7 @@ void Screen::moveImage(int dest, int sourceBegin, int sourceEnd) {
     Q_ASSERT(sourceBegin <= sourceEnd);
 
     int lines = (sourceEnd - sourceBegin) / columns;
+    markLinesDirty(dest / columns, dest / columns + lines);
 
     // move screen image and line properties:
     // the source and destination areas of the image may overlap,
@@ -1028,6 +1134,8 @@ void Screen::setBackColor(int space, int color) {
 }
 
 void Screen::clearSelection() {
+    if (selBegin != -1)
+        markAllLinesDirty();
     selBottomRight = -1;
     selTopLeft = -1;
     selBegin = -1;
@@ -1056,6 +1164,7 @@ void Screen::getSelectionEnd(int &column, int &line) const {
     }
 }
 void Screen::setSelectionStart(const int x, const int y, const bool mode) {
+    markAllLinesDirty();
     selBegin = loc(x, y);
     /* FIXME, HACK to correct for x too far to the right... */
     if (x == columns)
@@ -1070,6 +1179,7 @@ void Screen::setSelectionEnd(const int x, const int y) {
     if (selBegin == -1)
         return;
 
+    markAllLinesDirty();
     int endPos = loc(x, y);
 
     if (endPos < selBegin) {
@@ -1261,6 +1371,11 @@ void Screen::addHistLine() {
 
         int newHistLines = history->getLines();
 
+        _historyIndex.addLine(screenLines[0].constData(), screenLines[0].size(),
+                              lineProperties[0] & LINE_WRAPPED);
+        _historyIndex.setHistoryLines(newHistLines);
+        _addedHistoryLines++;
+
         bool beginIsTL = (selBegin == selTopLeft);
 
         // If the history is full, increment the count
@@ -1312,7 +1427,99 @@ void Screen::setScroll(const HistoryType &t, bool copyPreviousScroll) {
         HistoryScroll *oldScroll = history;
         history = t.scroll(nullptr);
         delete oldScroll;
+        _historyIndex.reset();
+    }
+    history->setTrimmedHandler([this](int count) { historyTrimmedBy(count); });
+    markAllLinesDirty();
+}
+
+void Screen::historyTrimmedBy(int count) {
+    // the oldest lines are gone just as if the history had been full
+    _droppedLines += count;
+    _historyIndex.setHistoryLines(history->getLines());
+
+    if (selBegin != -1) {
+        const bool beginIsTL = (selBegin == selTopLeft);
+        selTopLeft -= count * columns;
+        selBottomRight -= count * columns;
+        if (selBottomRight < 0) {
+            clearSelection();
+        } else {
+            if (selTopLeft < 0)
+                selTopLeft = 0;
+            selBegin = beginIsTL ? selTopLeft : selBottomRight;
+        }
+    }
+
+    emit historyTrimmed();
+}
+
+bool Screen::findCandidateLines(const QStringList &literals, QVector<QPair<int, int>> *ranges) const {
+    const int histLines = history->getLines();
+    if (!_historyIndex.candidateLines(literals, histLines, ranges))
+        return false;
+
+    // the lines on the screen are always searched, together with the start
+    // of a logical line which continues on the screen
+    int first = histLines;
+    while (first > 0 && history->isWrappedLine(first - 1))
+        first--;
+    while (!ranges->isEmpty() && ranges->last().first >= first)
+        ranges->removeLast();
+    if (!ranges->isEmpty() && ranges->last().second + 1 >= first)
+        ranges->last().second = histLines + lines - 1;
+    else
+        ranges->append(qMakePair(first, histLines + lines - 1));
+    return true;
+}
+
+ScreenSnapshot Screen::snapshot() const {
+    ScreenSnapshot snapshot;
+    snapshot._screen = this;
+    snapshot._history.reset(history->snapshot());
+    snapshot._historyLines = snapshot._history->getLines();
+    snapshot._addedHistoryLines = _addedHistoryLines;
+    snapshot._columns = columns;
+    // the screen lines are implicitly shared
+    snapshot._screenLines.reserve(lines);
+    snapshot._lineProperties.reserve(lines);
+    for (int i = 0; i < lines; i++) {
+        snapshot._screenLines.append(screenLines[i]);
+        snapshot._lineProperties.append(lineProperties[i]);
+    }
+    return snapshot;
+}
+
+int Screen::droppedLinesSince(const ScreenSnapshot &snapshot) const {
+    Q_ASSERT(snapshot._screen == this);
+    const qint64 added = static_cast<qint64>(_addedHistoryLines - snapshot._addedHistoryLines);
+    return static_cast<int>(added - (history->getLines() - snapshot._historyLines));
+}
+
+int ScreenSnapshot::getLines() const {
+    return _historyLines + _screenLines.size();
+}
+
+int ScreenSnapshot::getLineLen(int line) const {
+    if (line < _historyLines)
+        return _history->getLineLen(line);
+    return qMin(_columns, static_cast<int>(_screenLines.at(line - _historyLines).size()));
+}
+
+void ScreenSnapshot::getCells(int line, int column, int count, Character buffer[]) const {
+    if (line < _historyLines) {
+        _history->getCells(line, column, count, buffer);
+        return;
     }
+    const QVector<Character> &cells = _screenLines.at(line - _historyLines);
+    Q_ASSERT(column + count <= cells.size());
+    std::copy(cells.constData() + column, cells.constData() + column + count, buffer);
+}
+
+bool ScreenSnapshot::isWrappedLine(int line) const {
+    if (line < _historyLines)
+        return _history->isWrappedLine(line);
+    return _lineProperties.at(line - _historyLines) & LINE_WRAPPED;
 }
 
 bool Screen::hasScroll() const { return history->hasScroll(); }
@@ -1324,6 +1531,18 @@ void Screen::setLineProperty(LineProperty property, bool enable) {
         lineProperties[cuY] = (LineProperty)(lineProperties[cuY] | property);
     else
         lineProperties[cuY] = (LineProperty)(lineProperties[cuY] & ~property);
+    markLinesDirty(cuY, cuY);
+}
+
+void Screen::markLinesDirty(int first, int last) {
+    ++_generation;
+    const int end = qMin(last, lines);
+    for (int y = qMax(0, first); y <= end; y++)
+        _lineGenerations[y] = _generation;
+}
+
+void Screen::markAllLinesDirty() {
+    _allLinesGeneration = ++_generation;
 }
 
 void Screen::fillWithDefaultChar(Character *dest, int count) {
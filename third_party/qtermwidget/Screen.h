@@ -25,11 +25,15 @@
 #include <QObject>
 #include <QRect>
 #include <QSet>
+#include <QStringList>
 #include <QTextStream>
 #include <QVarLengthArray>
 
+#include <memory>
+
 #include "Character.h"
 #include "History.h"
+#include "HistoryIndex.h"
 
 #define MODE_Origin    0
 #define MODE_Wrap      1
@@ -39,8 +43,38 @@
 #define MODE_NewLine   5
 #define MODES_SCREEN   6
 
+class Screen;
 class TerminalCharacterDecoder;
 
+/**
+ * A read-only copy of the lines of a screen and its history, see
+ * Screen::snapshot().  Lines are numbered like in Screen::writeLinesToStream(),
+ * history lines first.  The snapshot can be read on another thread while the
+ * screen keeps changing, but only by one thread at a time.
+ */
+class ScreenSnapshot
+{
+public:
+    int getLines() const;
+    int getLineLen(int line) const;
+    void getCells(int line, int column, int count, Character buffer[]) const;
+    bool isWrappedLine(int line) const;
+
+    /** Returns the screen the snapshot was taken of. */
+    const Screen *screen() const { return _screen; }
+
+private:
+    friend class Screen;
+
+    const Screen *_screen = nullptr;
+    std::shared_ptr<HistorySnapshot> _history;
+    int _historyLines = 0;
+    quint64 _addedHistoryLines = 0;
+    int _columns = 0;
+    QVector<QVector<Character>> _screenLines;
+    QVector<LineProperty> _lineProperties;
+};
+
 /**
     \brief An image of characters with associated attributes.
 
@@ -355,6 +389,13 @@ public:
      */
     void displayCharacter(wchar_t c);
 
+    /**
+     * Displays @p count characters starting at the current cursor position,
+     * exactly as if displayCharacter() had been called for each of them.
+     * Runs of single-width characters are written a line segment at a time.
+     */
+    void displayCharacters(const wchar_t *chars, int count);
+
     // Do composition with last shown character FIXME: Not implemented yet for KDE 4
     void compose(const QString& compose);
 
@@ -390,6 +431,27 @@ public:
      */
     QVector<LineProperty> getLineProperties( int startLine , int endLine ) const;
 
+    /**
+     * Copies the single line @p line into @p dest, which has room for
+     * getColumns() Characters.  The line is rendered the same way getImage()
+     * renders it, including the selection, the screen mode and the cursor.
+     */
+    void getImageLine( Character* dest , int line ) const;
+
+    /**
+     * Returns the current modification generation of the screen.  The
+     * generation grows every time a screen line is modified.
+     */
+    quint64 generation() const { return _generation; }
+    /**
+     * Returns the generation in which the screen line @p line (0 is the
+     * first line of the screen, not of the history) was last modified.
+     * Together with generation() this lets a view find the lines which
+     * changed since it last copied them, see ScreenWindow::getImage().
+     * Changes which affect every line, like a resize or a new selection,
+     * set the generation of all lines at once.
+     */
+    quint64 lineGeneration(int line) const { return qMax(_lineGenerations[line], _allLinesGeneration); }
 
     /** Return the number of lines. */
     int getLines() const { return lines; }
@@ -405,6 +467,35 @@ public:
     void setScroll(const HistoryType& , bool copyPreviousScroll = true);
     /** Returns the type of storage used to keep lines in the history. */
     const HistoryType& getScroll() const;
+    /** Returns the number of bytes used by the history, see HistoryMemoryBudget. */
+    qint64 historyMemoryUsage() const { return history->memoryUsage(); }
+    /** Marks the history as recently viewed for the history memory budget. */
+    void markHistoryViewed() { history->markViewed(); }
+    /**
+     * Computes the ranges of lines [first, last] which may contain all of
+     * @p literals, counting the history lines first and the screen lines
+     * after them.  Returns false if the history index cannot narrow down
+     * the search, see HistoryIndex::candidateLines().
+     */
+    bool findCandidateLines(const QStringList &literals, QVector<QPair<int, int>> *ranges) const;
+    /**
+     * Takes a snapshot of the history and the screen lines.  Only the line
+     * index of the history is copied, see HistoryScroll::snapshot().
+     */
+    ScreenSnapshot snapshot() const;
+    /**
+     * Returns the number of lines which were dropped from the top of the
+     * history since @p snapshot was taken.  A line @p n in the snapshot is
+     * line n minus this in the screen now.  @p snapshot must have been taken
+     * of this screen.
+     */
+    int droppedLinesSince(const ScreenSnapshot &snapshot) const;
+    /**
+     * Returns the number of lines which were dropped from the top of the
+     * history so far.  Adding this to a line number gives a number which
+     * stays the same while the line moves up the history.
+     */
+    quint64 droppedHistoryLines() const { return _addedHistoryLines - history->getLines(); }
     /**
      * Returns true if this screen keeps lines that are scrolled off the screen
      * in a history buffer.
@@ -571,10 +662,26 @@ public:
 
 
     //qiushao patch start
-signals:
-    void onNewLine(const QString &line);
+    /**
+     * Enables or disables capturing of the lines which are moved off the
+     * cursor by index().  While enabled every such line is decoded into plain
+     * text and queued until takeCapturedLines() is called.  Disabled by
+     * default so that screens without a line consumer do not pay for the
+     * decoding.
+     */
+    void setLineCaptureEnabled(bool enable);
+    bool lineCaptureEnabled() const { return _lineCaptureEnabled; }
+    /** Returns the lines captured since the last call and clears the queue. */
+    QStringList takeCapturedLines();
     //qiushao patch end
 
+signals:
+    /**
+     * Emitted when the history memory budget has dropped lines from the top
+     * of the history.  droppedLines() includes them.
+     */
+    void historyTrimmed();
+
 private:
     Screen(const Screen &) = delete;
     Screen &operator=(const Screen &) = delete;
@@ -614,6 +721,8 @@ private:
     void scrollDown(int from, int i);
 
     void addHistLine();
+    // adjusts the line numbers after the budget dropped @p count history lines
+    void historyTrimmedBy(int count);
 
     void initTabStops();
 
@@ -632,6 +741,11 @@ private:
     // starting from 'startLine', where 0 is the first line in the history
     void copyFromHistory(Character* dest, int startLine, int count) const;
 
+    // records that the screen lines 'first' to 'last' have been modified
+    void markLinesDirty(int first, int last);
+    // records that the way every line is rendered has changed
+    void markAllLinesDirty();
+
 
     // screen image ----------------
     int lines;
@@ -645,10 +759,23 @@ private:
 
     int _droppedLines;
 
+    // lines captured by index() for the line consumers, see setLineCaptureEnabled()
+    bool _lineCaptureEnabled = false;
+    QStringList _capturedLines;
+
     QVarLengthArray<LineProperty,64> lineProperties;
 
+    // generation in which each screen line was last modified, see lineGeneration()
+    QVarLengthArray<quint64,64> _lineGenerations;
+    quint64 _allLinesGeneration = 0;
+    quint64 _generation = 0;
+
     // history buffer ---------------
     HistoryScroll* history;
+    // trigram index over the lines in the history, used by the history search
+    HistoryIndex _historyIndex;
+    // lines ever added to the history, see droppedLinesSince()
+    quint64 _addedHistoryLines = 0;
 
     // cursor location
     int cuX;
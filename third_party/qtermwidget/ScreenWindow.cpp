@@ -22,7 +22,10 @@
 
 ScreenWindow::ScreenWindow(QObject *parent)
     : QObject(parent), _screen(nullptr), _windowBuffer(nullptr),
-      _windowBufferSize(0), _bufferNeedsUpdate(true), _windowLines(1),
+      _windowBufferSize(0), _bufferNeedsUpdate(true), _bufferValid(false),
+      _bufferGeneration(0), _bufferLine(0), _bufferHistoryLines(0),
+      _bufferDroppedLines(0), _bufferReverse(false), _bufferCursorLine(-1),
+      _bufferCursorColumn(-1), _windowLines(1),
       _currentLine(0), _trackOutput(true), _scrollCount(0) {
 }
 
@@ -33,6 +36,9 @@ ScreenWindow::~ScreenWindow() {
 void ScreenWindow::setScreen(Screen *screen) {
   Q_ASSERT(screen);
   _screen = screen;
+  // the line generations of another screen mean nothing to this one
+  _bufferValid = false;
+  _bufferNeedsUpdate = true;
 }
 
 Screen *ScreenWindow::screen() const { 
@@ -47,22 +53,72 @@ Character *ScreenWindow::getImage() {
         _windowBufferSize = size;
         _windowBuffer = new Character[size];
         _bufferNeedsUpdate = true;
+        _bufferValid = false;
+    }
+
+    if (_dirtyLines.size() != windowLines()) {
+        _dirtyLines.resize(windowLines());
+        _bufferNeedsUpdate = true;
+        _bufferValid = false;
     }
 
     if (!_bufferNeedsUpdate)
         return _windowBuffer;
 
-    _screen->getImage(_windowBuffer, size, currentLine(), endWindowLine());
+    const int startLine = currentLine();
+    const int endLine = endWindowLine();
+    const int histLines = _screen->getHistLines();
+    const quint64 droppedLines = _screen->droppedHistoryLines();
+    const bool reverse = _screen->getMode(MODE_Screen);
+
+    int cursorLine = histLines + _screen->getCursorY() - startLine;
+    if (!_screen->getMode(MODE_Cursor) || cursorLine < 0 || cursorLine >= windowLines())
+        cursorLine = -1;
+    const int cursorColumn = cursorLine < 0 ? -1 : _screen->getCursorX();
+
+    // as long as the window shows the same lines, lines in the history never
+    // change and only the screen lines modified since the last update have
+    // to be copied again, together with the lines the cursor moved between
+    if (_bufferValid && startLine == _bufferLine && histLines == _bufferHistoryLines
+            && droppedLines == _bufferDroppedLines && reverse == _bufferReverse) {
+        const int columns = windowColumns();
+        const bool cursorMoved = cursorLine != _bufferCursorLine || cursorColumn != _bufferCursorColumn;
+        for (int line = qMax(startLine, histLines); line <= endLine; line++) {
+            const int windowLine = line - startLine;
+            if (_screen->lineGeneration(line - histLines) > _bufferGeneration
+                    || (cursorMoved && (windowLine == cursorLine || windowLine == _bufferCursorLine))) {
+                _screen->getImageLine(_windowBuffer + windowLine * columns, line);
+                _dirtyLines.setBit(windowLine);
+            }
+        }
+    } else {
+        _screen->getImage(_windowBuffer, size, startLine, endLine);
 
-    // this window may look beyond the end of the screen, in which
-    // case there will be an unused area which needs to be filled
-    // with blank characters
-    fillUnusedArea();
+        // this window may look beyond the end of the screen, in which
+        // case there will be an unused area which needs to be filled
+        // with blank characters
+        fillUnusedArea();
+
+        _dirtyLines.fill(true);
+    }
+
+    _bufferValid = true;
+    _bufferGeneration = _screen->generation();
+    _bufferLine = startLine;
+    _bufferHistoryLines = histLines;
+    _bufferDroppedLines = droppedLines;
+    _bufferReverse = reverse;
+    _bufferCursorLine = cursorLine;
+    _bufferCursorColumn = cursorColumn;
 
     _bufferNeedsUpdate = false;
     return _windowBuffer;
 }
 
+void ScreenWindow::resetDirtyLines() {
+    _dirtyLines.fill(false);
+}
+
 void ScreenWindow::fillUnusedArea() {
     int screenEndLine = _screen->getHistLines() + _screen->getLines() - 1;
     int windowEndLine = currentLine() + windowLines() - 1;
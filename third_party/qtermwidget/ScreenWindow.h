@@ -20,6 +20,7 @@
 #ifndef SCREENWINDOW_H
 #define SCREENWINDOW_H
 
+#include <QBitArray>
 #include <QObject>
 #include <QPoint>
 #include <QRect>
@@ -73,9 +74,22 @@ public:
      *
      * The returned buffer is managed by the ScreenWindow instance and does not need to be
      * deleted by the caller.
+     *
+     * Only the lines which changed on the screen since the previous call are copied
+     * into the buffer, see dirtyLines().
      */
     Character* getImage();
 
+    /**
+     * Returns the lines of the window which getImage() has updated since the last
+     * call to resetDirtyLines().  The other lines of the image are unchanged, so
+     * a view which copied the whole image at that point only has to compare
+     * these lines.
+     */
+    const QBitArray &dirtyLines() const { return _dirtyLines; }
+    /** Clears the lines returned by dirtyLines(). */
+    void resetDirtyLines();
+
     /**
      * Returns the line attributes associated with the lines of characters which
      * are currently visible through this window
@@ -254,6 +268,17 @@ private:
     int _windowBufferSize;
     bool _bufferNeedsUpdate;
 
+    // the state of the screen when _windowBuffer was last updated, see getImage()
+    bool _bufferValid;
+    quint64 _bufferGeneration;
+    int _bufferLine;
+    int _bufferHistoryLines;
+    quint64 _bufferDroppedLines;
+    bool _bufferReverse;
+    int _bufferCursorLine;   // window line with the cursor, -1 if not shown
+    int _bufferCursorColumn;
+    QBitArray _dirtyLines;
+
     int  _windowLines;
     int  _currentLine; // see scrollTo() , currentLine()
     bool _trackOutput; // see setTrackOutput() , trackOutput()
@@ -21,6 +21,8 @@
 */
 #include "TerminalDisplay.h"
 
+#include <algorithm>
+
 #include <QAbstractButton>
 #include <QApplication>
 #include <QBoxLayout>
@@ -38,7 +40,9 @@
 #include <QPainter>
 #include <QPixmap>
 #include <QRegularExpression>
+#include <QScreen>
 #include <QStyle>
+#include <QStyleOptionSlider>
 #include <QTime>
 #include <QTimer>
 #include <QToolTip>
@@ -136,11 +140,7 @@ void TerminalDisplay::setScreenWindow(ScreenWindow *window) {
         // #warning "The order here is not specified - does it matter whether
         // updateImage or updateLineProperties comes first?"
         connect(_screenWindow, &ScreenWindow::outputChanged, this,
-                        &TerminalDisplay::updateLineProperties);
-        connect(_screenWindow, &ScreenWindow::outputChanged, this,
-                        &TerminalDisplay::updateImage);
-        connect(_screenWindow, &ScreenWindow::outputChanged, this,
-                        &TerminalDisplay::updateFilters);
+                        &TerminalDisplay::scheduleFrame);
         connect(_screenWindow, &ScreenWindow::scrolled, this,
                         &TerminalDisplay::updateFilters);
         connect(_screenWindow, &ScreenWindow::scrollToEnd, this,
@@ -212,6 +212,8 @@ bool TerminalDisplay::isLineCharString(const std::wstring& string) const {
 }
 
 void TerminalDisplay::fontChange(const QFont &) {
+    _glyphCache->setFont(font());
+
     QFontMetrics fm(font());
     _fontHeight = fm.height() + _lineSpacing;
 
@@ -314,6 +316,7 @@ TerminalDisplay::TerminalDisplay(QWidget *parent)
         _gridLayout(nullptr), _fontHeight(1), _fontWidth(1), _fontAscent(1),
         _boldIntense(true), _lines(1), _columns(1), _usedLines(1),
         _usedColumns(1), _contentHeight(1), _contentWidth(1), _image(nullptr),
+        _compareAllLines(true),
         _resizing(false), _terminalSizeHint(false), _terminalSizeStartup(true),
         _bidiEnabled(true), _mouseMarks(false), _isPrimaryScreen(true),
         _disabledBracketedPasteMode(false), _showResizeNotificationEnabled(true),
@@ -367,6 +370,10 @@ TerminalDisplay::TerminalDisplay(QWidget *parent)
     _scrollBar->hide();
 
     // setup timers for blinking cursor and text
+    _frameTimer = new QTimer(this);
+    _frameTimer->setSingleShot(true);
+    connect(_frameTimer, &QTimer::timeout, this, &TerminalDisplay::paintFrame);
+
     _blinkTimer = new QTimer(this);
     connect(_blinkTimer, &QTimer::timeout, this, &TerminalDisplay::blinkEvent);
     _blinkCursorTimer = new QTimer(this);
@@ -399,6 +406,7 @@ TerminalDisplay::TerminalDisplay(QWidget *parent)
     setLayout(_gridLayout);
 
     _charWidth = new CharWidth(font());
+    _glyphCache = new GlyphCache(font());
 
     _isLocked = false;
     _lockbackgroundImage = QPixmap(10, 10);
@@ -422,6 +430,7 @@ TerminalDisplay::~TerminalDisplay() {
     delete[] _image;
 
     delete _charWidth;
+    delete _glyphCache;
     delete _gridLayout;
     delete _outputSuspendedLabel;
     delete _filterChain;
@@ -840,26 +849,23 @@ void TerminalDisplay::drawCharacters(QPainter &painter, const QRect &rect,
         return;
 
     // setup bold and underline
-    bool useBold =
-            ((style->rendition & RE_BOLD) && _boldIntense) || font().bold();
-    const bool useUnderline =
-            style->rendition & RE_UNDERLINE || font().underline();
-    const bool useItalic = style->rendition & RE_ITALIC || font().italic();
-    const bool useStrikeOut =
-            style->rendition & RE_STRIKEOUT || font().strikeOut();
-    const bool useOverline = style->rendition & RE_OVERLINE || font().overline();
-
-    QFont font = painter.font();
-    if (font.bold() != useBold || font.underline() != useUnderline ||
-            font.italic() != useItalic || font.strikeOut() != useStrikeOut ||
-            font.overline() != useOverline) {
-#if !defined(Q_OS_WIN)
-        font.setBold(useBold);
-#endif
-        font.setUnderline(useUnderline);
-        font.setItalic(useItalic);
-        font.setStrikeOut(useStrikeOut);
-        font.setOverline(useOverline);
+    int variant = 0;
+    if ((style->rendition & RE_BOLD) && _boldIntense)
+        variant |= GlyphCache::Bold;
+    if (style->rendition & RE_UNDERLINE)
+        variant |= GlyphCache::Underline;
+    if (style->rendition & RE_ITALIC)
+        variant |= GlyphCache::Italic;
+    if (style->rendition & RE_STRIKEOUT)
+        variant |= GlyphCache::StrikeOut;
+    if (style->rendition & RE_OVERLINE)
+        variant |= GlyphCache::Overline;
+
+    const QFont &font = _glyphCache->font(variant);
+    const QFont &currentFont = painter.font();
+    if (currentFont.bold() != font.bold() || currentFont.underline() != font.underline() ||
+            currentFont.italic() != font.italic() || currentFont.strikeOut() != font.strikeOut() ||
+            currentFont.overline() != font.overline()) {
         painter.setFont(font);
     }
 
@@ -957,6 +963,10 @@ void TerminalDisplay::drawCharacters(QPainter &painter, const QRect &rect,
                     QRect drawRect(rect.topLeft(), rect.size());
                     drawRect.setHeight(rect.height() + _drawTextAdditionHeight);
                     painter.drawText(drawRect, Qt::AlignBottom, QString::fromStdWString(text));
+                } else if (_antialiasText && _glyphCache->glyphRun(text, variant, &_glyphRun)) {
+                    // the glyphs are cached, so unchanged text is not shaped again
+                    painter.drawGlyphRun(QPointF(rect.x(), rect.y() + _fontAscent + _lineSpacing),
+                                         _glyphRun);
                 } else {
                     painter.drawText(rect.x(), rect.y() + _fontAscent + _lineSpacing,
                                     QString::fromStdWString(text));
@@ -1112,6 +1122,10 @@ void TerminalDisplay::scrollImage(int lines, const QRect &screenWindowRegion) {
     Q_ASSERT(linesToMove > 0);
     Q_ASSERT(bytesToMove > 0);
 
+    // the lines of the internal image no longer match the lines
+    // of the screen window which they were copied from
+    _compareAllLines = true;
+
     // scroll internal image
     if (lines > 0) {
         // check that the memory areas that we are going to move are valid
@@ -1235,7 +1249,6 @@ void TerminalDisplay::updateImage() {
     QPoint tL = contentsRect().topLeft();
     int tLx = tL.x();
     int tLy = tL.y();
-    _hasBlinker = false;
 
     CharacterColor cf;         // undefined
     CharacterColor _clipboard; // undefined
@@ -1248,6 +1261,15 @@ void TerminalDisplay::updateImage() {
     char *dirtyMask = new char[columnsToUpdate + 2];
     QRegion dirtyRegion;
 
+    // only the lines which the screen window updated can differ from _image,
+    // so for a small change the cost does not depend on the size of the window
+    const QBitArray &dirtyLines = _screenWindow->dirtyLines();
+    const bool compareAllLines = _compareAllLines || dirtyLines.size() < linesToUpdate;
+    if (_blinkingLines.size() != this->_lines) {
+        _blinkingLines.resize(this->_lines);
+        _blinkingLines.fill(false);
+    }
+
     // debugging variable, this records the number of lines that are found to
     // be 'dirty' ( ie. have changed from the old _image to the new _image ) and
     // which therefore need to be repainted
@@ -1255,7 +1277,16 @@ void TerminalDisplay::updateImage() {
         const Character *currentLine = &_image[y * this->_columns];
         const Character *const newLine = &newimg[y * columns];
 
+        if (!compareAllLines && !dirtyLines.testBit(y)) {
+            // both halves of double height lines are always redrawn, see below
+            if (_lineProperties.count() > y && (_lineProperties[y] & LINE_DOUBLEHEIGHT) != 0)
+                dirtyRegion |= QRect(_leftMargin + tLx, _topMargin + tLy + _fontHeight * y,
+                                     _fontWidth * columnsToUpdate, _fontHeight);
+            continue;
+        }
+
         bool updateLine = false;
+        bool lineBlinks = false;
 
         // The dirty mask indicates which characters need repainting. We also
         // mark surrounding neighbours dirty, in case the character exceeds
@@ -1268,11 +1299,10 @@ void TerminalDisplay::updateImage() {
             }
         }
 
-        QFontMetrics fm(font());
         if (!_resizing) // not while _resizing, we're expecting a paintEvent
             for (x = 0; x < columnsToUpdate; ++x) {
                 if ((newLine[x].rendition & RE_BLINK) != 0) {
-                    _hasBlinker = true;
+                    lineBlinks = true;
                 }
 
                 // Start drawing if this character or the next one differs.
@@ -1288,7 +1318,7 @@ void TerminalDisplay::updateImage() {
                     bool doubleWidth = (x + 1 == columnsToUpdate)
                                                                  ? false
                                                                  : (newLine[x + 1].character == 0);
-                    int charWidth = fm.horizontalAdvance(QString::fromWCharArray(&c, 1));
+                    int charWidth = _glyphCache->advance(c);
                     bool bigWidth = _fixedFont && !doubleWidth && charWidth > _fontWidth;
                     bool smallWidth = _fixedFont && charWidth < _fontWidth;
                     cr = newLine[x].rendition;
@@ -1307,7 +1337,7 @@ void TerminalDisplay::updateImage() {
                                         ? false
                                         : (newLine[x + len + 1].character == 0);
 
-                        int nxtCharWidth = fm.horizontalAdvance(QString::fromWCharArray(&newLine[x+len].character, 1));
+                        int nxtCharWidth = _glyphCache->advance(newLine[x + len].character);
                         bool nextIsbigWidth = _fixedFont && !nextIsDoubleWidth && nxtCharWidth > _fontWidth;
                         bool nextIsSmallWidth = _fixedFont && newLine[x+len].character && nxtCharWidth < _fontWidth;
 
@@ -1339,6 +1369,7 @@ void TerminalDisplay::updateImage() {
                     x += len - 1;
                 }
             }
+        _blinkingLines.setBit(y, lineBlinks);
 
         // both the top and bottom halves of double height _lines must always be
         // redrawn although both top and bottom halves contain the same characters,
@@ -1376,6 +1407,12 @@ void TerminalDisplay::updateImage() {
                             _fontHeight * (_usedLines - linesToUpdate));
     }
     _usedLines = linesToUpdate;
+    for (y = linesToUpdate; y < this->_lines; ++y)
+        _blinkingLines.clearBit(y);
+    _hasBlinker = _blinkingLines.count(true) > 0;
+
+    _screenWindow->resetDirtyLines();
+    _compareAllLines = false;
 
     if (columnsToUpdate < _usedColumns) {
         dirtyRegion |=
@@ -1515,6 +1552,8 @@ void TerminalDisplay::leaveEvent(QEvent* event)
 }
 
 void TerminalDisplay::paintEvent(QPaintEvent *pe) {
+    QElapsedTimer paintTimer;
+    paintTimer.start();
     QPainter paint(this);
     QRect cr = contentsRect();
 
@@ -1624,6 +1663,7 @@ void TerminalDisplay::paintEvent(QPaintEvent *pe) {
                                      true /* use opacity setting */);
         drawContents(paint, *rect);
     }
+    paintSearchMatches(paint);
     drawInputMethodPreeditString(paint, preeditRect());
 
     if (_isLocked) {
@@ -1635,6 +1675,10 @@ void TerminalDisplay::paintEvent(QPaintEvent *pe) {
     }
 
     paintFilters(paint);
+
+    const qint64 cost = paintTimer.nsecsElapsed();
+    _paintCostNsecs = _paintCostNsecs == 0 ? cost : (_paintCostNsecs * 7 + cost) / 8;
+    _paintedFrames++;
 }
 
 QPoint TerminalDisplay::cursorPosition() const {
@@ -1681,6 +1725,122 @@ void TerminalDisplay::drawInputMethodPreeditString(QPainter &painter, const QRec
 
 FilterChain *TerminalDisplay::filterChain() const { return _filterChain; }
 
+static bool searchMatchLessThan(const HistorySearch::Match &a, const HistorySearch::Match &b) {
+    return a.startLine < b.startLine || (a.startLine == b.startLine && a.startColumn < b.startColumn);
+}
+
+int TerminalDisplay::searchMatchOffset() const {
+    if (!_searchMatchScreen)
+        return 0;
+    return static_cast<int>(_searchMatchScreen->droppedHistoryLines() - _searchMatchBase);
+}
+
+void TerminalDisplay::clearSearchMatches() {
+    _searchMatches.clear();
+    _searchMatchLines.clear();
+    _currentSearchMatch = -1;
+    _searchMatchScreen = _screenWindow ? _screenWindow->screen() : nullptr;
+    _searchMatchBase = _searchMatchScreen ? _searchMatchScreen->droppedHistoryLines() : 0;
+    updateSearchMarkers();
+    update();
+}
+
+int TerminalDisplay::addSearchMatches(const QVector<HistorySearch::Match> &matches) {
+    if (matches.isEmpty())
+        return -1;
+
+    const int offset = searchMatchOffset();
+    QVector<HistorySearch::Match> batch = matches;
+    for (HistorySearch::Match &match : batch) {
+        match.startLine += offset;
+        match.endLine += offset;
+    }
+    const HistorySearch::Match first = batch.first();
+    std::sort(batch.begin(), batch.end(), searchMatchLessThan);
+
+    // batches never overlap, so the whole batch goes to one place
+    const int index = static_cast<int>(std::lower_bound(_searchMatches.cbegin(), _searchMatches.cend(),
+                                                        batch.first(), searchMatchLessThan)
+                                       - _searchMatches.cbegin());
+    if (index == _searchMatches.size())
+        _searchMatches.append(batch);
+    else
+        _searchMatches = _searchMatches.mid(0, index) + batch + _searchMatches.mid(index);
+    if (_currentSearchMatch >= index)
+        _currentSearchMatch += batch.size();
+
+    _searchMatchLines.clear();
+    for (const HistorySearch::Match &match : std::as_const(_searchMatches)) {
+        if (_searchMatchLines.isEmpty() || _searchMatchLines.last() != match.startLine)
+            _searchMatchLines.append(match.startLine);
+    }
+    updateSearchMarkers();
+    update();
+
+    return index + static_cast<int>(std::lower_bound(batch.cbegin(), batch.cend(), first, searchMatchLessThan)
+                                    - batch.cbegin());
+}
+
+HistorySearch::Match TerminalDisplay::searchMatch(int index) const {
+    HistorySearch::Match match = _searchMatches.at(index);
+    const int offset = searchMatchOffset();
+    match.startLine -= offset;
+    match.endLine -= offset;
+    return match;
+}
+
+void TerminalDisplay::setCurrentSearchMatch(int index) {
+    _currentSearchMatch = index;
+    updateSearchMarkers();
+    update();
+}
+
+void TerminalDisplay::setSearchMatchesVisible(bool visible) {
+    _searchMatchesVisible = visible;
+    updateSearchMarkers();
+    update();
+}
+
+void TerminalDisplay::updateSearchMarkers() {
+    if (!_searchMatchesVisible) {
+        _scrollBar->setMarkers(QVector<int>(), -1);
+        return;
+    }
+    const int currentLine = _currentSearchMatch >= 0 && _currentSearchMatch < _searchMatches.size()
+                                    ? _searchMatches.at(_currentSearchMatch).startLine
+                                    : -1;
+    _scrollBar->setMarkers(_searchMatchLines, currentLine);
+    _scrollBar->setMarkerOffset(searchMatchOffset());
+}
+
+void TerminalDisplay::paintSearchMatches(QPainter &painter) {
+    if (!_searchMatchesVisible || _searchMatches.isEmpty() || !_screenWindow
+            || _screenWindow->screen() != _searchMatchScreen)
+        return;
+
+    const int top = _screenWindow->currentLine() + searchMatchOffset();
+    const int bottom = top + _lines - 1;
+
+    auto begin = _searchMatches.cbegin();
+    auto it = std::lower_bound(begin, _searchMatches.cend(), top,
+                               [](const HistorySearch::Match &match, int line) { return match.startLine < line; });
+    // a match in wrapped lines may start above the screen
+    while (it != begin && (it - 1)->endLine >= top)
+        --it;
+
+    for (; it != _searchMatches.cend() && it->startLine <= bottom; ++it) {
+        const bool current = (it - begin) == _currentSearchMatch;
+        const QColor color = current ? QColor(255, 140, 0, 140) : QColor(255, 230, 0, 80);
+        for (int line = qMax(it->startLine, top); line <= qMin(it->endLine, bottom); line++) {
+            const int left = line == it->startLine ? it->startColumn : 0;
+            const int right = line == it->endLine ? it->endColumn : _columns - 1;
+            painter.fillRect(QRect(_leftMargin + _fontWidth * left, _topMargin + _fontHeight * (line - top),
+                                   _fontWidth * (right - left + 1), _fontHeight),
+                             color);
+        }
+    }
+}
+
 void TerminalDisplay::paintFilters(QPainter &painter) {
     // get color of character under mouse and use it to draw
     // lines for filters
@@ -1804,7 +1964,6 @@ void TerminalDisplay::paintFilters(QPainter &painter) {
 
 // NOTE: This should be called only when "_fixedFont" is set to "false" (temporarily).
 int TerminalDisplay::textWidth(const int startColumn, const int length, const int line) const {
-    QFontMetrics fm(font());
     int result = 0;
     for (int column = 0; column < length; column++) {
         auto c = _image[loc(startColumn + column, line)];
@@ -1813,9 +1972,9 @@ int TerminalDisplay::textWidth(const int startColumn, const int length, const in
         // [1] http://www.unicode.org/Public/UCD/latest/ucd/EastAsianWidth.txt
         if (_fixedFont_original && !isLineChar(c)) { 
             // c == 0 may happen here after a double-column character
-            result += fm.horizontalAdvance(QLatin1Char(REPCHAR[0]));
+            result += _glyphCache->advance(REPCHAR[0]);
         } else {
-            result += fm.horizontalAdvance(QChar(static_cast<uint>(c.character)));
+            result += _glyphCache->advance(c.character);
         }
     }
     return result;
@@ -1843,7 +2002,6 @@ void TerminalDisplay::drawContents(QPainter &paint, const QRect &rect) {
     int rlx = qMin(_usedColumns - 1, qMax(0, (rect.right() - tLx - _leftMargin) / _fontWidth));
     int rly = qMin(_usedLines - 1, qMax(0, (rect.bottom() - tLy - _topMargin) / _fontHeight));
 
-    QFontMetrics fm(font());
     const int numberOfColumns = _usedColumns;
     std::wstring unistr;
     unistr.reserve(numberOfColumns);
@@ -1887,7 +2045,7 @@ void TerminalDisplay::drawContents(QPainter &paint, const QRect &rect) {
             bool lineDraw = isLineChar(_image[loc(x,y)]);
             bool doubleWidth =
                     (_image[qMin(loc(x, y) + 1, _imageSize)].character == 0);
-            int charWidth = fm.horizontalAdvance(QString::fromWCharArray((wchar_t *)&c, 1));
+            int charWidth = _glyphCache->advance(c);
             bool bigWidth = _fixedFont && !doubleWidth && charWidth > _fontWidth;
             bool tooWide = bigWidth && charWidth >= 2 * _fontWidth;
             bool smallWidth = _fixedFont && c && charWidth < _fontWidth;
@@ -1904,7 +2062,7 @@ void TerminalDisplay::drawContents(QPainter &paint, const QRect &rect) {
                         _image[loc(x + len, y)].rendition == currentRendition &&
                         (nxtDoubleWidth = (_image[qMin(loc(x+len,y)+1,_imageSize)].character == 0)) == doubleWidth &&
                         !smallWidth &&
-                        !(_fixedFont && (nxtC = _image[loc(x+len,y)].character) && (nxtCharWidth = fm.horizontalAdvance(QString::fromWCharArray((const wchar_t *)(&nxtC), 1))) < _fontWidth) &&
+                        !(_fixedFont && (nxtC = _image[loc(x+len,y)].character) && (nxtCharWidth = _glyphCache->advance(nxtC)) < _fontWidth) &&
                         !bigWidth &&
                         !(_fixedFont && !nxtDoubleWidth && nxtC && nxtCharWidth > _fontWidth) &&
                         isLineChar(_image[loc(x+len,y)]) == lineDraw) // Assignment!
@@ -2074,6 +2232,68 @@ void TerminalDisplay::updateImageSize() {
     _resizing = false;
 }
 
+int TerminalDisplay::frameInterval() const {
+    // clamp bogus values some platforms report for virtual screens
+    const QScreen *s = screen();
+    const qreal rate = s ? qBound<qreal>(24, s->refreshRate(), 240) : 60;
+    return qMax(1, qRound(1000 / rate));
+}
+
+void TerminalDisplay::scheduleFrame() {
+    // nobody would see the frame, paint once when shown again
+    if (_suspended || !isVisible()) {
+        // count at most one skipped frame per refresh interval, that is
+        // what would have been painted
+        if (!_lastSkippedFrame.isValid() || _lastSkippedFrame.elapsed() >= frameInterval()) {
+            _lastSkippedFrame.start();
+            ++_skippedFrames;
+        }
+        _framePending = true;
+        return;
+    }
+
+    // the frame already scheduled will show the latest state
+    if (_frameTimer->isActive())
+        return;
+
+    // echo of recent keyboard input is painted as soon as the refresh rate
+    // allows, other output waits one frame so that bursts are coalesced
+    static const int INTERACTIVE_TIMEOUT = 300;
+    const int interval = frameInterval();
+    const bool interactive = _lastKeyPress.isValid() && _lastKeyPress.elapsed() < INTERACTIVE_TIMEOUT;
+    int delay = interval;
+    if (interactive)
+        delay = _lastFrame.isValid() ? qMax<qint64>(0, interval - _lastFrame.elapsed()) : 0;
+
+    _frameTimer->start(delay);
+}
+
+void TerminalDisplay::paintFrame() {
+    _frameTimer->stop();
+    _framePending = false;
+    _lastFrame.start();
+
+    updateLineProperties();
+    updateImage();
+    updateFilters();
+
+    const qint64 cost = _lastFrame.nsecsElapsed();
+    _frameCostNsecs = _frameCostNsecs == 0 ? cost : (_frameCostNsecs * 7 + cost) / 8;
+}
+
+void TerminalDisplay::setSuspended(bool suspended) {
+    if (_suspended == suspended)
+        return;
+
+    _suspended = suspended;
+    if (suspended) {
+        _frameTimer->stop();
+        _framePending = true;
+    } else if (_framePending && isVisible()) {
+        paintFrame();
+    }
+}
+
 // showEvent and hideEvent are reimplemented here so that it appears to other
 // classes that the display has been resized when the display is hidden or
 // shown.
@@ -2082,6 +2302,10 @@ void TerminalDisplay::updateImageSize() {
 // instead of using the same signal as the one for a content size change
 void TerminalDisplay::showEvent(QShowEvent *) {
     emit changedContentSizeSignal(_contentHeight, _contentWidth);
+
+    // catch up with the output which arrived while hidden
+    if (_framePending && !_suspended)
+        paintFrame();
 }
 
 void TerminalDisplay::hideEvent(QHideEvent *) {
@@ -2124,6 +2348,8 @@ void TerminalDisplay::setScroll(int cursor, int slines) {
     _scrollBar->setValue(cursor);
     connect(_scrollBar, &QScrollBar::valueChanged, this,
                     &TerminalDisplay::scrollBarPositionChanged);
+    if (!_searchMatchLines.isEmpty())
+        _scrollBar->setMarkerOffset(searchMatchOffset());
 }
 
 void TerminalDisplay::scrollToEnd() {
@@ -2767,6 +2993,12 @@ void TerminalDisplay::updateFilters() {
     if (!_screenWindow)
         return;
 
+    // hotspots are recomputed by the refresh when the display is shown
+    if (_suspended || !isVisible()) {
+        _framePending = true;
+        return;
+    }
+
     processFilters();
 }
 
@@ -3158,6 +3390,8 @@ void TerminalDisplay::keyPressEvent(QKeyEvent *event) {
             _cursorBlinking = false;
     }
 
+    _lastKeyPress.start();
+
     emit keyPressedSignal(event, false);
 
     event->accept();
@@ -3265,6 +3499,13 @@ bool TerminalDisplay::event(QEvent *event) {
     case QEvent::ApplicationPaletteChange:
         _scrollBar->setPalette(QApplication::palette());
         break;
+    // glyph advances depend on the resolution the font is rendered at
+    case QEvent::ScreenChangeInternal:
+#if QT_VERSION >= QT_VERSION_CHECK(6, 6, 0)
+    case QEvent::DevicePixelRatioChange:
+#endif
+        _glyphCache->clear();
+        break;
     default:
         break;
     }
@@ -3310,6 +3551,7 @@ void TerminalDisplay::swapColorTable() {
 }
 
 void TerminalDisplay::clearImage() {
+    _compareAllLines = true;
     // We initialize _image[_imageSize] too. See makeImage()
     for (int i = 0; i <= _imageSize; i++) {
         _image[i].character = ' ';
@@ -3612,3 +3854,55 @@ void ScrollBar::enterEvent(QEnterEvent* event)
   }
   QScrollBar::enterEvent(event);
 }
+
+void ScrollBar::setMarkers(const QVector<int> &lines, int currentLine)
+{
+  _markers = lines;
+  _currentMarker = currentLine;
+  update();
+}
+
+void ScrollBar::setMarkerOffset(int offset)
+{
+  if (_markerOffset == offset)
+    return;
+  _markerOffset = offset;
+  update();
+}
+
+void ScrollBar::paintEvent(QPaintEvent* event)
+{
+  QScrollBar::paintEvent(event);
+  if (_markers.isEmpty())
+    return;
+
+  QStyleOptionSlider option;
+  initStyleOption(&option);
+  const QRect groove = style()->subControlRect(QStyle::CC_ScrollBar, &option,
+                                               QStyle::SC_ScrollBarGroove, this);
+  const int lineCount = maximum() + pageStep();
+  if (lineCount <= 0 || groove.height() <= 0)
+    return;
+
+  auto markerY = [&](int line) {
+    return groove.top() + static_cast<int>(static_cast<qint64>(line - _markerOffset) * groove.height() / lineCount);
+  };
+
+  // many matches fall onto the same pixel row, only draw each row once
+  QPainter painter(this);
+  painter.setPen(QColor(255, 200, 0));
+  int lastY = -1;
+  for (auto it = std::lower_bound(_markers.cbegin(), _markers.cend(), _markerOffset);
+       it != _markers.cend() && *it - _markerOffset < lineCount; ++it) {
+    const int y = markerY(*it);
+    if (y == lastY)
+      continue;
+    lastY = y;
+    painter.drawLine(groove.left() + 1, y, groove.right() - 1, y);
+  }
+
+  if (_currentMarker >= _markerOffset && _currentMarker - _markerOffset < lineCount) {
+    const int y = markerY(_currentMarker);
+    painter.fillRect(QRect(groove.left(), y - 1, groove.width(), 3), QColor(255, 140, 0));
+  }
+}
@@ -21,7 +21,9 @@
 #ifndef TERMINALDISPLAY_H
 #define TERMINALDISPLAY_H
 
+#include <QBitArray>
 #include <QColor>
+#include <QElapsedTimer>
 #include <QPointer>
 #include <QWidget>
 #include <QClipboard>
@@ -36,6 +38,8 @@
 #include "Filter.h"
 #include "Character.h"
 #include "CharWidth.h"
+#include "GlyphCache.h"
+#include "HistorySearch.h"
 #include "qtermwidget.h"
 //#include "qsourcehighliter.h"
 
@@ -437,6 +441,26 @@ public:
     */
     void autoHideMouseAfter(int delay);
 
+    /**
+     * The matches of the history search, which are highlighted on the screen
+     * and marked on the scroll bar.  Matches are added in batches as the
+     * search streams them in, with lines counted like in the screen window at
+     * that time.  They are kept sorted and follow their lines up the history,
+     * so they never have to be searched for again while painting.
+     */
+    void clearSearchMatches();
+    /**
+     * Adds a batch of matches from a disjoint part of the output.  Returns the
+     * index of the first match of the batch.
+     */
+    int addSearchMatches(const QVector<HistorySearch::Match> &matches);
+    int searchMatchCount() const { return _searchMatches.size(); }
+    /** Returns match @p index with lines counted like in the screen window now. */
+    HistorySearch::Match searchMatch(int index) const;
+    void setCurrentSearchMatch(int index);
+    int currentSearchMatch() const { return _currentSearchMatch; }
+    void setSearchMatchesVisible(bool visible);
+
 public slots:
 
     /**
@@ -455,6 +479,35 @@ public slots:
      */
     void updateLineProperties();
 
+    /**
+     * Schedules a frame which updates the line properties, the image and the
+     * filters from the screen window.  Frames are paced to the refresh rate of
+     * the screen, follow recent keyboard input within one frame interval and
+     * are postponed while the display is hidden.
+     */
+    void scheduleFrame();
+
+    /**
+     * Suspends the display, e.g. while its tab is not the current one.  Only
+     * the emulation keeps running, image updates, filter passes and repaints
+     * are skipped until the display is resumed, which triggers one full
+     * refresh.
+     */
+    void setSuspended(bool suspended);
+    bool isSuspended() const { return _suspended; }
+
+    /** Number of frames which were not painted because the display was hidden. */
+    int skippedFrames() const { return _skippedFrames; }
+    /** Estimated rendering time saved by the skipped frames, in milliseconds. */
+    qint64 savedFrameMsecs() const { return _skippedFrames * _frameCostNsecs / 1000000; }
+    /**
+     * Running average of the time to prepare (paintFrame()) and paint
+     * (paintEvent()) one frame, in nanoseconds.
+     */
+    qint64 frameCostNsecs() const { return _frameCostNsecs + _paintCostNsecs; }
+    /** Number of paint events handled so far. */
+    int paintedFrames() const { return _paintedFrames; }
+
     /** Copies the selected text to the clipboard. */
     void copyClipboard(QClipboard::Mode mode = QClipboard::Clipboard);
     /**
@@ -688,6 +741,7 @@ protected slots:
 private slots:
 
     void swapColorTable();
+    void paintFrame();
     void tripleClickTimeout();  // resets possibleTripleClick
 
 private:
@@ -758,6 +812,10 @@ private:
     void makeImage();
 
     void paintFilters(QPainter& painter);
+    void paintSearchMatches(QPainter& painter);
+    // search matches are stored with this added to their lines, see clearSearchMatches()
+    int searchMatchOffset() const;
+    void updateSearchMarkers();
 
     void calDrawTextAdditionHeight(QPainter& painter);
 
@@ -787,6 +845,8 @@ private:
     QGridLayout* _gridLayout;
 
     CharWidth *_charWidth;
+    GlyphCache *_glyphCache; // font variants and advances, see fontChange()
+    QGlyphRun _glyphRun;     // reused by drawCharacters()
     bool _fixedFont; // has fixed pitch
     bool _fixedFont_original; // used only in textWidth()
     int  _fontHeight;     // height
@@ -817,6 +877,10 @@ private:
 
     int _imageSize;
     QVector<LineProperty> _lineProperties;
+    // _image was cleared or scrolled, so updateImage() has to compare all lines
+    // instead of only those reported by ScreenWindow::dirtyLines()
+    bool _compareAllLines;
+    QBitArray _blinkingLines; // lines of _image with characters to blink
 
     ColorEntry _colorTable[TABLE_COLORS];
 
@@ -897,6 +961,14 @@ private:
     TerminalImageFilterChain* _filterChain;
     QRegion _mouseOverHotspotArea;
 
+    // matches of the history search sorted by position, see addSearchMatches()
+    QVector<HistorySearch::Match> _searchMatches;
+    QVector<int> _searchMatchLines;  // distinct start lines, for the scroll bar
+    Screen* _searchMatchScreen = nullptr;
+    quint64 _searchMatchBase = 0;
+    int _currentSearchMatch = -1;
+    bool _searchMatchesVisible = true;
+
     QTermWidget::KeyboardCursorShape _cursorShape;
 
     // custom cursor color.  if this is invalid then the foreground
@@ -935,6 +1007,19 @@ private:
     QWidget *messageParentWidget = nullptr;
 
     bool _fix_quardCRT_issue33 = false;
+
+    // frame pacing, see scheduleFrame()
+    int frameInterval() const;
+    QTimer *_frameTimer = nullptr;
+    QElapsedTimer _lastFrame;     // when the last frame was painted
+    QElapsedTimer _lastKeyPress;  // when the user last typed into the display
+    bool _framePending = false;   // output arrived while hidden
+    bool _suspended = false;
+    QElapsedTimer _lastSkippedFrame;
+    int _skippedFrames = 0;
+    qint64 _frameCostNsecs = 0;   // running average of paintFrame()
+    qint64 _paintCostNsecs = 0;   // running average of paintEvent()
+    int _paintedFrames = 0;
 };
 
 class AutoScrollHandler : public QObject
@@ -956,8 +1041,23 @@ Q_OBJECT
 
 public:
     ScrollBar(QWidget* parent = nullptr);
+
+    /**
+     * Marks @p lines on the groove, e.g. the lines with search matches.  The
+     * lines are sorted and the marker offset is subtracted from them before
+     * they are mapped to the scroll range, see setMarkerOffset().
+     */
+    void setMarkers(const QVector<int> &lines, int currentLine);
+    void setMarkerOffset(int offset);
+
 protected:
     void enterEvent(QEnterEvent* event) override;
+    void paintEvent(QPaintEvent* event) override;
+
+private:
+    QVector<int> _markers;
+    int _currentMarker = -1;
+    int _markerOffset = 0;
 };
 
 class MultilineConfirmationMessageBox : public QDialog {
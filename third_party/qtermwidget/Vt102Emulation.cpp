@@ -35,7 +35,7 @@
 #include "Screen.h"
 
 Vt102Emulation::Vt102Emulation()
-        : Emulation(), prevCC(0), _titleUpdateTimer(new QTimer(this)),
+        : Emulation(), prevCC(0), _tableDrivenParser(false), _titleUpdateTimer(new QTimer(this)),
             _reportFocusEvents(false), _toUtf8(QStringEncoder::Utf8),
             _isTitleChanged(false) {
     _titleUpdateTimer->setSingleShot(true);
@@ -150,12 +150,163 @@ void Vt102Emulation::reset() {
      Note that they are kept internal in the tokenizer.
 */
 
+/*
+   The table driven parser follows the DEC compatible state machine described
+   at https://vt100.net/emu/dec_ansi_parser, reduced to what processToken()
+   understands.  Each state has one transition per input class: the 7-bit
+   characters, the 8-bit CSI, the 8-bit ST and everything else.  A transition combines an
+   action with the next state and the whole table is built at compile time.
+
+   Parameters are accumulated into argv as the digits arrive, OSC strings are
+   collected into tokenBuffer in the layout processOSC() expects, DCS and
+   SOS/PM/APC strings are consumed without effect.
+*/
+
+namespace {
+
+enum ParserState : quint8 {
+    StateGround,
+    StateEscape,
+    StateEscapeIntermediate,
+    StateCsiEntry,
+    StateCsiParam,
+    StateCsiIntermediate,
+    StateCsiIgnore,
+    StateOscString,
+    StateDcsPassthrough,
+    StateSosPmApcString,
+    StateCount
+};
+
+enum ParserAction : quint8 {
+    ActionNone,
+    ActionPrint,
+    ActionExecute,
+    ActionClear,
+    ActionCollect,
+    ActionParam,
+    ActionEscDispatch,
+    ActionCsiDispatch,
+    ActionOscStart,
+    ActionOscPut,
+    ActionOscEnd
+};
+
+constexpr int CLASS_CSI = 0x80;   // 8-bit CSI
+constexpr int CLASS_ST = 0x81;    // 8-bit ST
+constexpr int CLASS_OTHER = 0x82; // any other character above 0x7f
+constexpr int CLASS_COUNT = 0x83;
+
+struct TransitionTable {
+    // action in the high nibble, next state in the low nibble
+    quint8 entries[StateCount][CLASS_COUNT];
+};
+
+constexpr TransitionTable buildTransitionTable() {
+    TransitionTable table{};
+
+    auto set = [&table](int state, int first, int last, ParserAction action, ParserState next) {
+        for (int c = first; c <= last; ++c)
+            table.entries[state][c] = static_cast<quint8>((action << 4) | next);
+    };
+    // C0 controls except the ones handled "anywhere"
+    auto controls = [&set](int state, ParserAction action) {
+        const auto next = static_cast<ParserState>(state);
+        set(state, 0x00, 0x17, action, next);
+        set(state, 0x19, 0x19, action, next);
+        set(state, 0x1c, 0x1f, action, next);
+    };
+
+    for (int state = 0; state < StateCount; ++state)
+        set(state, 0, CLASS_COUNT - 1, ActionNone, static_cast<ParserState>(state));
+
+    controls(StateGround, ActionExecute);
+    set(StateGround, 0x20, 0x7e, ActionPrint, StateGround);
+    set(StateGround, CLASS_OTHER, CLASS_OTHER, ActionPrint, StateGround);
+
+    controls(StateEscape, ActionExecute);
+    set(StateEscape, 0x20, 0x2f, ActionCollect, StateEscapeIntermediate);
+    set(StateEscape, 0x30, 0x7e, ActionEscDispatch, StateGround);
+    set(StateEscape, '[', '[', ActionClear, StateCsiEntry);
+    set(StateEscape, ']', ']', ActionOscStart, StateOscString);
+    set(StateEscape, 'P', 'P', ActionNone, StateDcsPassthrough);
+    set(StateEscape, 'X', 'X', ActionNone, StateSosPmApcString);
+    set(StateEscape, '^', '^', ActionNone, StateSosPmApcString);
+    set(StateEscape, '_', '_', ActionNone, StateSosPmApcString);
+    set(StateEscape, CLASS_OTHER, CLASS_OTHER, ActionNone, StateGround);
+
+    controls(StateEscapeIntermediate, ActionExecute);
+    set(StateEscapeIntermediate, 0x20, 0x2f, ActionCollect, StateEscapeIntermediate);
+    set(StateEscapeIntermediate, 0x30, 0x7e, ActionEscDispatch, StateGround);
+    set(StateEscapeIntermediate, CLASS_OTHER, CLASS_OTHER, ActionNone, StateGround);
+
+    // ':' separates arguments like ';' does, see the tokenizer
+    controls(StateCsiEntry, ActionExecute);
+    set(StateCsiEntry, 0x20, 0x2f, ActionCollect, StateCsiIntermediate);
+    set(StateCsiEntry, 0x30, 0x3b, ActionParam, StateCsiParam);
+    set(StateCsiEntry, 0x3c, 0x3f, ActionCollect, StateCsiParam);
+    set(StateCsiEntry, 0x40, 0x7e, ActionCsiDispatch, StateGround);
+    set(StateCsiEntry, CLASS_OTHER, CLASS_OTHER, ActionNone, StateCsiIgnore);
+
+    controls(StateCsiParam, ActionExecute);
+    set(StateCsiParam, 0x20, 0x2f, ActionCollect, StateCsiIntermediate);
+    set(StateCsiParam, 0x30, 0x3b, ActionParam, StateCsiParam);
+    set(StateCsiParam, 0x3c, 0x3f, ActionNone, StateCsiIgnore);
+    set(StateCsiParam, 0x40, 0x7e, ActionCsiDispatch, StateGround);
+    set(StateCsiParam, CLASS_OTHER, CLASS_OTHER, ActionNone, StateCsiIgnore);
+
+    controls(StateCsiIntermediate, ActionExecute);
+    set(StateCsiIntermediate, 0x20, 0x2f, ActionCollect, StateCsiIntermediate);
+    set(StateCsiIntermediate, 0x30, 0x3f, ActionNone, StateCsiIgnore);
+    set(StateCsiIntermediate, 0x40, 0x7e, ActionCsiDispatch, StateGround);
+    set(StateCsiIntermediate, CLASS_OTHER, CLASS_OTHER, ActionNone, StateCsiIgnore);
+
+    controls(StateCsiIgnore, ActionExecute);
+    set(StateCsiIgnore, 0x40, 0x7e, ActionNone, StateGround);
+
+    // other controls inside OSC are ignored, like xterm does
+    set(StateOscString, 0x07, 0x07, ActionOscEnd, StateGround);
+    set(StateOscString, 0x20, 0x7e, ActionOscPut, StateOscString);
+    set(StateOscString, CLASS_CSI, CLASS_OTHER, ActionOscPut, StateOscString);
+
+    // 8-bit ST ends the control strings like ESC \ does; elsewhere it is an
+    // ordinary character above 0x7f, as the tokenizer treats it
+    for (int state = 0; state < StateCount; ++state)
+        table.entries[state][CLASS_ST] = table.entries[state][CLASS_OTHER];
+    set(StateOscString, CLASS_ST, CLASS_ST, ActionOscEnd, StateGround);
+    set(StateDcsPassthrough, CLASS_ST, CLASS_ST, ActionNone, StateGround);
+    set(StateSosPmApcString, CLASS_ST, CLASS_ST, ActionNone, StateGround);
+
+    // transitions from "anywhere"
+    for (int state = 0; state < StateCount; ++state) {
+        if (state == StateOscString) {
+            // CAN and SUB abort the string, ESC may start the ST terminator
+            set(state, 0x18, 0x18, ActionNone, StateGround);
+            set(state, 0x1a, 0x1a, ActionNone, StateGround);
+            set(state, 0x1b, 0x1b, ActionOscEnd, StateEscape);
+            continue;
+        }
+        set(state, 0x18, 0x18, ActionExecute, StateGround);
+        set(state, 0x1a, 0x1a, ActionExecute, StateGround);
+        set(state, 0x1b, 0x1b, ActionClear, StateEscape);
+        set(state, CLASS_CSI, CLASS_CSI, ActionClear, StateCsiEntry);
+    }
+
+    return table;
+}
+
+constexpr TransitionTable TRANSITIONS = buildTransitionTable();
+
+} // namespace
+
 void Vt102Emulation::resetTokenizer() {
     tokenBufferPos = 0;
     argc = 0;
     argv[0] = 0;
     argv[1] = 0;
     prevCC = 0;
+    _parserState = StateGround;
+    _collectedCount = 0;
 }
 
 void Vt102Emulation::addDigit(int digit) {
@@ -246,6 +397,11 @@ void Vt102Emulation::initTokenizer() {
 
 // process an incoming unicode character
 void Vt102Emulation::receiveChar(wchar_t cc) {
+    if (_tableDrivenParser && getMode(MODE_Ansi)) {
+        parseChar(cc);
+        return;
+    }
+
     if (cc == DEL)
         return; // VT100: ignore.
 
@@ -404,6 +560,183 @@ void Vt102Emulation::receiveChar(wchar_t cc) {
     }
 }
 
+// process a run of incoming unicode characters
+void Vt102Emulation::receiveChars(const wchar_t *chars, int count) {
+    int i = 0;
+    while (i < count) {
+        // in the ground state printable characters become TY_CHR() tokens one
+        // by one, hand whole runs of them to the screen instead
+        const CharCodes &charset = _charset[_currentScreen == _screen[1]];
+        const bool ground = _tableDrivenParser ? _parserState == StateGround : tokenBufferPos == 0;
+        if (ground && getMode(MODE_Ansi) && !charset.graphic && !charset.pound) {
+            int run = i;
+            while (run < count && chars[run] >= 32 && chars[run] != DEL && chars[run] != ESC + 128)
+                ++run;
+            if (run > i) {
+                _currentScreen->displayCharacters(chars + i, run - i);
+                i = run;
+                continue;
+            }
+        }
+        receiveChar(chars[i++]);
+    }
+}
+
+void Vt102Emulation::setTableDrivenParser(bool enabled) {
+    if (_tableDrivenParser == enabled)
+        return;
+    _tableDrivenParser = enabled;
+    resetTokenizer();
+}
+
+void Vt102Emulation::setTokenObserver(TokenObserver observer) {
+    _tokenObserver = std::move(observer);
+}
+
+void Vt102Emulation::parseChar(wchar_t cc) {
+    const uint code = static_cast<uint>(cc);
+    const int inputClass = code < 0x80 ? static_cast<int>(code)
+                         : code == 0x9b ? CLASS_CSI
+                         : code == 0x9c ? CLASS_ST
+                         : CLASS_OTHER;
+    const quint8 transition = TRANSITIONS.entries[_parserState][inputClass];
+    _parserState = transition & 0x0f;
+
+    switch (transition >> 4) {
+    case ActionNone:
+        break;
+    case ActionPrint:
+        processToken(TY_CHR(), applyCharset(cc), 0);
+        break;
+    case ActionExecute:
+        processToken(TY_CTL(cc + '@'), 0, 0);
+        break;
+    case ActionClear:
+        argc = 0;
+        argv[0] = 0;
+        argv[1] = 0;
+        _collectedCount = 0;
+        break;
+    case ActionCollect:
+        if (_collectedCount < 2)
+            _collected[_collectedCount++] = cc;
+        break;
+    case ActionParam:
+        if (cc == ';' || cc == ':')
+            addArgument();
+        else
+            addDigit(cc - '0');
+        break;
+    case ActionEscDispatch:
+        escDispatch(cc);
+        break;
+    case ActionCsiDispatch:
+        csiDispatch(cc);
+        break;
+    case ActionOscStart:
+        tokenBufferPos = 0;
+        addToCurrentToken(ESC);
+        addToCurrentToken(']');
+        break;
+    case ActionOscPut:
+        addToCurrentToken(cc);
+        break;
+    case ActionOscEnd:
+        // processOSC() expects a terminator after the text
+        addToCurrentToken(7);
+        processOSC();
+        tokenBufferPos = 0;
+        argc = 0;
+        argv[0] = 0;
+        argv[1] = 0;
+        _collectedCount = 0;
+        break;
+    }
+}
+
+void Vt102Emulation::escDispatch(wchar_t cc) {
+    if (_collectedCount == 0) {
+        // ESC \ is the string terminator, the string has been handled already
+        if (cc != '\\')
+            processToken(TY_ESC(cc), 0, 0);
+        return;
+    }
+
+    const wchar_t intermediate = _collected[0];
+    if (_collectedCount == 1 && intermediate == '#')
+        processToken(TY_ESC_DE(cc), 0, 0);
+    else if (_collectedCount == 1 && (charClass[intermediate] & SCS) == SCS)
+        processToken(TY_ESC_CS(intermediate, cc), 0, 0);
+    else
+        reportDecodingError();
+}
+
+void Vt102Emulation::csiDispatch(wchar_t cc) {
+    wchar_t marker = 0;
+    wchar_t intermediate = 0;
+    for (int i = 0; i < _collectedCount; ++i) {
+        if (_collected[i] >= 0x3c)
+            marker = _collected[i];
+        else
+            intermediate = _collected[i];
+    }
+
+    if (intermediate) {
+        if (marker)
+            reportDecodingError();
+        else if (intermediate == '!')
+            processToken(TY_CSI_PE(cc), 0, 0);
+        else if (intermediate == ' ')
+            processToken(TY_CSI_PS_SP(cc, argv[0]), argv[0], 0);
+        else
+            reportDecodingError();
+        return;
+    }
+
+    if (marker == '?') {
+        for (int i = 0; i <= argc; i++)
+            processToken(TY_CSI_PR(cc, argv[i]), 0, 0);
+        return;
+    }
+    if (marker == '>') {
+        for (int i = 0; i <= argc; i++)
+            processToken(TY_CSI_PG(cc), 0, 0); // spec. case for ESC]>0c or ESC]>c
+        return;
+    }
+    if (marker) {
+        reportDecodingError();
+        return;
+    }
+
+    if ((charClass[cc] & CPN) == CPN) {
+        processToken(TY_CSI_PN(cc), argv[0], argv[1]);
+        return;
+    }
+    // resize = \e[8;<row>;<col>t
+    if ((charClass[cc] & CPS) == CPS) {
+        processToken(TY_CSI_PS(cc, argv[0]), argv[1], argv[2]);
+        return;
+    }
+
+    for (int i = 0; i <= argc; i++) {
+        if (cc == 'm' && argc - i >= 4 && (argv[i] == 38 || argv[i] == 48) &&
+                argv[i + 1] == 2) {
+            // ESC[ ... 48;2;<red>;<green>;<blue> ... m -or- ESC[ ...
+            // 38;2;<red>;<green>;<blue> ... m
+            i += 2;
+            processToken(TY_CSI_PS(cc, argv[i - 2]), COLOR_SPACE_RGB,
+                         (argv[i] << 16) | (argv[i + 1] << 8) | argv[i + 2]);
+            i += 2;
+        } else if (cc == 'm' && argc - i >= 2 &&
+                   (argv[i] == 38 || argv[i] == 48) && argv[i + 1] == 5) {
+            // ESC[ ... 48;5;<index> ... m -or- ESC[ ... 38;5;<index> ... m
+            i += 2;
+            processToken(TY_CSI_PS(cc, argv[i - 2]), COLOR_SPACE_256, argv[i]);
+        } else
+            processToken(TY_CSI_PS(cc, argv[i]), 0, 0);
+    }
+}
+
 void Vt102Emulation::processOSC() {
     QString token = QString::fromWCharArray(tokenBuffer, tokenBufferPos);
     int i = 2;
@@ -591,6 +924,9 @@ void Vt102Emulation::doTitleChanged(int what, const QString &caption) {
 */
 
 void Vt102Emulation::processToken(int token, wchar_t p, int q) {
+    if (_tokenObserver)
+        _tokenObserver(token, p, q);
+
     switch (token) {
     case TY_CHR():
         _currentScreen->displayCharacter(p);
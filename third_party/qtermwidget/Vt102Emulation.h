@@ -24,6 +24,7 @@
 #define VT102EMULATION_H
 
 #include <cstdio>
+#include <functional>
 
 #include <QKeyEvent>
 #include <QHash>
@@ -83,6 +84,23 @@ public:
   void reset() override;
   char eraseChar() const override;
 
+  /**
+   * Selects the table driven VT500 state machine parser instead of the
+   * classic tokenizer.  Only ANSI mode input goes through it, VT52 mode is
+   * always handled by the tokenizer.
+   */
+  void setTableDrivenParser(bool enabled);
+  bool tableDrivenParser() const { return _tableDrivenParser; }
+
+  /**
+   * Calls @p observer with every token before it is processed, e.g. to
+   * compare the token streams of the two parsers in a test.  Runs of
+   * printable characters which are handed to the screen in bulk are not
+   * tokens and are not reported.
+   */
+  using TokenObserver = std::function<void(int token, wchar_t p, int q)>;
+  void setTokenObserver(TokenObserver observer);
+
 signals:
   /**
     * Requests that the background color of views on this session
@@ -106,6 +124,7 @@ protected:
   void setMode(int mode) override;
   void resetMode(int mode) override;
   void receiveChar(wchar_t cc) override;
+  void receiveChars(const wchar_t *chars, int count) override;
 
 private slots:
   //causes changeTitle() to be emitted for each (int,QString) pair in pendingTitleUpdates
@@ -156,6 +175,16 @@ private:
 
   void reportDecodingError();
 
+  // table driven parser, see setTableDrivenParser()
+  void parseChar(wchar_t cc);
+  void escDispatch(wchar_t cc);
+  void csiDispatch(wchar_t cc);
+  bool _tableDrivenParser;
+  quint8 _parserState;
+  wchar_t _collected[2]; // private marker and/or intermediate characters
+  int _collectedCount;
+  TokenObserver _tokenObserver;
+
   void processToken(int code, wchar_t p, int q);
   void processOSC();
   void processWindowAttributeChange(int attributeToChange, QString newValue);
@@ -22,6 +22,8 @@
 #include <QDir>
 #include <QMessageBox>
 #include <QRegularExpression>
+#include <QMetaMethod>
+#include <QThread>
 
 #include "CharacterColor.h"
 #include "Screen.h"
@@ -32,8 +34,19 @@
 #include "KeyboardTranslator.h"
 #include "ColorScheme.h"
 #include "SearchBar.h"
+#include "RingBuffer.h"
+#include "Asciicast.h"
 #include "qtermwidget.h"
 
+// bytes buffered between a session I/O thread and the emulation
+static const int RECEIVE_QUEUE_SIZE = 1024 * 1024;
+// largest chunk handed to Emulation::receiveData() at once
+static const int RECEIVE_CHUNK_SIZE = 16 * 1024;
+// GUI time spent parsing per drain before input and paint events get a turn
+static const int RECEIVE_TIME_SLICE_MS = 8;
+// how long a producer sleeps on a full queue before re-checking for interruption
+static const int RECEIVE_WAIT_MS = 50;
+
 
 QTermWidget::QTermWidget(QWidget *messageParentWidget, QWidget *parent)
     : QWidget(parent) {
@@ -41,6 +54,9 @@ QTermWidget::QTermWidget(QWidget *messageParentWidget, QWidget *parent)
     m_layout->setContentsMargins(0, 0, 0, 0);
     setLayout(m_layout);
 
+    m_receiveRing = new RingBuffer(RECEIVE_QUEUE_SIZE);
+    m_receiveRateTimer.start();
+
     m_terminalDisplay = new TerminalDisplay(this);
     m_emulation = new Vt102Emulation();
     m_terminalDisplay->setBellMode(TerminalDisplay::SystemBeepBell);
@@ -66,7 +82,10 @@ QTermWidget::QTermWidget(QWidget *messageParentWidget, QWidget *parent)
     m_terminalDisplay->setBracketedPasteMode(m_emulation->programBracketedPasteMode());
     m_terminalDisplay->setScreenWindow(m_emulation->createWindow());
     connect(m_emulation, &Emulation::primaryScreenInUse, m_terminalDisplay, &TerminalDisplay::usingPrimaryScreen);
-    connect(m_emulation, &Emulation::imageSizeChanged, this, [this](int /*height*/, int /*width*/){
+    connect(m_emulation, &Emulation::imageSizeChanged, this, [this](int height, int width){
+        if (m_recorder) {
+            m_recorder->resize(width, height);
+        }
         updateTerminalSize();
     });
     connect(m_terminalDisplay, &TerminalDisplay::changedContentSizeSignal, this, [this](int /*height*/, int /*width*/){
@@ -75,7 +94,7 @@ QTermWidget::QTermWidget(QWidget *messageParentWidget, QWidget *parent)
 
     setFlowControlEnabled(true);
     m_emulation->setCodec(QStringEncoder{QStringConverter::Encoding::Utf8});
-    m_emulation->setHistory(HistoryTypeBuffer(1000));
+    m_emulation->setHistory(HistoryTypeCompact(1000));
     m_emulation->setKeyBindings(QString());
 
     m_layout->addWidget(m_terminalDisplay);
@@ -92,6 +111,10 @@ QTermWidget::QTermWidget(QWidget *messageParentWidget, QWidget *parent)
     connect(m_emulation, &Emulation::titleChanged, this, &QTermWidget::titleChanged);
     // redirect data from TTY to external recipient
     connect(m_emulation, &Emulation::sendData, this, [this](const char *buff, int len) {
+        // answers to queries in a recording must not reach a session
+        if (isReplaying()) {
+            return;
+        }
         if (m_echo) {
             recvData(buff, len);
         }
@@ -106,9 +129,12 @@ QTermWidget::QTermWidget(QWidget *messageParentWidget, QWidget *parent)
     m_terminalDisplay->filterChain()->addFilter(m_urlFilter);
     m_UrlFilterEnable = true;
 
+    m_keywordFilter = new KeywordFilter();
+
     m_searchBar = new SearchBar(this);
     m_searchBar->setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::Maximum);
     connect(m_searchBar, &SearchBar::searchCriteriaChanged, this, [this](){
+        clearSearchMatches();
         search(true, false);
     });
     connect(m_searchBar, &SearchBar::findNext, this, [this](){
@@ -117,6 +143,13 @@ QTermWidget::QTermWidget(QWidget *messageParentWidget, QWidget *parent)
     connect(m_searchBar, &SearchBar::findPrevious, this, [this](){
         search(false, false);
     });
+    connect(m_searchBar, &SearchBar::highlightMatchesChanged, m_terminalDisplay, &TerminalDisplay::setSearchMatchesVisible);
+    connect(m_searchBar, &SearchBar::closed, this, &QTermWidget::clearSearchMatches);
+    // new lines and trimmed history are not in the matches of a search
+    connect(m_emulation, &Emulation::outputChanged, this, [this](){
+        m_searchMatchesStale = true;
+    });
+    m_terminalDisplay->setSearchMatchesVisible(m_searchBar->highlightAllMatches());
     m_layout->addWidget(m_searchBar);
     m_searchBar->hide();
     QString style_sheet = qApp->styleSheet();
@@ -148,17 +181,24 @@ QTermWidget::QTermWidget(QWidget *messageParentWidget, QWidget *parent)
     });
 
     //qiushao patch start
-    connect(m_terminalDisplay->screenWindow()->screen(), &Screen::onNewLine, this, &QTermWidget::onNewLine);
+    m_lineScreen = m_terminalDisplay->screenWindow()->screen();
+    connect(m_emulation, &Emulation::outputChanged, this, &QTermWidget::flushNewLines);
     //qiushao patch end
 }
 
 QTermWidget::~QTermWidget() {
     setUrlFilterEnabled(false);
     clearHighLightTexts();
+    delete m_keywordFilter;
     delete m_urlFilter;
+    delete m_historySearch;
     delete m_searchBar;
+    delete m_recorder;
+    delete m_player;
     emit destroyed();
+    m_lineScreen = nullptr;
     delete m_emulation;
+    delete m_receiveRing;
 }
 
 void QTermWidget::selectionChanged(bool textSelected) {
@@ -166,6 +206,21 @@ void QTermWidget::selectionChanged(bool textSelected) {
 }
 
 void QTermWidget::search(bool forwards, bool next) {
+    // the matches of the last search are stepped through without running
+    // the regular expression again as long as the output has not changed.
+    // While the search is still adding matches the list is incomplete, the
+    // steps are collected and applied once it has finished
+    if (!m_searchMatchesStale) {
+        if (m_historySearch) {
+            m_pendingSearchSteps += forwards ? 1 : -1;
+            return;
+        }
+        if (m_terminalDisplay->searchMatchCount() > 0) {
+            stepSearchMatch(forwards ? 1 : -1);
+            return;
+        }
+    }
+
     int startColumn, startLine;
 
     if (next) {
@@ -188,24 +243,77 @@ void QTermWidget::search(bool forwards, bool next) {
     }
     regExp.setPatternOptions(m_searchBar->matchCase() ? QRegularExpression::NoPatternOption : QRegularExpression::CaseInsensitiveOption);
 
+    if (m_historySearch)
+        m_historySearch->cancel();
+
     HistorySearch *historySearch =
             new HistorySearch(m_emulation, regExp, forwards, startColumn, startLine, this);
-    connect(historySearch, &HistorySearch::matchFound, this, [this](int startColumn, int startLine, int endColumn, int endLine){
-        ScreenWindow* sw = m_terminalDisplay->screenWindow();
-        //qDebug() << "Scroll to" << startLine;
-        sw->scrollTo(startLine);
-        sw->setTrackOutput(false);
-        sw->notifyOutputChanged();
-        sw->setSelectionStart(startColumn, startLine - sw->currentLine(), false);
-        sw->setSelectionEnd(endColumn, endLine - sw->currentLine());
+    m_historySearch = historySearch;
+    m_searchMatchesStale = false;
+    m_pendingSearchSteps = 0;
+    m_terminalDisplay->clearSearchMatches();
+    connect(historySearch, &HistorySearch::matchFound, this, &QTermWidget::showSearchMatch);
+    connect(historySearch, &HistorySearch::matchesFound, this, [this](const QVector<HistorySearch::Match> &matches){
+        const int first = m_terminalDisplay->addSearchMatches(matches);
+        if (m_terminalDisplay->currentSearchMatch() < 0)
+            m_terminalDisplay->setCurrentSearchMatch(first);
+        m_searchBar->setMatchCount(m_terminalDisplay->currentSearchMatch(), m_terminalDisplay->searchMatchCount());
     });
     connect(historySearch, &HistorySearch::noMatchFound, this, [this](){
         m_terminalDisplay->screenWindow()->clearSelection();
     });
     connect(historySearch, &HistorySearch::noMatchFound, m_searchBar, &SearchBar::noMatchFound);
+    connect(historySearch, &HistorySearch::progress, m_searchBar, &SearchBar::setSearchProgress);
+    connect(historySearch, &HistorySearch::finished, m_searchBar, &SearchBar::clearSearchProgress);
+    connect(historySearch, &HistorySearch::finished, this, [this](){
+        m_historySearch = nullptr;
+        const int steps = m_pendingSearchSteps;
+        m_pendingSearchSteps = 0;
+        if (steps != 0)
+            stepSearchMatch(steps);
+    });
+    m_searchBar->clearSearchProgress();
     historySearch->search();
 }
 
+void QTermWidget::showSearchMatch(int startColumn, int startLine, int endColumn, int endLine) {
+    ScreenWindow* sw = m_terminalDisplay->screenWindow();
+    //qDebug() << "Scroll to" << startLine;
+    sw->scrollTo(startLine);
+    sw->setTrackOutput(false);
+    sw->notifyOutputChanged();
+    sw->setSelectionStart(startColumn, startLine - sw->currentLine(), false);
+    sw->setSelectionEnd(endColumn, endLine - sw->currentLine());
+}
+
+void QTermWidget::selectSearchMatch(int index) {
+    m_terminalDisplay->setCurrentSearchMatch(index);
+    const HistorySearch::Match match = m_terminalDisplay->searchMatch(index);
+    showSearchMatch(match.startColumn, match.startLine, match.endColumn, match.endLine);
+    m_searchBar->setMatchCount(index, m_terminalDisplay->searchMatchCount());
+}
+
+void QTermWidget::stepSearchMatch(int steps) {
+    const int matchCount = m_terminalDisplay->searchMatchCount();
+    if (matchCount == 0)
+        return;
+
+    int index = m_terminalDisplay->currentSearchMatch();
+    if (index < 0)
+        index = steps > 0 ? -1 : 0;
+    selectSearchMatch(((index + steps) % matchCount + matchCount) % matchCount);
+}
+
+void QTermWidget::clearSearchMatches() {
+    if (m_historySearch)
+        m_historySearch->cancel();
+    m_historySearch = nullptr;
+    m_pendingSearchSteps = 0;
+    m_terminalDisplay->clearSearchMatches();
+    m_searchBar->clearSearchProgress();
+    m_searchBar->setMatchCount(-1, 0);
+}
+
 QSize QTermWidget::sizeHint() const {
     QSize size = m_terminalDisplay->sizeHint();
     size.rheight() = 150;
@@ -310,10 +418,12 @@ void QTermWidget::setSize(const QSize &size) {
 }
 
 void QTermWidget::setHistorySize(int lines) {
-    if (lines <= 0)
+    if (lines < 0)
+        m_emulation->setHistory(HistoryTypeFile());
+    else if (lines == 0)
         m_emulation->setHistory(HistoryTypeNone());
     else
-        m_emulation->setHistory(HistoryTypeBuffer(lines));
+        m_emulation->setHistory(HistoryTypeCompact(lines));
 }
 
 int QTermWidget::historySize() const {
@@ -351,6 +461,41 @@ void QTermWidget::resizeEvent(QResizeEvent*) {
     m_terminalDisplay->resize(this->size());
 }
 
+void QTermWidget::connectNotify(const QMetaMethod &signal) {
+    if (signal == QMetaMethod::fromSignal(&QTermWidget::newLines)) {
+        // consumers may connect from a script thread, the screen belongs to us
+        QMetaObject::invokeMethod(this, &QTermWidget::updateLineCapture, Qt::AutoConnection);
+    }
+}
+
+void QTermWidget::disconnectNotify(const QMetaMethod &signal) {
+    // an invalid method means "all signals", e.g. a receiver being destroyed
+    if (!signal.isValid() || signal == QMetaMethod::fromSignal(&QTermWidget::newLines)) {
+        QMetaObject::invokeMethod(this, &QTermWidget::updateLineCapture, Qt::AutoConnection);
+    }
+}
+
+void QTermWidget::updateLineCapture() {
+    if (m_lineScreen == nullptr) {
+        return;
+    }
+    m_lineScreen->setLineCaptureEnabled(isSignalConnected(QMetaMethod::fromSignal(&QTermWidget::newLines)));
+}
+
+void QTermWidget::flushNewLines() {
+    if (m_lineScreen == nullptr || !m_lineScreen->lineCaptureEnabled()) {
+        return;
+    }
+    const QStringList lines = m_lineScreen->takeCapturedLines();
+    // replayed output is not session output, keep it out of logs and waits
+    if (lines.isEmpty() || isReplaying()) {
+        return;
+    }
+    const quint64 firstSequence = m_lineSequence;
+    m_lineSequence += lines.size();
+    emit newLines(firstSequence, lines);
+}
+
 void QTermWidget::sessionFinished() {
     emit finished();
 }
@@ -571,6 +716,22 @@ int QTermWidget::historyLinesCount() {
     return m_terminalDisplay->screenWindow()->screen()->getHistLines();
 }
 
+qint64 QTermWidget::historyMemoryUsage() const {
+    return m_emulation->historyMemoryUsage();
+}
+
+void QTermWidget::setHistoryMemoryBudget(qint64 bytes) {
+    HistoryMemoryBudget::instance()->setBudget(bytes);
+}
+
+qint64 QTermWidget::historyMemoryBudget() {
+    return HistoryMemoryBudget::instance()->budget();
+}
+
+qint64 QTermWidget::totalHistoryMemoryUsage() {
+    return HistoryMemoryBudget::instance()->usage();
+}
+
 int QTermWidget::screenColumnsCount() {
     return m_terminalDisplay->screenWindow()->screen()->getColumns();
 }
@@ -614,10 +775,126 @@ QList<QAction*> QTermWidget::filterActions(const QPoint& position) {
 }
 
 int QTermWidget::recvData(const char *buff, int len) const {
+    if (m_recorder) {
+        m_recorder->output(buff, len);
+    }
     m_emulation->receiveData( buff, len );
     return len;
 }
 
+int QTermWidget::enqueueData(const char *buff, int len) {
+    if (QThread::currentThread() == thread()) {
+        // nobody would drain the queue while we wait for it
+        return recvData(buff, len);
+    }
+
+    int queued = 0;
+    while (queued < len) {
+        queued += m_receiveRing->write(buff + queued, len - queued);
+        if (!m_drainScheduled.exchange(true)) {
+            QMetaObject::invokeMethod(this, &QTermWidget::drainReceiveQueue, Qt::QueuedConnection);
+        }
+        if (queued < len && !m_receiveRing->waitForSpace(RECEIVE_WAIT_MS)) {
+            if (QThread::currentThread()->isInterruptionRequested()) {
+                break;
+            }
+        }
+    }
+    return queued;
+}
+
+int QTermWidget::receiveQueueDepth() const {
+    return m_receiveRing->size();
+}
+
+qint64 QTermWidget::receiveBytesPerSecond() const {
+    // the rate is only refreshed while data flows, treat a stale value as idle
+    return m_receiveRateTimer.elapsed() > 2000 ? 0 : m_receiveBytesPerSecond;
+}
+
+void QTermWidget::startRecording(QIODevice *device, const QString &title) {
+    delete m_recorder;
+    const QSize size = m_emulation->imageSize();
+    m_recorder = new AsciicastRecorder(device, size.width(), size.height(), title);
+}
+
+void QTermWidget::stopRecording() {
+    delete m_recorder;
+    m_recorder = nullptr;
+}
+
+bool QTermWidget::isRecording() const {
+    return m_recorder != nullptr;
+}
+
+bool QTermWidget::startReplay(QIODevice *device, double speed, QString *errorString) {
+    if (!m_player) {
+        m_player = new AsciicastPlayer();
+        // played back output bypasses recvData() so that it is not recorded again
+        connect(m_player, &AsciicastPlayer::output, this, [this](const QByteArray &data) {
+            m_emulation->receiveData(data.constData(), static_cast<int>(data.size()));
+        });
+        connect(m_player, &AsciicastPlayer::resized, this, [this](int columns, int lines) {
+            // full screen programs only look right at the size they were recorded at
+            m_terminalDisplay->setFixedSize(columns, lines);
+            m_emulation->setImageSize(lines, columns);
+            if (isWindow()) {
+                adjustSize();
+            }
+        });
+        connect(m_player, &AsciicastPlayer::finished, this, &QTermWidget::replayFinished);
+    }
+    if (!m_player->load(device, errorString)) {
+        return false;
+    }
+    m_player->start(speed);
+    return true;
+}
+
+void QTermWidget::stopReplay() {
+    if (m_player) {
+        m_player->stop();
+    }
+}
+
+bool QTermWidget::isReplaying() const {
+    return m_player && m_player->isPlaying();
+}
+
+void QTermWidget::drainReceiveQueue() {
+    // clear the flag first: a producer which queues data after we stop
+    // reading must schedule another drain
+    m_drainScheduled = false;
+
+    QElapsedTimer slice;
+    slice.start();
+    const char *data = nullptr;
+    int len = 0;
+    while ((len = m_receiveRing->peek(&data, RECEIVE_CHUNK_SIZE)) > 0) {
+        if (m_recorder) {
+            m_recorder->output(data, len);
+        }
+        m_emulation->receiveData(data, len);
+        m_receiveRing->consume(len);
+        m_receiveRateBytes += len;
+        if (slice.elapsed() >= RECEIVE_TIME_SLICE_MS) {
+            break;
+        }
+    }
+
+    const qint64 elapsed = m_receiveRateTimer.elapsed();
+    if (elapsed >= 1000) {
+        m_receiveBytesPerSecond = m_receiveRateBytes * 1000 / elapsed;
+        m_receiveRateBytes = 0;
+        m_receiveRateTimer.restart();
+    }
+
+    if (!m_receiveRing->isEmpty() && !m_drainScheduled.exchange(true)) {
+        // a zero timer lets pending input and paint events run first
+        QTimer::singleShot(0, this, &QTermWidget::drainReceiveQueue);
+    }
+}
+
 void QTermWidget::setKeyboardCursorShape(KeyboardCursorShape shape) {
     m_terminalDisplay->setKeyboardCursorShape(shape);
 }
@@ -626,6 +903,33 @@ void QTermWidget::setKeyboardCursorShape(uint32_t shape) {
     m_terminalDisplay->setKeyboardCursorShape((KeyboardCursorShape)shape);
 }
 
+void QTermWidget::setTableDrivenParser(bool enabled) {
+    static_cast<Vt102Emulation *>(m_emulation)->setTableDrivenParser(enabled);
+}
+
+void QTermWidget::setBackgroundTab(bool background) {
+    m_terminalDisplay->setSuspended(background);
+    if (!background) {
+        m_emulation->markHistoryViewed();
+    }
+}
+
+int QTermWidget::backgroundFramesSkipped() const {
+    return m_terminalDisplay->skippedFrames();
+}
+
+qint64 QTermWidget::backgroundTimeSavedMsecs() const {
+    return m_terminalDisplay->savedFrameMsecs();
+}
+
+qint64 QTermWidget::frameCostNsecs() const {
+    return m_terminalDisplay->frameCostNsecs();
+}
+
+int QTermWidget::paintedFrames() const {
+    return m_terminalDisplay->paintedFrames();
+}
+
 void QTermWidget::setBlinkingCursor(bool blink) {
     m_terminalDisplay->setBlinkingCursor(blink);
 }
@@ -731,7 +1035,8 @@ void QTermWidget::addHighLightText(const QString &text, const QColor &color) {
     }
     HighLightText *highLightText = new HighLightText(text,color);
     m_highLightTexts.append(highLightText);
-    m_terminalDisplay->filterChain()->addFilter(highLightText->regExpFilter);
+    m_keywordFilter->addKeyword(text, color);
+    m_terminalDisplay->filterChain()->addFilter(m_keywordFilter);
     m_terminalDisplay->updateFilters();
     m_terminalDisplay->repaint();
 }
@@ -756,7 +1061,9 @@ bool QTermWidget::isContainHighLightText(const QString &text) {
 void QTermWidget::removeHighLightText(const QString &text) {
     for (int i = 0; i < m_highLightTexts.size(); i++) {
         if (m_highLightTexts.at(i)->text == text) {
-            m_terminalDisplay->filterChain()->removeFilter(m_highLightTexts.at(i)->regExpFilter);
+            m_keywordFilter->removeKeyword(text);
+            if (m_keywordFilter->isEmpty())
+                m_terminalDisplay->filterChain()->removeFilter(m_keywordFilter);
             delete m_highLightTexts.at(i);
             m_highLightTexts.removeAt(i);
             m_terminalDisplay->updateFilters();
@@ -768,9 +1075,10 @@ void QTermWidget::removeHighLightText(const QString &text) {
 
 void QTermWidget::clearHighLightTexts(void) {
     for (int i = 0; i < m_highLightTexts.size(); i++) {
-        m_terminalDisplay->filterChain()->removeFilter(m_highLightTexts.at(i)->regExpFilter);
         delete m_highLightTexts.at(i);
     }
+    m_keywordFilter->clearKeywords();
+    m_terminalDisplay->filterChain()->removeFilter(m_keywordFilter);
     m_terminalDisplay->updateFilters();
     m_highLightTexts.clear();
     m_terminalDisplay->repaint();
@@ -23,16 +23,24 @@
 #include <QLocale>
 #include <QWidget>
 #include <QClipboard>
+#include <QElapsedTimer>
+#include <QPointer>
 #include <QTimer>
+#include <atomic>
 #include "Emulation.h"
 #include "Filter.h"
 
 class QVBoxLayout;
 class SearchBar;
+class HistorySearch;
 class Session;
 class TerminalDisplay;
 class Emulation;
 class QUrl;
+class RingBuffer;
+class AsciicastRecorder;
+class AsciicastPlayer;
+class Screen;
 
 class QTermWidget : public QWidget {
     Q_OBJECT
@@ -152,6 +160,18 @@ public:
 
     /** Return the number of lines in the history buffer. */
     int historyLinesCount();
+    /** Return the number of bytes used by the history buffer. */
+    qint64 historyMemoryUsage() const;
+
+    /**
+     * Sets the memory budget shared by the histories of all terminals, in
+     * bytes; 0 means unlimited.  When it is exceeded the oldest lines of the
+     * least recently viewed terminals are dropped first.
+     */
+    static void setHistoryMemoryBudget(qint64 bytes);
+    static qint64 historyMemoryBudget();
+    //! Number of bytes used by the histories of all terminals together
+    static qint64 totalHistoryMemoryUsage();
 
     int screenColumnsCount();
     int screenLinesCount();
@@ -194,6 +214,55 @@ public:
 
     int recvData(const char *buff, int len) const;
 
+    /**
+     * Thread-safe variant of recvData() for session I/O threads.
+     *
+     * The bytes are copied into a bounded ring and fed to the emulation on
+     * the GUI thread in bounded time slices, so a tab flooded with output
+     * does not starve the rest of the UI.  When the ring is full the calling
+     * thread blocks until the GUI thread catches up, which throttles the
+     * producer instead of growing memory.
+     *
+     * Returns the number of bytes queued.  This is less than @p len only if
+     * the calling thread was asked to stop (QThread::requestInterruption())
+     * while waiting for space.  Producers must be stopped before the widget
+     * is destroyed.
+     */
+    int enqueueData(const char *buff, int len);
+
+    /** Number of received bytes waiting to be processed by the emulation. */
+    int receiveQueueDepth() const;
+
+    /** Emulation input throughput in bytes per second, averaged over about one second. */
+    qint64 receiveBytesPerSecond() const;
+
+    /**
+     * Starts recording the bytes received by the terminal, with their timing
+     * and the terminal size changes, to @p device in the asciicast v2 format.
+     * The device must stay open until stopRecording() is called.
+     */
+    void startRecording(QIODevice *device, const QString &title = QString());
+    void stopRecording();
+    bool isRecording() const;
+
+    /**
+     * Plays back the asciicast v2 recording read from @p device by feeding
+     * its output to the emulation, @p speed times faster than it was
+     * recorded or as fast as possible if @p speed is 0 or less.  The terminal
+     * takes the size of the recording and follows its resize events.
+     *
+     * Replay into a terminal which is not connected to a session.  While a
+     * replay runs, the replies of the emulation to queries in the recording
+     * and keyboard input are not emitted by sendData(), and no newLines() are
+     * emitted, but live output received meanwhile would still be mixed in.
+     *
+     * Returns false and sets @p errorString if the recording can not be read.
+     * replayFinished() is emitted when the playback is done.
+     */
+    bool startReplay(QIODevice *device, double speed, QString *errorString = nullptr);
+    void stopReplay();
+    bool isReplaying() const;
+
     /**
      * Sets the shape of the keyboard cursor.  This is the cursor drawn
      * at the position in the terminal where keyboard input will appear.
@@ -225,6 +294,23 @@ public:
     void setBoldIntense(bool boldIntense);
 
     void setConfirmMultilinePaste(bool confirmMultilinePaste);
+
+    /** Use the table driven VT500 state machine parser instead of the classic tokenizer */
+    void setTableDrivenParser(bool enabled);
+
+    /**
+     * A background tab keeps the emulation current but skips rendering and
+     * filter processing until it becomes the current tab again.
+     */
+    void setBackgroundTab(bool background);
+    //! Number of frames skipped while in a background tab
+    int backgroundFramesSkipped() const;
+    //! Estimated rendering time saved while in a background tab, in milliseconds
+    qint64 backgroundTimeSavedMsecs() const;
+    //! Running average of the time to prepare and paint one frame, in nanoseconds
+    qint64 frameCostNsecs() const;
+    //! Number of frames painted so far
+    int paintedFrames() const;
     void setTrimPastedTrailingNewlines(bool trimPastedTrailingNewlines);
     void setEcho(bool echo);
     void setKeyboardCursorColor(bool useForegroundColor, const QColor& color);
@@ -279,7 +365,20 @@ signals:
     void silence();
 
     //qiushao patch start
-    void onNewLine(const QString &line);
+    /**
+     * Emitted once per screen update with the lines which scrolled past the
+     * cursor since the previous emission, decoded as plain text.
+     *
+     * @p firstSequence is the sequence number of lines.first(); sequence
+     * numbers count every line delivered by this terminal so consumers can
+     * order batches.  @p lines is implicitly shared, all receivers see the
+     * same immutable copy.
+     *
+     * Lines are only decoded while at least one receiver is connected, so
+     * consumers should connect when they start listening and disconnect as
+     * soon as they are done.
+     */
+    void newLines(quint64 firstSequence, const QStringList &lines);
     //qiushao patch end
 
     /**
@@ -309,6 +408,11 @@ signals:
     void zmodemSendDetected();
     void zmodemRecvDetected();
     void handleCtrlC(void);
+    /**
+     * Emitted when a playback started by startReplay() has fed all of its
+     * @p bytes to the emulation, which took @p msecs milliseconds.
+     */
+    void replayFinished(qint64 bytes, qint64 msecs);
 
 public slots:
     // Copy terminal to clipboard
@@ -343,6 +447,8 @@ public slots:
 
 protected:
     void resizeEvent(QResizeEvent *) override;
+    void connectNotify(const QMetaMethod &signal) override;
+    void disconnectNotify(const QMetaMethod &signal) override;
 
 protected slots:
     void sessionFinished();
@@ -358,29 +464,46 @@ private slots:
      */
     void cursorChanged(Emulation::KeyboardCursorShape cursorShape, bool blinkingCursorEnabled);
 
+    /**
+     * Feeds queued bytes from enqueueData() to the emulation until the queue
+     * is empty or the time slice is used up, then yields to the event loop.
+     */
+    void drainReceiveQueue();
+
+    /** Turns line capturing on the screen on or off to match newLines() receivers. */
+    void updateLineCapture();
+    /** Emits the lines captured during the last update as one newLines() batch. */
+    void flushNewLines();
+
 private:
     class HighLightText {
     public:
         HighLightText(const QString& text, const QColor& color) : text(text), color(color) {
-            regExpFilter = new RegExpFilter();
-            regExpFilter->setRegExp(QRegularExpression(text));
-            regExpFilter->setColor(color);
-        }
-        ~HighLightText() {
-            delete regExpFilter;
         }
         QString text;
         QColor color;
-        RegExpFilter *regExpFilter;
     };
     void search(bool forwards, bool next);
+    void showSearchMatch(int startColumn, int startLine, int endColumn, int endLine);
+    void selectSearchMatch(int index);
+    void stepSearchMatch(int steps);
+    void clearSearchMatches();
     int setZoom(int step);
     QWidget *messageParentWidget = nullptr;
     TerminalDisplay *m_terminalDisplay = nullptr;
     Emulation  *m_emulation = nullptr;
     SearchBar* m_searchBar = nullptr;
+    // the running search, a new one cancels it
+    QPointer<HistorySearch> m_historySearch;
+    // output has arrived or the history was trimmed since the search ran,
+    // the next step searches again instead of using the old matches
+    bool m_searchMatchesStale = false;
+    // steps requested while the search still adds matches, see search()
+    int m_pendingSearchSteps = 0;
     QVBoxLayout *m_layout = nullptr;
     QList<HighLightText*> m_highLightTexts;
+    // matches all highlight texts in one pass, only in the filter chain while there are any
+    KeywordFilter *m_keywordFilter = nullptr;
     bool m_echo = false;
     UrlFilter *m_urlFilter = nullptr;
     bool m_UrlFilterEnable = true;
@@ -393,6 +516,18 @@ private:
     QTimer* m_monitorTimer = nullptr;
     int m_silenceSeconds = 10;
 
+    RingBuffer *m_receiveRing = nullptr;
+    std::atomic<bool> m_drainScheduled{false};
+    QElapsedTimer m_receiveRateTimer;
+    qint64 m_receiveRateBytes = 0;
+    qint64 m_receiveBytesPerSecond = 0;
+
+    AsciicastRecorder *m_recorder = nullptr;
+    AsciicastPlayer *m_player = nullptr;
+
+    Screen *m_lineScreen = nullptr;
+    quint64 m_lineSequence = 0;
+
     const static int STEP_ZOOM = 3;
 };
 
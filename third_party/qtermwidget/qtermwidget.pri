@@ -8,12 +8,16 @@ INCLUDEPATH += \
 SOURCES += \
     $$PWD/utf8proc/utf8proc.c \
     $$PWD/utf8proc/utf8proc_data.c \
+    $$PWD/util/Asciicast.cpp \
     $$PWD/util/CharWidth.cpp \
     $$PWD/util/ColorScheme.cpp \
     $$PWD/util/Filter.cpp \
+    $$PWD/util/GlyphCache.cpp \
     $$PWD/util/History.cpp \
+    $$PWD/util/HistoryIndex.cpp \
     $$PWD/util/HistorySearch.cpp \
     $$PWD/util/KeyboardTranslator.cpp \
+    $$PWD/util/RingBuffer.cpp \
     $$PWD/util/SearchBar.cpp \
     $$PWD/util/TerminalCharacterDecoder.cpp \
     $$PWD/Emulation.cpp \
@@ -25,14 +29,18 @@ SOURCES += \
 
 HEADERS += \
     $$PWD/utf8proc/utf8proc.h \
+    $$PWD/util/Asciicast.h \
     $$PWD/util/CharWidth.h \
     $$PWD/util/CharacterColor.h \
     $$PWD/util/Character.h \
     $$PWD/util/ColorScheme.h \
     $$PWD/util/Filter.h \
+    $$PWD/util/GlyphCache.h \
     $$PWD/util/History.h \
+    $$PWD/util/HistoryIndex.h \
     $$PWD/util/HistorySearch.h \
     $$PWD/util/KeyboardTranslator.h \
+    $$PWD/util/RingBuffer.h \
     $$PWD/util/SearchBar.h \
     $$PWD/util/TerminalCharacterDecoder.h \
     $$PWD/Emulation.h \
@@ -0,0 +1,85 @@
+/*
+    Frame time benchmark of TerminalDisplay.
+
+    Each recording in data/ is replayed at maximum speed into a visible
+    terminal, like the "maximum speed" replay of the application, and the
+    average time to prepare and paint one frame is printed.  The replay
+    sizes the terminal to the recording, 80x24 for all of them.  Run it
+    before and after a rendering change to compare:
+
+        QT_QPA_PLATFORM=offscreen ./tst_framecost
+*/
+
+#include <QBuffer>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSignalSpy>
+#include <QtTest>
+
+#include "qtermwidget.h"
+
+class tst_FrameCost : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void replay_data();
+    void replay();
+};
+
+void tst_FrameCost::replay_data()
+{
+    QTest::addColumn<QString>("path");
+
+    const QDir dir(QStringLiteral(QTERMWIDGET_TEST_DATA_DIR));
+    const QStringList recordings = dir.entryList({QStringLiteral("*.cast")}, QDir::Files, QDir::Name);
+    QVERIFY(!recordings.isEmpty());
+    for (const QString &name : recordings)
+        QTest::newRow(qPrintable(name)) << dir.filePath(name);
+}
+
+void tst_FrameCost::replay()
+{
+    QFETCH(QString, path);
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    // the recordings are short, so they are replayed several times to get
+    // enough frames for the average
+    QByteArray recording = file.readAll();
+    const int headerEnd = recording.indexOf('\n') + 1;
+    const QByteArray events = recording.mid(headerEnd);
+    for (int i = 0; i < 20; i++)
+        recording += events;
+    QBuffer buffer(&recording);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    QTermWidget terminal;
+    terminal.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&terminal));
+
+    QSignalSpy finished(&terminal, &QTermWidget::replayFinished);
+    QString errorString;
+    const int startFrames = terminal.paintedFrames();
+    QVERIFY2(terminal.startReplay(&buffer, 0, &errorString), qPrintable(errorString));
+    const QJsonObject header = QJsonDocument::fromJson(recording.left(headerEnd)).object();
+    QCOMPARE(terminal.screenColumnsCount(), header.value(QStringLiteral("width")).toInt());
+    QCOMPARE(terminal.screenLinesCount(), header.value(QStringLiteral("height")).toInt());
+    QVERIFY(finished.wait(60000));
+    // let the last frame be painted
+    QTest::qWait(100);
+
+    const int frames = terminal.paintedFrames() - startFrames;
+    QVERIFY(frames > 0);
+    qInfo("%s: %lld bytes in %lld ms, %d frames, frame cost %.3f ms",
+          qPrintable(QFileInfo(path).fileName()),
+          finished.at(0).at(0).toLongLong(), finished.at(0).at(1).toLongLong(),
+          frames, terminal.frameCostNsecs() / 1e6);
+}
+
+QTEST_MAIN(tst_FrameCost)
+
+#include "tst_framecost.moc"
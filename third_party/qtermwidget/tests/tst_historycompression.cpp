@@ -0,0 +1,115 @@
+/*
+    Benchmark of the cold page compression of HistoryScrollCompact.
+
+    A compact history is filled with serial log like lines, the compression
+    of the pages which left the hot window is waited for and the compression
+    ratio is printed, together with the latency of the first read into a
+    compressed page, which inflates it, and of a second read of the same
+    line:
+
+        ./tst_historycompression
+*/
+
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QtTest>
+
+#include <vector>
+
+#include "History.h"
+
+namespace {
+
+const int LINES = 400000;
+const int SAMPLES = 32;
+
+// The text of line @p number, with the log level in colour.
+std::vector<Character> logLine(int number)
+{
+    static const char *const levels[] = {"INFO ", "DEBUG", "WARN ", "INFO "};
+    const char *level = levels[number % 4];
+    const QString text = QStringLiteral("[2026-10-17 04:%1:%2.%3] %4 uart%5: rx %6 bytes seq=%7 crc=0x%8")
+            .arg((number / 60000) % 60, 2, 10, QLatin1Char('0'))
+            .arg((number / 1000) % 60, 2, 10, QLatin1Char('0'))
+            .arg(number % 1000, 3, 10, QLatin1Char('0'))
+            .arg(QLatin1String(level))
+            .arg(number % 3)
+            .arg(16 + (number * 7) % 240)
+            .arg(number)
+            .arg((number * 2654435761u) & 0xffff, 4, 16, QLatin1Char('0'));
+
+    std::vector<Character> cells;
+    cells.reserve(text.size());
+    const int levelStart = text.indexOf(QLatin1Char(']')) + 2;
+    for (int i = 0; i < text.size(); i++) {
+        Character c(text.at(i).unicode());
+        if (i >= levelStart && i < levelStart + 5)
+            c.foregroundColor = CharacterColor(COLOR_SPACE_SYSTEM, number % 4 == 2 ? 3 : 2);
+        cells.push_back(c);
+    }
+    return cells;
+}
+
+} // namespace
+
+class tst_HistoryCompression : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void coldPages();
+};
+
+void tst_HistoryCompression::coldPages()
+{
+    HistoryScrollCompact history(LINES + 1);
+    for (int i = 0; i < LINES; i++) {
+        const std::vector<Character> cells = logLine(i);
+        history.addCells(cells.data(), static_cast<int>(cells.size()));
+        history.addLine(false);
+    }
+    // finished compressions are collected on the next add
+    QThreadPool::globalInstance()->waitForDone();
+    const std::vector<Character> last = logLine(LINES);
+    history.addCells(last.data(), static_cast<int>(last.size()));
+    history.addLine(false);
+
+    qint64 uncompressed = 0;
+    const qint64 compressed = history.compressedBytes(&uncompressed);
+    QVERIFY(compressed > 0);
+
+    // the sampled lines are far enough apart to be in different pages, and
+    // all of them are in the cold part of the history
+    const int stride = LINES * 3 / 4 / SAMPLES;
+    qint64 firstReadNsecs = 0;
+    qint64 secondReadNsecs = 0;
+    for (int sample = 0; sample < SAMPLES; sample++) {
+        const int lineNumber = sample * stride;
+        const std::vector<Character> expected = logLine(lineNumber);
+        const int length = history.getLineLen(lineNumber);
+        QCOMPARE(length, static_cast<int>(expected.size()));
+        std::vector<Character> cells(length);
+
+        QElapsedTimer timer;
+        timer.start();
+        history.getCells(lineNumber, 0, length, cells.data());
+        firstReadNsecs += timer.nsecsElapsed();
+
+        timer.restart();
+        history.getCells(lineNumber, 0, length, cells.data());
+        secondReadNsecs += timer.nsecsElapsed();
+
+        for (int i = 0; i < length; i++)
+            QCOMPARE(cells[i].character, expected[i].character);
+    }
+
+    qInfo("%d lines, %.1f MB in cold pages compressed to %.1f MB, ratio %.2f",
+          LINES, uncompressed / (1024.0 * 1024.0), compressed / (1024.0 * 1024.0),
+          static_cast<double>(uncompressed) / compressed);
+    qInfo("first read into a cold page %.3f ms, second read %.3f ms",
+          firstReadNsecs / 1e6 / SAMPLES, secondReadNsecs / 1e6 / SAMPLES);
+}
+
+QTEST_MAIN(tst_HistoryCompression)
+
+#include "tst_historycompression.moc"
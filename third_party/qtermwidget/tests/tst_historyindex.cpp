@@ -0,0 +1,47 @@
+/*
+    Test of the literal extraction which lets HistoryIndex skip lines when
+    searching for a regular expression.
+*/
+
+#include <QRegularExpression>
+#include <QtTest>
+
+#include "HistoryIndex.h"
+
+class tst_HistoryIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void requiredLiterals_data();
+    void requiredLiterals();
+};
+
+void tst_HistoryIndex::requiredLiterals_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<QStringList>("literals");
+
+    QTest::newRow("plain") << "connected" << QStringList{"connected"};
+    QTest::newRow("class") << "[0-9]+ bytes" << QStringList{" bytes"};
+    QTest::newRow("bracket first") << "[]x]abc" << QStringList{"abc"};
+    QTest::newRow("posix class") << "[[:digit:]]foo" << QStringList{"foo"};
+    QTest::newRow("posix class in set") << "err[[:alpha:]_]+bar" << QStringList{"err", "bar"};
+    QTest::newRow("equivalence class") << "[[=e=]]xyz" << QStringList{"xyz"};
+    QTest::newRow("collating element") << "[[.-.]a]xyz" << QStringList{"xyz"};
+    QTest::newRow("posix space") << "abc[[:space:]]def" << QStringList{};
+    QTest::newRow("unterminated posix class") << "[[:digit:]foo" << QStringList{};
+    QTest::newRow("alternation") << "abc|def" << QStringList{};
+}
+
+void tst_HistoryIndex::requiredLiterals()
+{
+    QFETCH(QString, pattern);
+    QFETCH(QStringList, literals);
+
+    QCOMPARE(HistoryIndex::requiredLiterals(QRegularExpression(pattern)), literals);
+}
+
+QTEST_MAIN(tst_HistoryIndex)
+
+#include "tst_historyindex.moc"
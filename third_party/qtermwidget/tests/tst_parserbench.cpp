@@ -0,0 +1,105 @@
+/*
+    Microbenchmark of the Vt102Emulation parser and Screen.
+
+    Printable runs and CSI heavy input are fed through both parsers, once
+    with runs of printable characters handed to Screen::displayCharacters()
+    in bulk and once character by character through receiveChar() as before,
+    and the throughput of each is printed:
+
+        ./tst_parserbench
+*/
+
+#include <QElapsedTimer>
+#include <QtTest>
+
+#include "Vt102Emulation.h"
+
+namespace {
+
+const int INPUT_SIZE = 16 * 1024 * 1024;
+// the pty read thread hands over blocks of this size under load
+const int CHUNK_SIZE = 64 * 1024;
+
+// Vt102Emulation without the bulk path for printable runs.
+class PerCharacterEmulation : public Vt102Emulation
+{
+protected:
+    void receiveChars(const wchar_t *chars, int count) override
+    {
+        Emulation::receiveChars(chars, count);
+    }
+};
+
+// Repeats text until the input is INPUT_SIZE bytes long.
+QByteArray repeat(const QByteArray &unit)
+{
+    QByteArray input;
+    input.reserve(INPUT_SIZE + unit.size());
+    while (input.size() < INPUT_SIZE)
+        input += unit;
+    return input;
+}
+
+qint64 feed(Vt102Emulation &emulation, bool tableDriven, const QByteArray &input)
+{
+    emulation.setTableDrivenParser(tableDriven);
+    emulation.setHistory(HistoryTypeBuffer(1000));
+    emulation.setImageSize(24, 80);
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < input.size(); i += CHUNK_SIZE)
+        emulation.receiveData(input.constData() + i, qMin(CHUNK_SIZE, static_cast<int>(input.size()) - i));
+    return qMax<qint64>(timer.nsecsElapsed(), 1);
+}
+
+} // namespace
+
+class tst_ParserBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void parse_data();
+    void parse();
+};
+
+void tst_ParserBench::parse_data()
+{
+    QTest::addColumn<QByteArray>("input");
+    QTest::addColumn<bool>("tableDriven");
+
+    const QByteArray printable = repeat(
+            "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor\r\n"
+            "incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam, quis\r\n");
+    // coloured ls/grep output, a status line redrawn with cursor movement
+    const QByteArray csi = repeat(
+            "\x1b[0m\x1b[01;34mbuild\x1b[0m  \x1b[01;32mrun.sh\x1b[0m  \x1b[38;5;208mnotes\x1b[0m\r\n"
+            "\x1b[1;31msrc/main.cpp\x1b[m:\x1b[32m42\x1b[m:  \x1b[7mreturn\x1b[27m 0;\r\n"
+            "\x1b[s\x1b[24;1H\x1b[2K\x1b[44;37m CPU 12%  MEM 1.2G \x1b[0m\x1b[u");
+
+    QTest::newRow("printable-classic") << printable << false;
+    QTest::newRow("printable-table") << printable << true;
+    QTest::newRow("csi-classic") << csi << false;
+    QTest::newRow("csi-table") << csi << true;
+}
+
+void tst_ParserBench::parse()
+{
+    QFETCH(QByteArray, input);
+    QFETCH(bool, tableDriven);
+
+    PerCharacterEmulation perCharacter;
+    Vt102Emulation bulk;
+    const qint64 perCharacterNsecs = feed(perCharacter, tableDriven, input);
+    const qint64 bulkNsecs = feed(bulk, tableDriven, input);
+
+    const double mbytes = input.size() / (1024.0 * 1024.0);
+    qInfo("%s: per character %.1f MB/s, bulk %.1f MB/s, %.2fx",
+          QTest::currentDataTag(), mbytes * 1e9 / perCharacterNsecs, mbytes * 1e9 / bulkNsecs,
+          static_cast<double>(perCharacterNsecs) / bulkNsecs);
+}
+
+QTEST_MAIN(tst_ParserBench)
+
+#include "tst_parserbench.moc"
@@ -0,0 +1,65 @@
+/*
+    Throughput benchmark of the Unix pty read thread.
+
+    A shell runs "yes | head -c 1G" on a pty, the output is handed to a read
+    callback like the terminal does, and the throughput and the number of
+    deliveries per MB are printed.  The system calls behind it are counted
+    with strace:
+
+        strace -f -c -e trace=read,poll ./tst_ptythroughput
+
+    Run it before and after a change of the read loop to compare.
+*/
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QProcessEnvironment>
+#include <QtTest>
+
+#include <atomic>
+#include <memory>
+
+#include "ptyqt.h"
+
+class tst_PtyThroughput : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void yes();
+};
+
+void tst_PtyThroughput::yes()
+{
+    // "y\n" pairs, the pty turns every \n into \r\n
+    const qint64 size = Q_INT64_C(1) << 30;
+    const qint64 expected = size + size / 2;
+
+    std::unique_ptr<IPtyProcess> pty(PtyQt::createPtyProcess(IPtyProcess::UnixPty));
+    QVERIFY(pty);
+
+    std::atomic<qint64> received{0};
+    std::atomic<qint64> deliveries{0};
+    pty->setReadCallback([&](const char *, qint64 len) {
+        received += len;
+        ++deliveries;
+    });
+
+    QElapsedTimer timer;
+    timer.start();
+    QVERIFY2(pty->startProcess(QStringLiteral("/bin/sh"),
+                               {QStringLiteral("-c"), QStringLiteral("yes | head -c %1").arg(size)},
+                               QDir::currentPath(), QProcessEnvironment::systemEnvironment().toStringList(),
+                               80, 24),
+             qPrintable(pty->lastError()));
+    QTRY_COMPARE_WITH_TIMEOUT(received.load(), expected, 300000);
+    const qint64 msecs = qMax<qint64>(timer.elapsed(), 1);
+
+    const double mbytes = expected / (1024.0 * 1024.0);
+    qInfo("%lld bytes in %lld ms, %.1f MB/s, %lld deliveries, %.2f deliveries/MB",
+          expected, msecs, mbytes * 1000.0 / msecs, deliveries.load(), deliveries.load() / mbytes);
+}
+
+QTEST_GUILESS_MAIN(tst_PtyThroughput)
+
+#include "tst_ptythroughput.moc"
@@ -0,0 +1,145 @@
+/*
+    Throughput benchmark of the UTF-8 input decoding of Emulation.
+
+    The same input is decoded by the single pass decoder of receiveData() and
+    by the previous path, which built a QString with QStringDecoder and a
+    std::wstring from it for every chunk.  Both hand the characters to a sink
+    which only counts them, so the numbers are the cost of decoding alone:
+
+        ./tst_utf8decode
+*/
+
+#include <QElapsedTimer>
+#include <QtTest>
+
+#include "Emulation.h"
+
+namespace {
+
+const int INPUT_SIZE = 32 * 1024 * 1024;
+// the pty read thread hands over blocks of this size under load
+const int CHUNK_SIZE = 64 * 1024;
+
+// An emulation which only checksums the characters it receives.
+class SinkEmulation : public Emulation
+{
+public:
+    SinkEmulation()
+    {
+        setCodec(Utf8Codec);
+    }
+
+    // the decoding of receiveData() before the single pass decoder
+    void receiveDataQString(const char *text, int length)
+    {
+        emit stateSet(NOTIFYACTIVITY);
+
+        bufferedUpdate();
+
+        QString utf16Text = _toUtf16(QByteArray::fromRawData(text, length));
+        std::wstring unicodeText = utf16Text.toStdWString();
+
+        receiveChars(unicodeText.data(), static_cast<int>(unicodeText.size()));
+
+        for (int i = 0; i < length; i++) {
+            if (text[i] == '\030') {
+                if ((length - i - 1 > 3) && (strncmp(text + i + 1, "B00", 3) == 0))
+                    emit zmodemSendDetected();
+                if ((length - i - 1 > 5) && (strncmp(text + i + 1, "B0100", 5) == 0))
+                    emit zmodemRecvDetected();
+            }
+        }
+    }
+
+    void clearEntireScreen() override {}
+    void reset() override {}
+    void sendText(const QString &) override {}
+    void sendString(const char *, int) override {}
+
+    qint64 count = 0;
+    quint64 checksum = 0;
+
+protected:
+    void setMode(int) override {}
+    void resetMode(int) override {}
+
+    void receiveChars(const wchar_t *chars, int count) override
+    {
+        this->count += count;
+        for (int i = 0; i < count; ++i)
+            checksum = checksum * 31 + static_cast<quint64>(chars[i]);
+    }
+};
+
+// Repeats text until the input is INPUT_SIZE bytes long, cut at a character.
+QByteArray repeat(const QString &text)
+{
+    const QByteArray unit = text.toUtf8();
+    QByteArray input;
+    input.reserve(INPUT_SIZE + unit.size());
+    while (input.size() < INPUT_SIZE)
+        input += unit;
+    return input;
+}
+
+} // namespace
+
+class tst_Utf8Decode : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void decode_data();
+    void decode();
+};
+
+void tst_Utf8Decode::decode_data()
+{
+    QTest::addColumn<QByteArray>("input");
+
+    QTest::newRow("ascii") << repeat(QStringLiteral(
+            "drwxr-xr-x  2 user user  4096 Oct 17 04:32 build\r\n"
+            "-rw-r--r--  1 user user 17384 Oct 17 04:32 bench.cpp\r\n"));
+    QTest::newRow("ascii-sgr") << repeat(QStringLiteral(
+            "\x1b[01;34mbuild\x1b[0m  \x1b[01;32mbench\x1b[0m  README.md  \x1b[31merror:\x1b[0m x\r\n"));
+    QTest::newRow("cjk") << repeat(QStringLiteral(
+            "终端模拟器把收到的字节解码成字符，再交给解析器处理。\r\n"));
+    QTest::newRow("mixed") << repeat(QStringLiteral(
+            "2026-10-17 INFO  连接到 192.168.1.10:22 成功 ✓ — größe=80×24 🙂\r\n"));
+}
+
+void tst_Utf8Decode::decode()
+{
+    QFETCH(QByteArray, input);
+
+    const auto run = [&](bool singlePass, SinkEmulation &sink) {
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < input.size(); i += CHUNK_SIZE) {
+            const int length = qMin(CHUNK_SIZE, static_cast<int>(input.size()) - i);
+            if (singlePass)
+                sink.receiveData(input.constData() + i, length);
+            else
+                sink.receiveDataQString(input.constData() + i, length);
+        }
+        return qMax<qint64>(timer.nsecsElapsed(), 1);
+    };
+
+    SinkEmulation before;
+    SinkEmulation after;
+    const qint64 beforeNsecs = run(false, before);
+    const qint64 afterNsecs = run(true, after);
+
+    // chunks split characters, both paths must still see the same text
+    QCOMPARE(after.count, before.count);
+    QCOMPARE(after.checksum, before.checksum);
+
+    const double mbytes = input.size() / (1024.0 * 1024.0);
+    qInfo("%s: QString path %.1f MB/s, single pass %.1f MB/s, %.2fx",
+          QTest::currentDataTag(), mbytes * 1e9 / beforeNsecs, mbytes * 1e9 / afterNsecs,
+          static_cast<double>(beforeNsecs) / afterNsecs);
+}
+
+QTEST_MAIN(tst_Utf8Decode)
+
+#include "tst_utf8decode.moc"
@@ -0,0 +1,218 @@
+/*
+    Differential test of the table driven VT500 parser against the classic
+    tokenizer of Vt102Emulation.
+
+    The recorded streams in data/ are asciicast v2 files captured from real
+    programs (ls, vim, less, top, git log) plus a synthetic stream covering
+    SGR colours, DEC private modes, reports, charsets, line attributes, OSC
+    strings, controls inside CSI and 8-bit CSI.  Each stream is fed through
+    both parsers and the tokens, window titles and final screen contents
+    must be identical.
+*/
+
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <QtTest>
+
+#include "TerminalCharacterDecoder.h"
+#include "Vt102Emulation.h"
+
+namespace {
+
+struct Token {
+    int token;
+    int p;
+    int q;
+
+    bool operator==(const Token &other) const
+    {
+        return token == other.token && p == other.p && q == other.q;
+    }
+};
+
+QString describe(const QList<Token> &tokens, int index)
+{
+    if (index >= tokens.size())
+        return QStringLiteral("<end>");
+    const Token &t = tokens.at(index);
+    return QStringLiteral("type %1 code 0x%2 arg %3 p 0x%4 q %5")
+            .arg(t.token & 0xff)
+            .arg((t.token >> 8) & 0xff, 0, 16)
+            .arg((t.token >> 16) & 0xffff)
+            .arg(t.p, 0, 16)
+            .arg(t.q);
+}
+
+// A terminal fed with one parser, recording what it does.
+class Terminal
+{
+public:
+    explicit Terminal(bool tableDriven)
+    {
+        emulation.setTableDrivenParser(tableDriven);
+        emulation.setHistory(HistoryTypeBuffer(1000));
+        emulation.setImageSize(24, 80);
+        emulation.setTokenObserver([this](int token, wchar_t p, int q) {
+            tokens.append({token, static_cast<int>(p), q});
+        });
+        QObject::connect(&emulation, &Emulation::titleChanged, [this](int what, const QString &title) {
+            titles.append(QString::number(what) + QLatin1Char(':') + title);
+        });
+    }
+
+    void feed(const QByteArray &data, int chunkSize)
+    {
+        // chunks split escape sequences and UTF-8 characters on purpose
+        for (int i = 0; i < data.size(); i += chunkSize)
+            emulation.receiveData(data.constData() + i, qMin(chunkSize, static_cast<int>(data.size()) - i));
+    }
+
+    QString screen()
+    {
+        QString html;
+        QTextStream stream(&html);
+        HTMLDecoder decoder;
+        decoder.begin(&stream);
+        emulation.writeToStream(&decoder, 0, emulation.lineCount() - 1);
+        decoder.end();
+        return html;
+    }
+
+    Vt102Emulation emulation;
+    QList<Token> tokens;
+    QStringList titles;
+};
+
+// Output events of an asciicast v2 recording, concatenated.
+QString readRecording(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return QString();
+
+    QString output;
+    file.readLine(); // header
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().trimmed();
+        if (line.isEmpty())
+            continue;
+        const QJsonArray event = QJsonDocument::fromJson(line).array();
+        if (event.at(1).toString() == QLatin1String("o"))
+            output += event.at(2).toString();
+    }
+    return output;
+}
+
+// Removes the sequences on which the parsers differ on purpose: the
+// tokenizer prints the body of DCS, SOS, PM and APC strings, and it
+// dispatches CSI sequences with intermediates it does not know.
+QString withoutIntendedDifferences(QString output)
+{
+    static const QRegularExpression differences(QStringLiteral(
+            R"(\x{1b}[PX^_][^\x{1b}\x{9c}]*(?:\x{1b}\\|\x{9c}))"
+            R"(|\x{1b}\[[0-?]*(?:[ -/]{2,}|[\x{22}-\x{2f}])[@-~])"));
+    return output.remove(differences);
+}
+
+void compareTokens(const QList<Token> &expected, const QList<Token> &actual)
+{
+    int i = 0;
+    while (i < expected.size() && i < actual.size() && expected.at(i) == actual.at(i))
+        ++i;
+    const QString message = QStringLiteral("first difference at token %1 of %2: tokenizer %3, table %4")
+            .arg(i)
+            .arg(expected.size())
+            .arg(describe(expected, i), describe(actual, i));
+    QVERIFY2(i == expected.size() && i == actual.size(), qPrintable(message));
+}
+
+} // namespace
+
+class tst_Vt102Parser : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void recordedStreams_data();
+    void recordedStreams();
+    void stringTerminators_data();
+    void stringTerminators();
+};
+
+void tst_Vt102Parser::recordedStreams_data()
+{
+    QTest::addColumn<QString>("path");
+    QTest::addColumn<int>("chunkSize");
+
+    const QDir dir(QStringLiteral(QTERMWIDGET_TEST_DATA_DIR));
+    const QStringList recordings = dir.entryList({QStringLiteral("*.cast")}, QDir::Files, QDir::Name);
+    QVERIFY(!recordings.isEmpty());
+    for (const QString &name : recordings) {
+        for (int chunkSize : {1, 7, 4096}) {
+            QTest::addRow("%s/%d", qPrintable(name), chunkSize) << dir.filePath(name) << chunkSize;
+        }
+    }
+}
+
+void tst_Vt102Parser::recordedStreams()
+{
+    QFETCH(QString, path);
+    QFETCH(int, chunkSize);
+
+    const QString output = readRecording(path);
+    QVERIFY(!output.isEmpty());
+    const QByteArray data = withoutIntendedDifferences(output).toUtf8();
+
+    Terminal tokenizer(false);
+    Terminal table(true);
+    tokenizer.feed(data, chunkSize);
+    table.feed(data, chunkSize);
+
+    compareTokens(tokenizer.tokens, table.tokens);
+    if (QTest::currentTestFailed())
+        return;
+    QCOMPARE(table.screen(), tokenizer.screen());
+
+    // window titles are delivered after a short delay
+    QTest::qWait(50);
+    QCOMPARE(table.titles, tokenizer.titles);
+}
+
+void tst_Vt102Parser::stringTerminators_data()
+{
+    QTest::addColumn<QByteArray>("withEscBackslash");
+    QTest::addColumn<QByteArray>("withEightBitSt");
+
+    // 8-bit ST is U+009C, which arrives UTF-8 encoded
+    QTest::newRow("osc") << QByteArray("\033]2;title\033\\after") << QByteArray("\033]2;title\xc2\x9c" "after");
+    QTest::newRow("dcs") << QByteArray("\033Pq#0;2;0;0;0\033\\after") << QByteArray("\033Pq#0;2;0;0;0\xc2\x9c" "after");
+    QTest::newRow("pm") << QByteArray("\033^private\033\\after") << QByteArray("\033^private\xc2\x9c" "after");
+    QTest::newRow("apc") << QByteArray("\033_command\033\\after") << QByteArray("\033_command\xc2\x9c" "after");
+}
+
+void tst_Vt102Parser::stringTerminators()
+{
+    QFETCH(QByteArray, withEscBackslash);
+    QFETCH(QByteArray, withEightBitSt);
+
+    Terminal expected(true);
+    Terminal actual(true);
+    expected.feed(withEscBackslash, withEscBackslash.size());
+    actual.feed(withEightBitSt, withEightBitSt.size());
+
+    compareTokens(expected.tokens, actual.tokens);
+    if (QTest::currentTestFailed())
+        return;
+    QCOMPARE(actual.screen(), expected.screen());
+    QTest::qWait(50);
+    QCOMPARE(actual.titles, expected.titles);
+}
+
+QTEST_MAIN(tst_Vt102Parser)
+
+#include "tst_vt102parser.moc"
@@ -0,0 +1,197 @@
+#include "Asciicast.h"
+
+#include <QDateTime>
+#include <QIODevice>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTimer>
+
+#include <limits>
+
+// time spent handing over output per step when playing as fast as possible
+static const int PLAY_TIME_SLICE_MS = 8;
+
+AsciicastRecorder::AsciicastRecorder(QIODevice *device, int columns, int lines, const QString &title)
+    : _device(device)
+    , _decoder(QStringDecoder::Utf8)
+{
+    QJsonObject env;
+    env[QLatin1String("TERM")] = QLatin1String("xterm-256color");
+
+    QJsonObject header;
+    header[QLatin1String("version")] = 2;
+    header[QLatin1String("width")] = columns;
+    header[QLatin1String("height")] = lines;
+    header[QLatin1String("timestamp")] = QDateTime::currentSecsSinceEpoch();
+    if (!title.isEmpty())
+        header[QLatin1String("title")] = title;
+    header[QLatin1String("env")] = env;
+
+    _device->write(QJsonDocument(header).toJson(QJsonDocument::Compact));
+    _device->write("\n", 1);
+    _clock.start();
+}
+
+void AsciicastRecorder::output(const char *data, int len)
+{
+    // an incomplete UTF-8 sequence at the end stays in the decoder
+    const QString text = _decoder.decode(QByteArrayView(data, len));
+    if (!text.isEmpty())
+        writeEvent('o', text.toUtf8());
+}
+
+void AsciicastRecorder::resize(int columns, int lines)
+{
+    writeEvent('r', QByteArray::number(columns) + 'x' + QByteArray::number(lines));
+}
+
+void AsciicastRecorder::writeEvent(char type, const QByteArray &utf8)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    _event.clear();
+    _event += '[';
+    _event += QByteArray::number(_clock.nsecsElapsed() / 1e9, 'f', 6);
+    _event += ", \"";
+    _event += type;
+    _event += "\", \"";
+    for (char c : utf8) {
+        switch (c) {
+        case '"':  _event += "\\\""; break;
+        case '\\': _event += "\\\\"; break;
+        case '\n': _event += "\\n"; break;
+        case '\r': _event += "\\r"; break;
+        case '\t': _event += "\\t"; break;
+        case '\b': _event += "\\b"; break;
+        case '\f': _event += "\\f"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20 || c == 0x7f) {
+                _event += "\\u00";
+                _event += hex[(c >> 4) & 0xf];
+                _event += hex[c & 0xf];
+            } else {
+                _event += c;
+            }
+        }
+    }
+    _event += "\"]\n";
+    _device->write(_event);
+}
+
+AsciicastPlayer::AsciicastPlayer(QObject *parent)
+    : QObject(parent)
+    , _timer(new QTimer(this))
+{
+    _timer->setSingleShot(true);
+    connect(_timer, &QTimer::timeout, this, &AsciicastPlayer::step);
+}
+
+bool AsciicastPlayer::load(QIODevice *device, QString *errorString)
+{
+    stop();
+    _events.clear();
+
+    const QJsonObject header = QJsonDocument::fromJson(device->readLine()).object();
+    if (header.value(QLatin1String("version")).toInt() != 2) {
+        if (errorString)
+            *errorString = tr("Not an asciicast v2 recording");
+        return false;
+    }
+    _columns = header.value(QLatin1String("width")).toInt();
+    _lines = header.value(QLatin1String("height")).toInt();
+
+    // convert everything up front so that playing only hands over bytes
+    while (!device->atEnd()) {
+        const QByteArray line = device->readLine().trimmed();
+        if (line.isEmpty())
+            continue;
+        const QJsonArray event = QJsonDocument::fromJson(line).array();
+        if (event.size() < 3) {
+            if (errorString)
+                *errorString = tr("Invalid event: %1").arg(QString::fromUtf8(line.left(80)));
+            return false;
+        }
+        const qint64 time = static_cast<qint64>(event.at(0).toDouble() * 1e6);
+        const QString type = event.at(1).toString();
+        if (type == QLatin1String("o")) {
+            _events.append({time, event.at(2).toString().toUtf8(), 0, 0});
+        } else if (type == QLatin1String("r")) {
+            // "<columns>x<lines>"
+            const QStringList size = event.at(2).toString().split(QLatin1Char('x'));
+            const int columns = size.value(0).toInt();
+            const int lines = size.value(1).toInt();
+            if (columns > 0 && lines > 0)
+                _events.append({time, QByteArray(), columns, lines});
+        }
+        // input and marker events have nothing to play
+    }
+    return true;
+}
+
+void AsciicastPlayer::start(double speed)
+{
+    stop();
+    _speed = speed;
+    _next = 0;
+    _bytes = 0;
+    _playing = true;
+    _clock.start();
+    if (_columns > 0 && _lines > 0)
+        emit resized(_columns, _lines);
+    _timer->start(0);
+}
+
+void AsciicastPlayer::stop()
+{
+    _timer->stop();
+    _playing = false;
+}
+
+bool AsciicastPlayer::isPlaying() const
+{
+    return _playing;
+}
+
+void AsciicastPlayer::step()
+{
+    if (!_playing)
+        return;
+
+    if (_speed <= 0) {
+        QElapsedTimer slice;
+        slice.start();
+        while (_playing && _next < _events.size() && slice.elapsed() < PLAY_TIME_SLICE_MS)
+            play(_events.at(_next++));
+        if (_playing && _next < _events.size()) {
+            // a zero timer lets pending paint events run first
+            _timer->start(0);
+            return;
+        }
+    } else {
+        const qint64 now = static_cast<qint64>(_clock.nsecsElapsed() / 1000 * _speed);
+        while (_playing && _next < _events.size() && _events.at(_next).time <= now)
+            play(_events.at(_next++));
+        if (_playing && _next < _events.size()) {
+            const qint64 wait = static_cast<qint64>((_events.at(_next).time - now) / _speed / 1000);
+            _timer->start(static_cast<int>(qBound<qint64>(0, wait, std::numeric_limits<int>::max())));
+            return;
+        }
+    }
+
+    // a receiver may have stopped the playback from output()
+    if (!_playing)
+        return;
+    _playing = false;
+    emit finished(_bytes, _clock.elapsed());
+}
+
+void AsciicastPlayer::play(const Event &event)
+{
+    if (event.columns > 0) {
+        emit resized(event.columns, event.lines);
+        return;
+    }
+    _bytes += event.data.size();
+    emit output(event.data);
+}
@@ -0,0 +1,116 @@
+#ifndef ASCIICAST_H
+#define ASCIICAST_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QStringDecoder>
+
+class QIODevice;
+class QTimer;
+
+/**
+ * Records the byte stream received by a terminal in the asciicast v2 format
+ * (https://docs.asciinema.org/manual/asciicast/v2/).
+ *
+ * The recording starts with a header line holding the terminal size, then
+ * every chunk of output is written as an "o" event and every change of the
+ * terminal size as an "r" event, each stamped with the number of seconds
+ * since the recording started as measured by a monotonic clock.
+ *
+ * Output is decoded as UTF-8 across chunk boundaries, so a character which
+ * was split between two reads ends up in one event.  The recorder does not
+ * own the device and never closes it.
+ */
+class AsciicastRecorder
+{
+public:
+    /** Writes the header for a @p columns x @p lines terminal to @p device. */
+    AsciicastRecorder(QIODevice *device, int columns, int lines, const QString &title = QString());
+
+    AsciicastRecorder(const AsciicastRecorder &) = delete;
+    AsciicastRecorder &operator=(const AsciicastRecorder &) = delete;
+
+    /** Records @p len bytes of terminal output. */
+    void output(const char *data, int len);
+    /** Records that the terminal was resized to @p columns x @p lines. */
+    void resize(int columns, int lines);
+
+private:
+    void writeEvent(char type, const QByteArray &utf8);
+
+    QIODevice *_device;
+    QElapsedTimer _clock;
+    QStringDecoder _decoder;
+    QByteArray _event;
+};
+
+/**
+ * Plays back an asciicast v2 recording by emitting its output events with
+ * their original timing, sped up by a factor, or as fast as possible.  The
+ * terminal size of the header is emitted by resized() when playing starts,
+ * and every resize event of the recording again when it becomes due.
+ *
+ * Playing as fast as possible hands over the output in time slices so that
+ * the event loop can paint in between, which makes the elapsed time reported
+ * by finished() a measure of how fast the receiver parses and renders.
+ */
+class AsciicastPlayer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AsciicastPlayer(QObject *parent = nullptr);
+
+    /**
+     * Reads a whole recording from @p device.  Returns false and sets
+     * @p errorString if it is not an asciicast v2 recording.
+     */
+    bool load(QIODevice *device, QString *errorString = nullptr);
+
+    int columns() const { return _columns; }
+    int lines() const { return _lines; }
+
+    /**
+     * Starts playing the loaded recording @p speed times faster than it was
+     * recorded, or as fast as possible if @p speed is 0 or less.
+     */
+    void start(double speed);
+    void stop();
+    bool isPlaying() const;
+
+signals:
+    /** Emitted with the bytes of each output event as it becomes due. */
+    void output(const QByteArray &data);
+    /** Emitted when the recorded terminal changes to @p columns x @p lines. */
+    void resized(int columns, int lines);
+    /** Emitted after the last event with the bytes played and the time it took. */
+    void finished(qint64 bytes, qint64 msecs);
+
+private slots:
+    void step();
+
+private:
+    struct Event {
+        qint64 time;  // microseconds since the start of the recording
+        QByteArray data;
+        int columns;  // > 0 for a resize event, which has no data
+        int lines;
+    };
+
+    void play(const Event &event);
+
+    QList<Event> _events;
+    int _columns = 0;
+    int _lines = 0;
+
+    QTimer *_timer;
+    QElapsedTimer _clock;
+    double _speed = 1;
+    bool _playing = false;
+    int _next = 0;
+    qint64 _bytes = 0;
+};
+
+#endif // ASCIICAST_H
@@ -23,6 +23,7 @@
 #define CHARACTER_H
 
 #include <QHash>
+#include <QReadWriteLock>
 #include <QSet>
 
 #include "CharacterColor.h"
@@ -220,6 +221,8 @@ private:
     // in each value is the length of the buffer, followed by the ushorts in the buffer
     // themselves.
     QHash<uint,uint*> extendedCharTable;
+    // lookups may also come from the history search thread
+    mutable QReadWriteLock _lock;
 };
 
 Q_DECLARE_TYPEINFO(Character, Q_MOVABLE_TYPE);
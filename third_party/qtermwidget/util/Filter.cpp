@@ -18,6 +18,7 @@
 */
 #include "Filter.h"
 
+#include <algorithm>
 #include <iostream>
 
 #include <QAction>
@@ -101,12 +102,10 @@ QList<Filter::HotSpot *> FilterChain::hotSpots() const {
 //QList<Filter::HotSpot*> FilterChain::hotSpotsAtLine(int line) const;
 
 TerminalImageFilterChain::TerminalImageFilterChain()
-    : _buffer(nullptr), _linePositions(nullptr) {
+    : _nextId(0) {
 }
 
 TerminalImageFilterChain::~TerminalImageFilterChain() {
-    delete _buffer;
-    delete _linePositions;
 }
 
 void TerminalImageFilterChain::setImage(
@@ -115,61 +114,158 @@ void TerminalImageFilterChain::setImage(
     if (empty())
         return;
 
-    // reset all filters and hotspots
-    reset();
+    // the lines of the previous image which can be found again by their characters
+    QMultiHash<size_t, int> previousLines;
+    for (int i = 0; i < _lines.size(); i++)
+        previousLines.insert(_lines.at(i).hash, i);
+    QVector<bool> reused(_lines.size(), false);
 
     PlainTextDecoder decoder;
     // Include trailing whitespace because otherwise, if a string is wrapped at
-    // the end of a space, that space will not be taken into account in _buffer.
+    // the end of a space, that space will not be taken into account in the text.
     decoder.setTrailingWhitespace(true);
 
-    // setup new shared buffers for the filters to process on
-    QString *newBuffer = new QString();
-    QList<int> *newLinePositions = new QList<int>();
-    setBuffer(newBuffer, newLinePositions);
-
-    // free the old buffers
-    delete _buffer;
-    delete _linePositions;
-
-    _buffer = newBuffer;
-    _linePositions = newLinePositions;
-
-    QTextStream lineStream(_buffer);
-    decoder.begin(&lineStream);
-
-    for (int i = 0; i < lines; i++) {
-        _linePositions->append(_buffer->length());
-        decoder.decodeLine(image + i * columns, columns, LINE_DEFAULT);
-
-        // pretend that each line ends with a newline character.
-        // this prevents a link that occurs at the end of one line
-        // being treated as part of a link that occurs at the start of the next line
-        //
-        // the downside is that links which are spread over more than one line are
-        // not highlighted.
-        //
-        // TODO - Use the "line wrapped" attribute associated with lines in a
-        // terminal image to avoid adding this imaginary character for wrapped
-        // lines
-        if (!(lineProperties.value(i, LINE_DEFAULT) & LINE_WRAPPED))
-        lineStream << QLatin1Char('\n');
+    QList<LogicalLine> newLines;
+    for (int first = 0; first < lines;) {
+        int last = first;
+        while (last < lines - 1 && (lineProperties.value(last, LINE_DEFAULT) & LINE_WRAPPED))
+            last++;
+        const bool wrapped = lineProperties.value(last, LINE_DEFAULT) & LINE_WRAPPED;
+
+        LogicalLine line;
+        line.firstLine = first;
+        const Character *cells = image + first * columns;
+        const int cellCount = (last - first + 1) * columns;
+        line.key.resize(cellCount + 1);
+        for (int i = 0; i < cellCount; i++) {
+            line.key[i] = static_cast<uint>(cells[i].character)
+                          | ((cells[i].rendition & RE_EXTENDED_CHAR) ? 0x80000000u : 0u);
+        }
+        line.key[cellCount] = wrapped;
+        line.hash = qHash(line.key);
+
+        bool found = false;
+        for (auto it = previousLines.constFind(line.hash);
+             it != previousLines.constEnd() && it.key() == line.hash; ++it) {
+            const int index = it.value();
+            if (!reused[index] && _lines.at(index).key == line.key) {
+                const LogicalLine &previous = _lines.at(index);
+                line.id = previous.id;
+                line.text = previous.text;
+                line.linePositions = previous.linePositions;
+                reused[index] = true;
+                found = true;
+                break;
+            }
+        }
+
+        if (!found) {
+            line.id = _nextId++;
+            QTextStream lineStream(&line.text);
+            decoder.begin(&lineStream);
+            for (int i = first; i <= last; i++) {
+                line.linePositions.append(line.text.length());
+                decoder.decodeLine(image + i * columns, columns, LINE_DEFAULT);
+            }
+            // pretend that each line ends with a newline character.
+            // this prevents a link that occurs at the end of one line
+            // being treated as part of a link that occurs at the start of the next line
+            //
+            // the downside is that links which are spread over more than one line are
+            // not highlighted.
+            if (!wrapped)
+                lineStream << QLatin1Char('\n');
+            decoder.end();
+        }
+
+        newLines.append(line);
+        first = last + 1;
+    }
+    _lines = newLines;
+}
+
+void TerminalImageFilterChain::process() {
+    QListIterator<Filter *> iter(*this);
+    while (iter.hasNext()) {
+        Filter *filter = iter.next();
+        filter->beginUpdate();
+        for (const LogicalLine &line : std::as_const(_lines)) {
+            if (!filter->reuseLine(line.id, line.firstLine))
+                filter->processLine(line.id, line.text, line.linePositions, line.firstLine);
+        }
+        filter->endUpdate();
     }
-    decoder.end();
 }
 
 Filter::Filter() : QObject(nullptr) {
 }
 
 Filter::~Filter() {
-    qDeleteAll(_hotspotList);
-    _hotspotList.clear();
+    reset();
 }
 
 void Filter::reset() {
     qDeleteAll(_hotspotList);
     _hotspots.clear();
     _hotspotList.clear();
+    _lineHotSpots.clear();
+    for (const LineHotSpots &line : std::as_const(_previousLineHotSpots))
+        qDeleteAll(line.spots);
+    _previousLineHotSpots.clear();
+}
+
+void Filter::beginUpdate() {
+    _previousLineHotSpots.swap(_lineHotSpots);
+    _lineHotSpots.clear();
+    _hotspots.clear();
+    _hotspotList.clear();
+    _reuseLines = !_linesInvalid;
+    _linesInvalid = false;
+}
+
+bool Filter::reuseLine(quint64 id, int firstLine) {
+    if (!_reuseLines)
+        return false;
+    auto it = _previousLineHotSpots.find(id);
+    if (it == _previousLineHotSpots.end())
+        return false;
+
+    LineHotSpots line = it.value();
+    _previousLineHotSpots.erase(it);
+    if (line.firstLine != firstLine) {
+        for (HotSpot *spot : std::as_const(line.spots))
+            spot->moveBy(firstLine - line.firstLine);
+        line.firstLine = firstLine;
+    }
+    _hotspotList += line.spots;
+    _lineHotSpots.insert(id, line);
+    return true;
+}
+
+void Filter::processLine(quint64 id, const QString &text, const QList<int> &linePositions,
+                         int firstLine) {
+    const int firstSpot = _hotspotList.size();
+    setBuffer(&text, &linePositions);
+    process();
+    setBuffer(nullptr, nullptr);
+
+    LineHotSpots line = {firstLine, _hotspotList.mid(firstSpot)};
+    for (HotSpot *spot : std::as_const(line.spots))
+        spot->moveBy(firstLine);
+    _lineHotSpots.insert(id, line);
+}
+
+void Filter::endUpdate() {
+    for (const LineHotSpots &line : std::as_const(_previousLineHotSpots))
+        qDeleteAll(line.spots);
+    _previousLineHotSpots.clear();
+
+    // process() indexed the new hotspots by their line within the text
+    _hotspots.clear();
+    for (HotSpot *spot : std::as_const(_hotspotList)) {
+        for (int line = spot->startLine(); line <= spot->endLine(); line++)
+            _hotspots.insert(line, spot);
+    }
 }
 
 void Filter::setBuffer(const QString *buffer, const QList<int> *linePositions) {
@@ -181,21 +277,17 @@ void Filter::getLineColumn(int position, int &startLine, int &startColumn) {
     Q_ASSERT(_linePositions);
     Q_ASSERT(_buffer);
 
-    for (int i = 0; i < _linePositions->count(); i++) {
-        int nextLine = 0;
-
-        if (i == _linePositions->count() - 1)
-        nextLine = _buffer->length() + 1;
-        else
-        nextLine = _linePositions->value(i + 1);
+    // the last line which starts at or before position
+    auto next = std::upper_bound(_linePositions->cbegin(), _linePositions->cend(), position);
+    if (next == _linePositions->cbegin())
+        return;
+    const int i = static_cast<int>(next - _linePositions->cbegin()) - 1;
+    if (i == _linePositions->count() - 1 && position > _buffer->length())
+        return;
 
-        if (_linePositions->value(i) <= position && position < nextLine) {
-            startLine = i;
-            startColumn = CharWidth::string_unicode_width(buffer()->mid(
-                _linePositions->value(i), position - _linePositions->value(i)));
-            return;
-        }
-    }
+    startLine = i;
+    startColumn = CharWidth::string_unicode_width(buffer()->mid(
+        _linePositions->value(i), position - _linePositions->value(i)));
 }
 
 const QString *Filter::buffer() { 
@@ -250,6 +342,10 @@ Filter::HotSpot::Type Filter::HotSpot::type() const { return _type; }
 QColor Filter::HotSpot::color() const { return _color; }
 void Filter::HotSpot::setType(Type type) { _type = type; }
 void Filter::HotSpot::setColor(const QColor &color) { _color = color; }
+void Filter::HotSpot::moveBy(int lines) {
+    _startLine += lines;
+    _endLine += lines;
+}
 
 RegExpFilter::RegExpFilter() : Filter() {
 }
@@ -271,6 +367,7 @@ QStringList RegExpFilter::HotSpot::capturedTexts() const {
 }
 void RegExpFilter::setRegExp(const QRegularExpression &regExp) {
   _searchText = regExp;
+  invalidateLines();
 }
 QRegularExpression RegExpFilter::regExp() const { return _searchText; }
 
@@ -328,6 +425,239 @@ RegExpFilter::HotSpot *RegExpFilter::newHotSpot(int startLine, int startColumn,
     return spot;
 }
 
+KeywordFilter::KeywordFilter() : Filter() {
+}
+
+bool KeywordFilter::isLiteral(const QString &keyword) {
+    static const QString syntax = QStringLiteral("\\^$.|?*+()[]{}");
+    for (const QChar c : keyword) {
+        if (syntax.contains(c))
+            return false;
+    }
+    return true;
+}
+
+void KeywordFilter::addKeyword(const QString &keyword, const QColor &color) {
+    for (Keyword &existing : _keywords) {
+        if (existing.text == keyword) {
+            existing.color = color;
+            invalidateLines();
+            return;
+        }
+    }
+    _keywords.append({keyword, color, isLiteral(keyword)});
+    _built = false;
+    invalidateLines();
+}
+
+void KeywordFilter::removeKeyword(const QString &keyword) {
+    for (int i = 0; i < _keywords.size(); i++) {
+        if (_keywords.at(i).text == keyword) {
+            _keywords.removeAt(i);
+            _built = false;
+            invalidateLines();
+            return;
+        }
+    }
+}
+
+void KeywordFilter::clearKeywords() {
+    _keywords.clear();
+    _built = false;
+    invalidateLines();
+}
+
+int KeywordFilter::child(int node, char16_t c) const {
+    const std::vector<std::pair<char16_t, int>> &next = _nodes[node].next;
+    auto it = std::lower_bound(next.begin(), next.end(), c,
+                               [](const std::pair<char16_t, int> &edge, char16_t c) {
+                                   return edge.first < c;
+                               });
+    return (it != next.end() && it->first == c) ? it->second : -1;
+}
+
+void KeywordFilter::build() {
+    _nodes.clear();
+    _nodes.push_back({{}, 0, -1, 0});
+    _combinedKeywords.clear();
+    _separateKeywords.clear();
+
+    // back references count groups, which the combined expression renumbers
+    static const QRegularExpression backReference(
+        QLatin1String("\\\\([1-9]|g|k)|\\(\\?P="));
+    static const QString emptyString;
+
+    QStringList alternatives;
+    for (int i = 0; i < _keywords.size(); i++) {
+        const Keyword &keyword = _keywords.at(i);
+        if (keyword.text.isEmpty())
+            continue;
+
+        if (keyword.literal) {
+            int node = 0;
+            for (const QChar c : keyword.text) {
+                int next = child(node, c.unicode());
+                if (next < 0) {
+                    next = static_cast<int>(_nodes.size());
+                    _nodes.push_back({{}, 0, -1, 0});
+                    std::vector<std::pair<char16_t, int>> &edges = _nodes[node].next;
+                    edges.insert(std::upper_bound(edges.begin(), edges.end(),
+                                                  std::make_pair(c.unicode(), -1)),
+                                 std::make_pair(c.unicode(), next));
+                }
+                node = next;
+            }
+            _nodes[node].keyword = i;
+            continue;
+        }
+
+        // like RegExpFilter, ignore expressions which are invalid or match
+        // the empty string
+        const QRegularExpression regExp(keyword.text);
+        if (!regExp.isValid()
+                || regExp.match(emptyString, 0, QRegularExpression::NormalMatch,
+                                QRegularExpression::AnchorAtOffsetMatchOption).hasMatch())
+            continue;
+
+        if (backReference.match(keyword.text).hasMatch()) {
+            _separateKeywords.append(i);
+        } else {
+            alternatives.append(QStringLiteral("(?<k%1>").arg(_combinedKeywords.size())
+                                + keyword.text + QLatin1Char(')'));
+            _combinedKeywords.append(i);
+        }
+    }
+    _combined = QRegularExpression(alternatives.join(QLatin1Char('|')));
+    if (!alternatives.isEmpty() && !_combined.isValid()) {
+        _separateKeywords += _combinedKeywords;
+        _combinedKeywords.clear();
+    }
+    _combinedGroups.clear();
+    const QStringList groupNames = _combined.namedCaptureGroups();
+    for (int i = 0; i < _combinedKeywords.size(); i++)
+        _combinedGroups.append(groupNames.indexOf(QStringLiteral("k%1").arg(i)));
+
+    // breadth first, so the fail state of a node is computed before its children
+    std::vector<int> queue;
+    for (const auto &edge : _nodes[0].next)
+        queue.push_back(edge.second);
+    for (size_t head = 0; head < queue.size(); head++) {
+        const int node = queue[head];
+        for (const auto &edge : _nodes[node].next) {
+            int fail = _nodes[node].fail;
+            int next = child(fail, edge.first);
+            while (next < 0 && fail != 0) {
+                fail = _nodes[fail].fail;
+                next = child(fail, edge.first);
+            }
+            Node &target = _nodes[edge.second];
+            target.fail = next < 0 ? 0 : next;
+            target.outputLink = _nodes[target.fail].keyword >= 0
+                                    ? target.fail
+                                    : _nodes[target.fail].outputLink;
+            queue.push_back(edge.second);
+        }
+    }
+
+    _built = true;
+}
+
+void KeywordFilter::matchLiterals(const QString &text, QList<Match> *matches) const {
+    if (_nodes.size() < 2)
+        return;
+
+    // a keyword is searched for again after the end of its previous match,
+    // which is what repeated QRegularExpression::match() calls do
+    QVector<int> lastEnd(_keywords.size(), 0);
+
+    int state = 0;
+    for (int pos = 0; pos < text.size(); pos++) {
+        const char16_t c = text.at(pos).unicode();
+        int next = child(state, c);
+        while (next < 0 && state != 0) {
+            state = _nodes[state].fail;
+            next = child(state, c);
+        }
+        state = next < 0 ? 0 : next;
+
+        int node = _nodes[state].keyword >= 0 ? state : _nodes[state].outputLink;
+        while (node != 0) {
+            const int keyword = _nodes[node].keyword;
+            const int start = pos + 1 - _keywords.at(keyword).text.size();
+            if (start >= lastEnd[keyword]) {
+                matches->append({keyword, start, pos + 1});
+                lastEnd[keyword] = pos + 1;
+            }
+            node = _nodes[node].outputLink;
+        }
+    }
+}
+
+void KeywordFilter::matchRegExps(const QString &text, QList<Match> *matches) const {
+    if (!_combinedKeywords.isEmpty()) {
+        QRegularExpressionMatchIterator it = _combined.globalMatch(text);
+        while (it.hasNext()) {
+            const QRegularExpressionMatch match = it.next();
+            if (match.capturedLength() == 0)
+                continue;
+            for (int i = 0; i < _combinedKeywords.size(); i++) {
+                const int group = _combinedGroups.at(i);
+                if (match.capturedStart(group) >= 0) {
+                    matches->append({_combinedKeywords.at(i),
+                                     static_cast<int>(match.capturedStart(group)),
+                                     static_cast<int>(match.capturedEnd(group))});
+                    break;
+                }
+            }
+        }
+    }
+
+    for (int keyword : _separateKeywords) {
+        QRegularExpressionMatchIterator it =
+            QRegularExpression(_keywords.at(keyword).text).globalMatch(text);
+        while (it.hasNext()) {
+            const QRegularExpressionMatch match = it.next();
+            if (match.capturedLength() == 0)
+                continue;
+            matches->append({keyword, static_cast<int>(match.capturedStart()),
+                             static_cast<int>(match.capturedEnd())});
+        }
+    }
+}
+
+void KeywordFilter::process() {
+    const QString *text = buffer();
+
+    Q_ASSERT(text);
+
+    if (!_built)
+        build();
+
+    QList<Match> matches;
+    matchLiterals(*text, &matches);
+    matchRegExps(*text, &matches);
+
+    // keep the order separate filters had, later keywords are painted on top
+    std::stable_sort(matches.begin(), matches.end(), [](const Match &a, const Match &b) {
+        return a.keyword < b.keyword || (a.keyword == b.keyword && a.start < b.start);
+    });
+
+    for (const Match &match : std::as_const(matches)) {
+        int startLine = 0;
+        int endLine = 0;
+        int startColumn = 0;
+        int endColumn = 0;
+        getLineColumn(match.start, startLine, startColumn);
+        getLineColumn(match.end, endLine, endColumn);
+
+        RegExpFilter::HotSpot *spot =
+            new RegExpFilter::HotSpot(startLine, startColumn, endLine, endColumn);
+        spot->setCapturedTexts(QStringList(text->mid(match.start, match.end - match.start)));
+        spot->setColor(_keywords.at(match.keyword).color);
+        addHotSpot(spot);
+    }
+}
+
 RegExpFilter::HotSpot *UrlFilter::newHotSpot(int startLine, int startColumn,
                                              int endLine, int endColumn) {
     HotSpot *spot =
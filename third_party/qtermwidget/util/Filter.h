@@ -28,6 +28,8 @@
 #include <QRegularExpression>
 #include <QColor>
 
+#include <vector>
+
 #include "Character.h"
 
 /**
@@ -98,6 +100,8 @@ public:
         Type type() const;
         QColor color() const;
         void setColor(const QColor& color);
+        /** Moves the hotspot down by @p lines lines, or up if @p lines is negative */
+        void moveBy(int lines);
         /**
             * Causes the an action associated with a hotspot to be triggered.
             *
@@ -158,6 +162,32 @@ public:
      */
     void setBuffer(const QString* buffer , const QList<int>* linePositions);
 
+    /**
+     * Starts processing a block of text one line at a time.  The line is a
+     * line of the text together with the lines it wraps into.
+     *
+     * Every line is identified by an @p id which stays the same as long as
+     * its text does.  For each line either reuseLine() or processLine() is
+     * called, then endUpdate() deletes the hotspots of the lines which were
+     * not seen again.
+     */
+    void beginUpdate();
+    /**
+     * Keeps the hotspots found on line @p id by an earlier update, moved so
+     * that the line starts at @p firstLine.  Returns false if the previous
+     * update did not process the line, in which case it has to be passed to
+     * processLine().
+     */
+    bool reuseLine(quint64 id, int firstLine);
+    /**
+     * Processes the @p text of line @p id, which starts at @p firstLine.
+     * @p linePositions are the positions in @p text at which its lines start.
+     */
+    void processLine(quint64 id, const QString& text, const QList<int>& linePositions,
+                     int firstLine);
+    /** Finishes the update started by beginUpdate() */
+    void endUpdate();
+
 protected:
     /** Adds a new hotspot to the list */
     void addHotSpot(HotSpot*);
@@ -165,11 +195,28 @@ protected:
     const QString* buffer();
     /** Converts a character position within buffer() to a line and column */
     void getLineColumn(int position , int& startLine , int& startColumn);
+    /**
+     * Makes the next update process every line again, for use when what the
+     * filter looks for changes.
+     */
+    void invalidateLines() { _linesInvalid = true; }
 
 private:
+    // the hotspots found on one line, see processLine()
+    struct LineHotSpots {
+        int firstLine;
+        QList<HotSpot*> spots;
+    };
+
     QMultiHash<int,HotSpot*> _hotspots;
     QList<HotSpot*> _hotspotList;
 
+    QHash<quint64, LineHotSpots> _lineHotSpots;
+    // the lines of the previous update which were not seen again yet
+    QHash<quint64, LineHotSpots> _previousLineHotSpots;
+    bool _linesInvalid = false;
+    bool _reuseLines = false;
+
     const QList<int>* _linePositions = nullptr;
     const QString* _buffer = nullptr;
 };
@@ -319,6 +366,74 @@ signals:
     void activated(const QUrl& url, uint32_t opcode);
 };
 
+/**
+ * A filter which highlights a list of keywords, each in its own color.
+ *
+ * Keywords are regular expressions, but most of them are plain words.  Those
+ * are matched by a single Aho-Corasick automaton, so the buffer is scanned
+ * once however many of them there are.  The remaining keywords are combined
+ * into one alternation and matched in a second pass.  Each keyword finds the
+ * same matches a RegExpFilter for it would find, except that matches of two
+ * regular expression keywords cannot overlap.
+ */
+class KeywordFilter : public Filter
+{
+    Q_OBJECT
+public:
+    KeywordFilter();
+
+    /** Adds @p keyword highlighted in @p color, or changes the color of the keyword */
+    void addKeyword(const QString& keyword, const QColor& color);
+    /** Removes @p keyword */
+    void removeKeyword(const QString& keyword);
+    /** Removes all keywords */
+    void clearKeywords();
+    /** Returns true if the filter has no keywords */
+    bool isEmpty() const { return _keywords.isEmpty(); }
+
+    /** Reimplemented to search the filter's text buffer for all keywords at once */
+    void process() override;
+
+    /** Returns true if @p keyword contains no regular expression syntax */
+    static bool isLiteral(const QString& keyword);
+
+private:
+    struct Keyword {
+        QString text;
+        QColor color;
+        bool literal;
+    };
+    // a match of the keyword with the given index in _keywords
+    struct Match {
+        int keyword;
+        int start;
+        int end;
+    };
+    // a state of the automaton, the root is _nodes[0]
+    struct Node {
+        std::vector<std::pair<char16_t, int>> next;  // sorted by character
+        int fail;        // longest proper suffix which is also in the automaton
+        int keyword;     // literal keyword ending in this state, or -1
+        int outputLink;  // next state on the fail chain with a keyword, or 0
+    };
+
+    void build();
+    int child(int node, char16_t c) const;
+    void matchLiterals(const QString& text, QList<Match>* matches) const;
+    void matchRegExps(const QString& text, QList<Match>* matches) const;
+
+    QList<Keyword> _keywords;
+    bool _built = false;
+
+    std::vector<Node> _nodes;
+    // all regular expression keywords which can be combined, one named group each
+    QRegularExpression _combined;
+    QList<int> _combinedKeywords;  // keyword index of group "k<n>"
+    QList<int> _combinedGroups;    // capture group number of group "k<n>"
+    // keywords which have to be matched on their own, e.g. with back references
+    QList<int> _separateKeywords;
+};
+
 /**
  * A chain which allows a group of filters to be processed as one.
  * The chain owns the filters added to it and deletes them when the chain itself is destroyed.
@@ -355,7 +470,7 @@ public:
     /**
      * Processes each filter in the chain
      */
-    void process();
+    virtual void process();
 
     /** Sets the buffer for each filter in the chain to process. */
     void setBuffer(const QString* buffer , const QList<int>* linePositions);
@@ -386,9 +501,26 @@ public:
     void setImage(const Character* const image , int lines , int columns,
                   const QVector<LineProperty>& lineProperties);
 
+    /**
+     * Reimplemented to process only the lines which are new in the image
+     * set by setImage().  The lines which were in the previous image, even
+     * if they moved, keep their hotspots.
+     */
+    void process() override;
+
 private:
-    QString* _buffer;
-    QList<int>* _linePositions;
+    // a line of the image together with the lines it wraps into
+    struct LogicalLine {
+        quint64 id;       // stays the same while the line is in the image, see Filter::beginUpdate()
+        int firstLine;
+        QList<uint> key;  // the characters of the line, to find it again in the next image
+        size_t hash;
+        QString text;
+        QList<int> linePositions;
+    };
+
+    QList<LogicalLine> _lines;
+    quint64 _nextId;
 };
 
 #endif //FILTER_H
@@ -0,0 +1,171 @@
+#include "GlyphCache.h"
+
+#include <cstring>
+
+GlyphCache::GlyphCache(const QFont &font) {
+    setFont(font);
+}
+
+void GlyphCache::setFont(const QFont &font) {
+    _font = font;
+    clear();
+}
+
+void GlyphCache::clear() {
+    for (int i = 0; i < VARIANTS; i++) {
+        _fonts[i].reset();
+        _metrics[i].reset();
+    }
+    memset(_asciiAdvances, -1, sizeof(_asciiAdvances));
+    _advances.clear();
+
+    for (std::optional<QRawFont> &rawFont : _rawFonts)
+        rawFont.reset();
+    _glyphs.clear();
+}
+
+const QFont &GlyphCache::font(int variant) {
+    Q_ASSERT(variant >= 0 && variant < VARIANTS);
+
+    std::optional<QFont> &font = _fonts[variant];
+    if (!font) {
+        font = _font;
+#if !defined(Q_OS_WIN)
+        if (variant & Bold)
+            font->setBold(true);
+#endif
+        if (variant & Italic)
+            font->setItalic(true);
+        if (variant & Underline)
+            font->setUnderline(true);
+        if (variant & StrikeOut)
+            font->setStrikeOut(true);
+        if (variant & Overline)
+            font->setOverline(true);
+    }
+    return *font;
+}
+
+const QFontMetrics &GlyphCache::metrics(int variant) {
+    std::optional<QFontMetrics> &metrics = _metrics[variant];
+    if (!metrics)
+        metrics.emplace(font(variant));
+    return *metrics;
+}
+
+int GlyphCache::advance(char32_t ucs, int variant) {
+    Q_ASSERT(variant >= 0 && variant < VARIANTS);
+
+    if (ucs < ASCII_END) {
+        int &advance = _asciiAdvances[variant][ucs];
+        if (advance < 0)
+            advance = metrics(variant).horizontalAdvance(QLatin1Char(static_cast<char>(ucs)));
+        return advance;
+    }
+
+    const quint64 key = (quint64(variant) << 32) | ucs;
+    auto it = _advances.constFind(key);
+    if (it != _advances.constEnd())
+        return it.value();
+
+    if (_advances.size() >= MAX_ADVANCES)
+        _advances.clear();
+    const int advance = metrics(variant).horizontalAdvance(QString::fromUcs4(&ucs, 1));
+    _advances.insert(key, advance);
+    return advance;
+}
+
+bool GlyphCache::isSimple(char32_t ucs) {
+    // marks combine with the previous character and right-to-left text has
+    // to be reordered, both need the text layout
+    const QChar::Category category = QChar::category(ucs);
+    if (category == QChar::Mark_NonSpacing || category == QChar::Mark_SpacingCombining
+            || category == QChar::Mark_Enclosing || category == QChar::Other_Format
+            || category == QChar::Other_Control)
+        return false;
+
+    switch (QChar::direction(ucs)) {
+    case QChar::DirR:
+    case QChar::DirAL:
+    case QChar::DirRLE:
+    case QChar::DirRLO:
+    case QChar::DirRLI:
+        return false;
+    default:
+        break;
+    }
+
+    // scripts whose characters are shown by exactly one glyph each
+    switch (QChar::script(ucs)) {
+    case QChar::Script_Common:
+    case QChar::Script_Latin:
+    case QChar::Script_Greek:
+    case QChar::Script_Cyrillic:
+    case QChar::Script_Armenian:
+    case QChar::Script_Georgian:
+    case QChar::Script_Han:
+    case QChar::Script_Hiragana:
+    case QChar::Script_Katakana:
+    case QChar::Script_Bopomofo:
+        return true;
+    default:
+        return false;
+    }
+}
+
+const GlyphCache::Glyph &GlyphCache::glyph(char32_t ucs, int variant) {
+    variant &= GLYPH_VARIANTS;
+
+    const quint64 key = (quint64(variant) << 32) | ucs;
+    auto it = _glyphs.constFind(key);
+    if (it != _glyphs.constEnd())
+        return it.value();
+
+    std::optional<QRawFont> &rawFont = _rawFonts[variant];
+    if (!rawFont)
+        rawFont = QRawFont::fromFont(font(variant));
+
+    Glyph glyph = {0, 0, false};
+    if (isSimple(ucs) && rawFont->isValid() && rawFont->supportsCharacter(ucs)) {
+        const QString string = QString::fromUcs4(&ucs, 1);
+        quint32 index = 0;
+        int glyphCount = 1;
+        if (rawFont->glyphIndexesForChars(string.constData(), string.size(), &index, &glyphCount)
+                && glyphCount == 1 && index != 0) {
+            QPointF advance;
+            rawFont->advancesForGlyphIndexes(&index, &advance, 1);
+            glyph = {index, advance.x(), true};
+        }
+    }
+
+    if (_glyphs.size() >= MAX_ADVANCES)
+        _glyphs.clear();
+    return _glyphs.insert(key, glyph).value();
+}
+
+bool GlyphCache::glyphRun(const std::wstring &text, int variant, QGlyphRun *run) {
+    if (text.empty())
+        return false;
+
+    _runIndexes.clear();
+    _runPositions.clear();
+
+    qreal x = 0;
+    for (wchar_t c : text) {
+        const Glyph &g = glyph(static_cast<char32_t>(c), variant);
+        if (!g.simple)
+            return false;
+        _runIndexes.append(g.index);
+        _runPositions.append(QPointF(x, 0));
+        x += g.advance;
+    }
+
+    const QFont &variantFont = font(variant);
+    run->setRawFont(*_rawFonts[variant & GLYPH_VARIANTS]);
+    run->setGlyphIndexes(_runIndexes);
+    run->setPositions(_runPositions);
+    run->setUnderline(variantFont.underline());
+    run->setStrikeOut(variantFont.strikeOut());
+    run->setOverline(variantFont.overline());
+    return true;
+}
@@ -0,0 +1,99 @@
+#ifndef GLYPHCACHE_H
+#define GLYPHCACHE_H
+
+#include <QFont>
+#include <QFontMetrics>
+#include <QGlyphRun>
+#include <QHash>
+#include <QRawFont>
+
+#include <optional>
+#include <string>
+
+/**
+ * Caches the font variants and glyph advances used to render a terminal.
+ *
+ * A variant is the terminal font with some of the Variant flags applied, as
+ * selected by the rendition of a character.  Advances are cached per variant
+ * and code point, printable ASCII in a flat table and everything else in a
+ * hash, so measuring a character does not build a QFontMetrics or a QString.
+ *
+ * The cache also keeps the glyph of every code point which can be drawn
+ * without shaping, so that glyphRun() can lay out a run of such characters
+ * by simply placing their glyphs one after the other.
+ *
+ * Everything depends on the font and the resolution it is rendered at, so
+ * the owner has to call setFont() when the font changes and clear() when
+ * the device pixel ratio or the screen changes.
+ */
+class GlyphCache
+{
+public:
+    enum Variant {
+        Bold = 0x01,
+        Italic = 0x02,
+        Underline = 0x04,
+        StrikeOut = 0x08,
+        Overline = 0x10
+    };
+    static const int VARIANTS = 32;
+
+    explicit GlyphCache(const QFont &font);
+
+    GlyphCache(const GlyphCache &) = delete;
+    GlyphCache &operator=(const GlyphCache &) = delete;
+
+    /** Sets the base font and forgets everything derived from the previous one. */
+    void setFont(const QFont &font);
+    /** Forgets all prepared fonts and advances. */
+    void clear();
+
+    /**
+     * Returns the base font with the Variant flags @p variant applied on top
+     * of its own style.  Variant 0 is the base font itself.
+     */
+    const QFont &font(int variant);
+
+    /** Returns the horizontal advance of @p ucs in the font variant @p variant. */
+    int advance(char32_t ucs, int variant = 0);
+
+    /**
+     * Lays out @p text in the font variant @p variant without shaping it and
+     * stores the result in @p run, with the baseline of the first glyph at
+     * (0, 0).  Returns false if some character of @p text needs shaping or is
+     * not in the font itself, in which case the text has to be drawn with
+     * QPainter::drawText() to get font fallback and shaping right.
+     */
+    bool glyphRun(const std::wstring &text, int variant, QGlyphRun *run);
+
+private:
+    static const int ASCII_END = 0x80;
+    // the hash is dropped rather than grown beyond this many entries
+    static const int MAX_ADVANCES = 65536;
+
+    // only these flags change the glyphs, the others are decorations
+    static const int GLYPH_VARIANTS = Bold | Italic;
+
+    struct Glyph {
+        quint32 index;
+        qreal advance;
+        bool simple;  // drawn by placing the glyph, see glyphRun()
+    };
+
+    const QFontMetrics &metrics(int variant);
+    const Glyph &glyph(char32_t ucs, int variant);
+    static bool isSimple(char32_t ucs);
+
+    QFont _font;
+    std::optional<QFont> _fonts[VARIANTS];
+    std::optional<QFontMetrics> _metrics[VARIANTS];
+    int _asciiAdvances[VARIANTS][ASCII_END];  // -1 if not measured yet
+    QHash<quint64, int> _advances;            // (variant << 32 | code point) -> advance
+
+    std::optional<QRawFont> _rawFonts[GLYPH_VARIANTS + 1];
+    QHash<quint64, Glyph> _glyphs;            // (variant << 32 | code point) -> glyph
+    QList<quint32> _runIndexes;
+    QList<QPointF> _runPositions;
+};
+
+#endif // GLYPHCACHE_H
@@ -25,7 +25,11 @@
 #include <cstdlib>
 #include <iostream>
 #include <cerrno>
+#include <cstring>
 
+#include <QDir>
+#include <QThreadPool>
+#include <QTimer>
 #include <QtDebug>
 
 // Reasonable line size
@@ -69,19 +73,85 @@
 */
 
 HistoryScroll::HistoryScroll(HistoryType *t) : m_histType(t) {
+    HistoryMemoryBudget::instance()->add(this);
 }
 
 HistoryScroll::~HistoryScroll() { 
+    HistoryMemoryBudget::instance()->remove(this);
     delete m_histType; 
 }
 
+void HistoryScroll::markViewed() {
+    HistoryMemoryBudget::instance()->touch(this);
+}
+
+void HistoryScroll::reportUsage() {
+    HistoryMemoryBudget::instance()->update(this, memoryUsage());
+}
+
+// Histories whose usage changes with every line report it to the budget in
+// steps of this size.
+static const qint64 USAGE_REPORT_STEP = 64 * 1024;
+
 bool HistoryScroll::hasScroll() { 
     return true; 
 }
 
+// A snapshot which holds its own (implicitly shared) copy of every line.
+class HistorySnapshotLines : public HistorySnapshot
+{
+public:
+    int getLines() override {
+        return _lines.size();
+    }
+
+    int getLineLen(int lineNumber) override {
+        if (lineNumber < 0 || lineNumber >= _lines.size())
+            return 0;
+        return _lines.at(lineNumber).size();
+    }
+
+    bool isWrappedLine(int lineNumber) override {
+        if (lineNumber < 0 || lineNumber >= _lines.size())
+            return false;
+        return _wrapped.testBit(lineNumber);
+    }
+
+    void getCells(int lineNumber, int startColumn, int count, Character buffer[]) override {
+        if (count == 0)
+            return;
+
+        if (lineNumber < 0 || lineNumber >= _lines.size()) {
+            memset(static_cast<void *>(buffer), 0, count * sizeof(Character));
+            return;
+        }
+
+        const TextLine &line = _lines.at(lineNumber);
+        Q_ASSERT(startColumn <= line.size() - count);
+        memcpy(buffer, line.constData() + startColumn, count * sizeof(Character));
+    }
+
+    QVector<TextLine> _lines;
+    QBitArray _wrapped;
+};
+
+HistorySnapshot *HistoryScroll::snapshot() {
+    auto *snapshot = new HistorySnapshotLines();
+    const int lines = getLines();
+    snapshot->_lines.resize(lines);
+    snapshot->_wrapped.resize(lines);
+    for (int i = 0; i < lines; i++) {
+        TextLine &line = snapshot->_lines[i];
+        line.resize(getLineLen(i));
+        getCells(i, 0, line.size(), line.data());
+        snapshot->_wrapped.setBit(i, isWrappedLine(i));
+    }
+    return snapshot;
+}
+
 HistoryScrollBuffer::HistoryScrollBuffer(unsigned int maxLineCount)
     : HistoryScroll(new HistoryTypeBuffer(maxLineCount)), _historyBuffer(),
-      _maxLineCount(0), _usedLines(0), _head(0) {
+      _maxLineCount(0), _usedLines(0), _head(0), _cellCount(0), _reportedUsage(0) {
     setMaxNbLines(maxLineCount);
 }
 
@@ -98,8 +168,15 @@ void HistoryScrollBuffer::addCellsVector(const QVector<Character> &cells) {
         _head = 0;
     }
 
-    _historyBuffer[bufferIndex(_usedLines - 1)] = cells;
+    HistoryLine &line = _historyBuffer[bufferIndex(_usedLines - 1)];
+    _cellCount += cells.size() - line.size();
+    line = cells;
     _wrappedLine[bufferIndex(_usedLines - 1)] = false;
+
+    if (qAbs(memoryUsage() - _reportedUsage) >= USAGE_REPORT_STEP) {
+        _reportedUsage = memoryUsage();
+        reportUsage();
+    }
 }
 
 void HistoryScrollBuffer::addCells(const Character a[], int count) {
@@ -172,6 +249,28 @@ void HistoryScrollBuffer::setMaxNbLines(unsigned int lineCount) {
 
     _wrappedLine.resize(lineCount);
     dynamic_cast<HistoryTypeBuffer *>(m_histType)->m_nbLines = lineCount;
+
+    _cellCount = 0;
+    for (int i = 0; i < _usedLines; i++)
+        _cellCount += _historyBuffer[i].size();
+    _reportedUsage = memoryUsage();
+    reportUsage();
+}
+
+qint64 HistoryScrollBuffer::memoryUsage() const {
+    return static_cast<qint64>(_maxLineCount) * sizeof(HistoryLine) + _cellCount * sizeof(Character);
+}
+
+HistorySnapshot *HistoryScrollBuffer::snapshot() {
+    // the lines are implicitly shared with the snapshot
+    auto *snapshot = new HistorySnapshotLines();
+    snapshot->_lines.resize(_usedLines);
+    snapshot->_wrapped.resize(_usedLines);
+    for (int i = 0; i < _usedLines; i++) {
+        snapshot->_lines[i] = _historyBuffer[bufferIndex(i)];
+        snapshot->_wrapped.setBit(i, _wrappedLine.testBit(bufferIndex(i)));
+    }
+    return snapshot;
 }
 
 int HistoryScrollBuffer::bufferIndex(int lineNumber) const {
@@ -186,6 +285,805 @@ int HistoryScrollBuffer::bufferIndex(int lineNumber) const {
     }
 }
 
+// Compact history
+//
+// Lines are packed back to back into pages of this size; a line which does
+// not fit any more starts a new page.  Lines longer than a page get a page
+// of their own.
+static const int COMPACT_PAGE_SIZE = 256 * 1024;
+// The newest pages are never compressed so that scrolling near the bottom and
+// appending stay cheap.
+static const int COMPACT_HOT_PAGES = 2;
+// Number of compressed pages which are kept inflated after a read.
+static const int COMPACT_INFLATED_PAGES = 4;
+
+static inline void putVarint(std::vector<char> &out, quint32 value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+static inline quint32 getVarint(const uchar *&p) {
+    quint32 value = 0;
+    int shift = 0;
+    while (*p & 0x80) {
+        value |= quint32(*p++ & 0x7f) << shift;
+        shift += 7;
+    }
+    value |= quint32(*p++) << shift;
+    return value;
+}
+
+// Cell values are not always valid code points (e.g. RE_EXTENDED_CHAR hash
+// codes), so this is the original UTF-8 scheme which covers 31 bits.
+static inline void putUtf8(std::vector<char> &out, quint32 c) {
+    if (c < 0x80) {
+        out.push_back(static_cast<char>(c));
+        return;
+    }
+    int extra;
+    uchar lead;
+    if (c < 0x800) {
+        extra = 1; lead = 0xc0;
+    } else if (c < 0x10000) {
+        extra = 2; lead = 0xe0;
+    } else if (c < 0x200000) {
+        extra = 3; lead = 0xf0;
+    } else if (c < 0x4000000) {
+        extra = 4; lead = 0xf8;
+    } else {
+        extra = 5; lead = 0xfc;
+        c &= 0x7fffffff;
+    }
+    out.push_back(static_cast<char>(lead | (c >> (6 * extra))));
+    while (extra-- > 0)
+        out.push_back(static_cast<char>(0x80 | ((c >> (6 * extra)) & 0x3f)));
+}
+
+static inline quint32 getUtf8(const uchar *&p) {
+    const uchar lead = *p++;
+    if (lead < 0x80)
+        return lead;
+    int extra;
+    quint32 c;
+    if (lead < 0xe0) {
+        extra = 1; c = lead & 0x1f;
+    } else if (lead < 0xf0) {
+        extra = 2; c = lead & 0x0f;
+    } else if (lead < 0xf8) {
+        extra = 3; c = lead & 0x07;
+    } else if (lead < 0xfc) {
+        extra = 4; c = lead & 0x03;
+    } else {
+        extra = 5; c = lead & 0x01;
+    }
+    while (extra-- > 0)
+        c = (c << 6) | (*p++ & 0x3f);
+    return c;
+}
+
+size_t qHash(const HistoryLineCodec::Format &format, size_t seed) {
+    quint32 fg;
+    quint32 bg;
+    memcpy(&fg, &format.fgColor, sizeof(fg));
+    memcpy(&bg, &format.bgColor, sizeof(bg));
+    return qHashMulti(seed, fg, bg, format.rendition);
+}
+
+quint32 HistoryLineCodec::formatReference(const Character &c) {
+    const Format format = {c.foregroundColor, c.backgroundColor, c.rendition};
+    auto it = _formatIndex.constFind(format);
+    if (it != _formatIndex.constEnd())
+        return it.value() + 1;
+    if (_formats.size() >= MAX_FORMATS)
+        return 0;
+
+    const quint32 index = _formats.size();
+    _formats.append(format);
+    _formatIndex.insert(format, index);
+    return index + 1;
+}
+
+void HistoryLineCodec::encode(const Character a[], int count, std::vector<char> &out) {
+    // trailing cells which look like erased cells are implied by the cell count
+    static const Character defaultCell;
+    int stored = count;
+    while (stored > 0 && a[stored - 1] == defaultCell)
+        stored--;
+
+    out.clear();
+    putVarint(out, stored);
+    for (int i = 0; i < stored; i++)
+        putUtf8(out, static_cast<quint32>(a[i].character));
+    for (int i = 0; i < stored;) {
+        int run = 1;
+        while (i + run < stored && a[i + run].equalsFormat(a[i]))
+            run++;
+        putVarint(out, run);
+        const quint32 reference = formatReference(a[i]);
+        putVarint(out, reference);
+        if (reference == 0) {
+            // inline format: both colors as they are laid out, then the rendition
+            const char *fg = reinterpret_cast<const char *>(&a[i].foregroundColor);
+            const char *bg = reinterpret_cast<const char *>(&a[i].backgroundColor);
+            out.insert(out.end(), fg, fg + sizeof(CharacterColor));
+            out.insert(out.end(), bg, bg + sizeof(CharacterColor));
+            out.push_back(static_cast<char>(a[i].rendition));
+        }
+        i += run;
+    }
+}
+
+void HistoryLineCodec::decode(const char *data, int startColumn, int count, Character buffer[]) const {
+    const uchar *p = reinterpret_cast<const uchar *>(data);
+    const int stored = static_cast<int>(getVarint(p));
+    const int end = startColumn + count;
+    const int decoded = qMin(stored, end);
+
+    // the text comes first, the spans follow it
+    for (int i = 0; i < decoded; i++) {
+        const quint32 c = getUtf8(p);
+        if (i >= startColumn)
+            buffer[i - startColumn].character = static_cast<wchar_t>(c);
+    }
+    for (int i = decoded; i < stored; i++)
+        getUtf8(p);
+
+    for (int i = 0; i < decoded;) {
+        const int run = static_cast<int>(getVarint(p));
+        const quint32 reference = getVarint(p);
+        Format format;
+        if (reference > 0) {
+            format = _formats.at(reference - 1);
+        } else {
+            memcpy(&format.fgColor, p, sizeof(CharacterColor));
+            p += sizeof(CharacterColor);
+            memcpy(&format.bgColor, p, sizeof(CharacterColor));
+            p += sizeof(CharacterColor);
+            format.rendition = *p++;
+        }
+        for (int j = qMax(i, startColumn); j < qMin(i + run, decoded); j++) {
+            Character &c = buffer[j - startColumn];
+            c.foregroundColor = format.fgColor;
+            c.backgroundColor = format.bgColor;
+            c.rendition = format.rendition;
+        }
+        i += run;
+    }
+
+    for (int i = qMax(stored, startColumn); i < end; i++)
+        buffer[i - startColumn] = Character();
+}
+
+qint64 HistoryLineCodec::memoryUsage() const {
+    return static_cast<qint64>(_formats.capacity()) * (sizeof(Format) * 2 + sizeof(quint32));
+}
+
+HistoryScrollCompact::HistoryScrollCompact(unsigned int maxLineCount)
+    : HistoryScroll(new HistoryTypeCompact(maxLineCount)),
+      _firstPage(0), _maxLineCount(0), _runningJobs(0) {
+    setMaxNbLines(maxLineCount);
+}
+
+HistoryScrollCompact::~HistoryScrollCompact() {
+}
+
+int HistoryScrollCompact::getLines() {
+    return static_cast<int>(_lines.size());
+}
+
+int HistoryScrollCompact::getLineLen(int lineNumber) {
+    if (lineNumber < 0 || lineNumber >= getLines())
+        return 0;
+    return _lines[lineNumber].cellCount;
+}
+
+bool HistoryScrollCompact::isWrappedLine(int lineNumber) {
+    if (lineNumber < 0 || lineNumber >= getLines())
+        return false;
+    return _lines[lineNumber].wrapped;
+}
+
+char *HistoryScrollCompact::allocate(int size, quint32 *page, quint32 *offset) {
+    if (_pages.empty() || _pages.back().capacity - _pages.back().used < size) {
+        Page newPage;
+        newPage.capacity = qMax(size, COMPACT_PAGE_SIZE);
+        newPage.data.reset(new char[newPage.capacity]);
+        newPage.used = 0;
+        newPage.lineCount = 0;
+        _pages.push_back(std::move(newPage));
+
+        // the page which just left the hot window is full and will not change
+        if (static_cast<int>(_pages.size()) > COMPACT_HOT_PAGES)
+            compressPage(_pages[_pages.size() - 1 - COMPACT_HOT_PAGES]);
+        reportUsage();
+    }
+
+    Page &last = _pages.back();
+    *page = _firstPage + static_cast<quint32>(_pages.size() - 1);
+    *offset = last.used;
+    last.used += size;
+    last.lineCount++;
+    return last.data.get() + *offset;
+}
+
+void HistoryScrollCompact::dropOldestLine() {
+    const Line &oldest = _lines.front();
+    --_pages[oldest.page - _firstPage].lineCount;
+    _lines.pop_front();
+
+    bool released = false;
+    // pages are filled and emptied in order, so only the front can become free
+    while (_pages.size() > 1 && _pages.front().lineCount == 0) {
+        if (_pages.front().job)
+            _runningJobs--;
+        for (int i = 0; i < _inflatedPages.size(); i++) {
+            if (_inflatedPages.at(i).page == _firstPage) {
+                _inflatedPages.remove(i);
+                break;
+            }
+        }
+        _pages.pop_front();
+        _firstPage++;
+        released = true;
+    }
+    if (released)
+        reportUsage();
+}
+
+void HistoryScrollCompact::compressPage(Page &page) {
+    if (!page.data || page.job)
+        return;
+
+    // the job keeps its own reference to the page data, so the page may be
+    // dropped from the history while the job is still running
+    auto job = std::make_shared<CompressJob>();
+    job->data = page.data;
+    job->size = page.used;
+    page.job = job;
+    _runningJobs++;
+
+    QThreadPool::globalInstance()->start([job]() {
+        job->result = qCompress(reinterpret_cast<const uchar *>(job->data.get()), job->size, 1);
+        job->data.reset();
+        job->done.store(true, std::memory_order_release);
+    });
+}
+
+bool HistoryScrollCompact::collectCompressedPages() {
+    if (_runningJobs == 0)
+        return false;
+
+    bool collected = false;
+    for (Page &page : _pages) {
+        if (page.job && page.job->done.load(std::memory_order_acquire)) {
+            page.compressed = std::move(page.job->result);
+            page.data.reset();
+            page.job.reset();
+            _runningJobs--;
+            collected = true;
+        }
+    }
+    return collected;
+}
+
+const char *HistoryScrollCompact::pageData(quint32 pageNumber) {
+    Page &page = _pages[pageNumber - _firstPage];
+    if (page.data)
+        return page.data.get();
+
+    for (int i = 0; i < _inflatedPages.size(); i++) {
+        if (_inflatedPages.at(i).page == pageNumber) {
+            if (i > 0)
+                _inflatedPages.move(i, 0);
+            return _inflatedPages.first().data.constData();
+        }
+    }
+
+    if (_inflatedPages.size() >= COMPACT_INFLATED_PAGES)
+        _inflatedPages.removeLast();
+    _inflatedPages.prepend({pageNumber, qUncompress(page.compressed)});
+    return _inflatedPages.first().data.constData();
+}
+
+int HistoryScrollCompact::trimOldestPage(int minimumLines) {
+    const int lines = getLines();
+    const quint32 oldestPage = _firstPage;
+    while (getLines() > minimumLines && _firstPage == oldestPage)
+        dropOldestLine();
+    return lines - getLines();
+}
+
+void HistoryScrollCompact::addCells(const Character a[], int count) {
+    if (_maxLineCount <= 0)
+        return;
+
+    // usage is only reported while lines are added or dropped, never from a
+    // read, so that trimming cannot happen under a running getCells()
+    if (collectCompressedPages())
+        reportUsage();
+    _codec.encode(a, count, _encodeBuffer);
+
+    if (getLines() >= _maxLineCount)
+        dropOldestLine();
+
+    Line line;
+    char *dest = allocate(static_cast<int>(_encodeBuffer.size()), &line.page, &line.offset);
+    memcpy(dest, _encodeBuffer.data(), _encodeBuffer.size());
+    line.cellCount = count;
+    line.wrapped = false;
+    _lines.push_back(line);
+}
+
+void HistoryScrollCompact::addLine(bool previousWrapped) {
+    if (!_lines.empty())
+        _lines.back().wrapped = previousWrapped;
+}
+
+void HistoryScrollCompact::getCells(int lineNumber, int startColumn, int count,
+                                    Character buffer[]) {
+    if (count == 0)
+        return;
+
+    if (lineNumber < 0 || lineNumber >= getLines()) {
+        memset(static_cast<void *>(buffer), 0, count * sizeof(Character));
+        return;
+    }
+
+    const Line &line = _lines[lineNumber];
+    Q_ASSERT(startColumn + count <= static_cast<int>(line.cellCount));
+
+    collectCompressedPages();
+    _codec.decode(pageData(line.page) + line.offset, startColumn, count, buffer);
+}
+
+void HistoryScrollCompact::setMaxNbLines(unsigned int lineCount) {
+    _maxLineCount = static_cast<int>(lineCount);
+    while (getLines() > _maxLineCount)
+        dropOldestLine();
+    if (_lines.empty()) {
+        _pages.clear();
+        _firstPage = 0;
+        _runningJobs = 0;
+        _inflatedPages.clear();
+        reportUsage();
+    }
+
+    dynamic_cast<HistoryTypeCompact *>(m_histType)->m_nbLines = lineCount;
+}
+
+// A snapshot of a compact history.  Full pages never change and the hot page
+// is only appended to, so the snapshot can share all page buffers with the
+// history and only copies the line index.  Compressed pages are inflated one
+// at a time.
+class HistorySnapshotCompact : public HistorySnapshot
+{
+public:
+    explicit HistorySnapshotCompact(const HistoryScrollCompact &scroll)
+        : _firstPage(scroll._firstPage),
+          _lines(scroll._lines.begin(), scroll._lines.end()),
+          _codec(scroll._codec),
+          _inflatedPage(0),
+          _hasInflatedPage(false) {
+        _pages.reserve(scroll._pages.size());
+        for (const HistoryScrollCompact::Page &page : scroll._pages)
+            _pages.push_back({page.data, page.compressed});
+    }
+
+    int getLines() override {
+        return static_cast<int>(_lines.size());
+    }
+
+    int getLineLen(int lineNumber) override {
+        if (lineNumber < 0 || lineNumber >= getLines())
+            return 0;
+        return _lines[lineNumber].cellCount;
+    }
+
+    bool isWrappedLine(int lineNumber) override {
+        if (lineNumber < 0 || lineNumber >= getLines())
+            return false;
+        return _lines[lineNumber].wrapped;
+    }
+
+    void getCells(int lineNumber, int startColumn, int count, Character buffer[]) override {
+        if (count == 0)
+            return;
+
+        if (lineNumber < 0 || lineNumber >= getLines()) {
+            memset(static_cast<void *>(buffer), 0, count * sizeof(Character));
+            return;
+        }
+
+        const HistoryScrollCompact::Line &line = _lines[lineNumber];
+        Q_ASSERT(startColumn + count <= static_cast<int>(line.cellCount));
+        _codec.decode(pageData(line.page) + line.offset, startColumn, count, buffer);
+    }
+
+private:
+    struct PageRef {
+        std::shared_ptr<char[]> data;
+        QByteArray compressed;
+    };
+
+    const char *pageData(quint32 pageNumber) {
+        const PageRef &page = _pages[pageNumber - _firstPage];
+        if (page.data)
+            return page.data.get();
+
+        if (!_hasInflatedPage || _inflatedPage != pageNumber) {
+            _inflated = qUncompress(page.compressed);
+            _inflatedPage = pageNumber;
+            _hasInflatedPage = true;
+        }
+        return _inflated.constData();
+    }
+
+    quint32 _firstPage;
+    std::vector<HistoryScrollCompact::Line> _lines;
+    std::vector<PageRef> _pages;
+    HistoryLineCodec _codec;
+
+    quint32 _inflatedPage;
+    bool _hasInflatedPage;
+    QByteArray _inflated;
+};
+
+HistorySnapshot *HistoryScrollCompact::snapshot() {
+    return new HistorySnapshotCompact(*this);
+}
+
+qint64 HistoryScrollCompact::memoryUsage() const {
+    qint64 bytes = 0;
+    for (const Page &page : _pages)
+        bytes += page.data ? page.capacity : page.compressed.size();
+    for (const InflatedPage &page : _inflatedPages)
+        bytes += page.data.size();
+    bytes += static_cast<qint64>(_lines.size()) * sizeof(Line);
+    bytes += _codec.memoryUsage();
+    return bytes;
+}
+
+qint64 HistoryScrollCompact::compressedBytes(qint64 *uncompressedBytes) const {
+    qint64 bytes = 0;
+    *uncompressedBytes = 0;
+    for (const Page &page : _pages) {
+        if (!page.data) {
+            bytes += page.compressed.size();
+            *uncompressedBytes += page.used;
+        }
+    }
+    return bytes;
+}
+
+HistoryMemoryBudget *HistoryMemoryBudget::instance() {
+    static HistoryMemoryBudget budget;
+    return &budget;
+}
+
+void HistoryMemoryBudget::setBudget(qint64 bytes) {
+    _budget = qMax<qint64>(bytes, 0);
+    enforce();
+}
+
+void HistoryMemoryBudget::add(HistoryScroll *scroll) {
+    // called from the HistoryScroll constructor, the usage follows later
+    const quint64 viewed = ++_clock;
+    _scrolls.insert(scroll, {0, viewed});
+    _leastRecentlyViewed.emplace(viewed, scroll);
+}
+
+void HistoryMemoryBudget::remove(HistoryScroll *scroll) {
+    auto it = _scrolls.find(scroll);
+    if (it == _scrolls.end())
+        return;
+    _usage -= it->usage;
+    _leastRecentlyViewed.erase(it->lastViewed);
+    _scrolls.erase(it);
+}
+
+void HistoryMemoryBudget::touch(HistoryScroll *scroll) {
+    auto it = _scrolls.find(scroll);
+    if (it == _scrolls.end())
+        return;
+    _leastRecentlyViewed.erase(it->lastViewed);
+    it->lastViewed = ++_clock;
+    _leastRecentlyViewed.emplace(it->lastViewed, scroll);
+}
+
+void HistoryMemoryBudget::update(HistoryScroll *scroll, qint64 usage) {
+    auto it = _scrolls.find(scroll);
+    if (it == _scrolls.end())
+        return;
+    _usage += usage - it->usage;
+    it->usage = usage;
+    if (_budget > 0 && _usage > _budget)
+        scheduleEnforce();
+}
+
+void HistoryMemoryBudget::scheduleEnforce() {
+    // usage is reported while lines are added, i.e. in the middle of a Screen
+    // operation, so trimming is left to the event loop
+    if (_enforcePending)
+        return;
+    _enforcePending = true;
+    QTimer::singleShot(0, [this]() {
+        _enforcePending = false;
+        enforce();
+    });
+}
+
+void HistoryMemoryBudget::enforce() {
+    // trimming reports back through update(), don't recurse
+    if (_enforcing || _budget <= 0)
+        return;
+
+    _enforcing = true;
+    // trimming does not change the order, so one pass from the least recently
+    // viewed history on is enough
+    auto it = _leastRecentlyViewed.cbegin();
+    while (_usage > _budget && it != _leastRecentlyViewed.cend()) {
+        HistoryScroll *scroll = it->second;
+        const int dropped = scroll->trimOldestPage(_minimumLines);
+        if (dropped == 0) {
+            ++it;
+            continue;
+        }
+        if (scroll->m_trimmedHandler)
+            scroll->m_trimmedHandler(dropped);
+    }
+    _enforcing = false;
+}
+
+// File backed history
+//
+// Appended data is written to the file once this much has been collected.
+static const int HISTORY_FILE_BLOCK_SIZE = 1024 * 1024;
+
+HistoryFile::HistoryFile()
+    : _valid(false), _writtenSize(0), _map(nullptr), _mapSize(0) {
+    _file.setFileTemplate(QDir::tempPath() + QLatin1String("/qtermwidget-history-XXXXXX"));
+    _valid = _file.open();
+    if (!_valid)
+        qWarning() << "Unable to create history file:" << _file.errorString();
+    _pending.reserve(HISTORY_FILE_BLOCK_SIZE);
+}
+
+HistoryFile::~HistoryFile() {
+    if (_map)
+        _file.unmap(_map);
+}
+
+qint64 HistoryFile::add(const char *data, int len) {
+    if (_pending.size() + len > HISTORY_FILE_BLOCK_SIZE)
+        flush();
+
+    const qint64 offset = size();
+    _pending.append(data, len);
+    return offset;
+}
+
+void HistoryFile::flush() {
+    // without a usable file everything simply stays in memory
+    if (!_valid || _pending.isEmpty())
+        return;
+
+    if (!_file.seek(_writtenSize) || _file.write(_pending) != _pending.size() || !_file.flush()) {
+        qWarning() << "Unable to write history file, keeping history in memory:" << _file.errorString();
+        _valid = false;
+        return;
+    }
+    _writtenSize += _pending.size();
+    _pending.resize(0);
+}
+
+const char *HistoryFile::get(qint64 offset, int len) {
+    // add() never splits a block between the file and the pending tail
+    if (offset >= _writtenSize)
+        return _pending.constData() + (offset - _writtenSize);
+
+    if (offset + len > _mapSize) {
+        if (_map)
+            _file.unmap(_map);
+        _map = _file.map(0, _writtenSize);
+        _mapSize = _map ? _writtenSize : 0;
+    }
+    if (_map)
+        return reinterpret_cast<const char *>(_map) + offset;
+
+    // mapping is not available, fall back to a plain read
+    if (!_file.seek(offset))
+        return nullptr;
+    _readBuffer = _file.read(len);
+    if (_readBuffer.size() != len)
+        return nullptr;
+    return _readBuffer.constData();
+}
+
+HistoryFileView::HistoryFileView(const HistoryFile &file)
+    : _file(file._file.fileName()), _writtenSize(file._writtenSize),
+      _pending(file._pending), _map(nullptr) {
+    // opened here, on the thread which takes the snapshot, so the file cannot
+    // be gone by the time a worker thread reads the view
+    if (_writtenSize > 0 && _file.open(QIODevice::ReadOnly))
+        _map = _file.map(0, _writtenSize);
+}
+
+HistoryFileView::~HistoryFileView() {
+    if (_map)
+        _file.unmap(_map);
+}
+
+const char *HistoryFileView::get(qint64 offset, int len) {
+    if (offset >= _writtenSize)
+        return _pending.constData() + (offset - _writtenSize);
+
+    if (_map)
+        return reinterpret_cast<const char *>(_map) + offset;
+
+    if (!_file.isOpen() || !_file.seek(offset))
+        return nullptr;
+    _readBuffer = _file.read(len);
+    if (_readBuffer.size() != len)
+        return nullptr;
+    return _readBuffer.constData();
+}
+
+HistoryScrollFile::HistoryScrollFile()
+    : HistoryScroll(new HistoryTypeFile()), _lineCount(0), _lastLine(), _hasLastLine(false),
+      _reportedUsage(0) {
+    _reportedUsage = memoryUsage();
+    reportUsage();
+}
+
+HistoryScrollFile::~HistoryScrollFile() {
+}
+
+HistoryScrollFile::IndexRecord HistoryScrollFile::record(int lineNumber) {
+    if (_hasLastLine && lineNumber == _lineCount - 1)
+        return _lastLine;
+
+    // a record which cannot be read back reads as an empty line
+    IndexRecord record = {};
+    const char *data = _index.get(static_cast<qint64>(lineNumber) * sizeof(IndexRecord), sizeof(IndexRecord));
+    if (data)
+        memcpy(&record, data, sizeof(IndexRecord));
+    return record;
+}
+
+int HistoryScrollFile::getLines() {
+    return _lineCount;
+}
+
+int HistoryScrollFile::getLineLen(int lineNumber) {
+    if (lineNumber < 0 || lineNumber >= _lineCount)
+        return 0;
+    return record(lineNumber).cellCount;
+}
+
+bool HistoryScrollFile::isWrappedLine(int lineNumber) {
+    if (lineNumber < 0 || lineNumber >= _lineCount)
+        return false;
+    return record(lineNumber).wrapped;
+}
+
+void HistoryScrollFile::addCells(const Character a[], int count) {
+    if (_hasLastLine)
+        _index.add(reinterpret_cast<const char *>(&_lastLine), sizeof(IndexRecord));
+
+    _codec.encode(a, count, _encodeBuffer);
+    _lastLine.offset = _data.add(_encodeBuffer.data(), static_cast<int>(_encodeBuffer.size()));
+    _lastLine.length = static_cast<quint32>(_encodeBuffer.size());
+    _lastLine.cellCount = count;
+    _lastLine.wrapped = false;
+    _hasLastLine = true;
+    _lineCount++;
+
+    if (qAbs(memoryUsage() - _reportedUsage) >= USAGE_REPORT_STEP) {
+        _reportedUsage = memoryUsage();
+        reportUsage();
+    }
+}
+
+qint64 HistoryScrollFile::memoryUsage() const {
+    return _data.memoryUsage() + _index.memoryUsage() + _codec.memoryUsage()
+            + static_cast<qint64>(_encodeBuffer.capacity());
+}
+
+void HistoryScrollFile::addLine(bool previousWrapped) {
+    if (_hasLastLine)
+        _lastLine.wrapped = previousWrapped;
+}
+
+void HistoryScrollFile::getCells(int lineNumber, int startColumn, int count,
+                                 Character buffer[]) {
+    if (count == 0)
+        return;
+
+    if (lineNumber < 0 || lineNumber >= _lineCount) {
+        memset(static_cast<void *>(buffer), 0, count * sizeof(Character));
+        return;
+    }
+
+    const IndexRecord line = record(lineNumber);
+    const char *data = _data.get(line.offset, line.length);
+    if (!data || startColumn + count > static_cast<int>(line.cellCount)) {
+        std::fill_n(buffer, count, Character());
+        return;
+    }
+
+    _codec.decode(data, startColumn, count, buffer);
+}
+
+// A snapshot of a file backed history, which reads the files through views.
+class HistorySnapshotFile : public HistorySnapshot
+{
+public:
+    explicit HistorySnapshotFile(const HistoryScrollFile &scroll)
+        : _data(scroll._data), _index(scroll._index), _lineCount(scroll._lineCount),
+          _lastLine(scroll._lastLine), _hasLastLine(scroll._hasLastLine), _codec(scroll._codec) {
+    }
+
+    int getLines() override {
+        return _lineCount;
+    }
+
+    int getLineLen(int lineNumber) override {
+        if (lineNumber < 0 || lineNumber >= _lineCount)
+            return 0;
+        return record(lineNumber).cellCount;
+    }
+
+    bool isWrappedLine(int lineNumber) override {
+        if (lineNumber < 0 || lineNumber >= _lineCount)
+            return false;
+        return record(lineNumber).wrapped;
+    }
+
+    void getCells(int lineNumber, int startColumn, int count, Character buffer[]) override {
+        if (count == 0)
+            return;
+
+        if (lineNumber < 0 || lineNumber >= _lineCount) {
+            memset(static_cast<void *>(buffer), 0, count * sizeof(Character));
+            return;
+        }
+
+        const HistoryScrollFile::IndexRecord line = record(lineNumber);
+        const char *data = _data.get(line.offset, line.length);
+        if (!data || startColumn + count > static_cast<int>(line.cellCount)) {
+            std::fill_n(buffer, count, Character());
+            return;
+        }
+        _codec.decode(data, startColumn, count, buffer);
+    }
+
+private:
+    HistoryScrollFile::IndexRecord record(int lineNumber) {
+        if (_hasLastLine && lineNumber == _lineCount - 1)
+            return _lastLine;
+
+        HistoryScrollFile::IndexRecord record = {};
+        const char *data = _index.get(static_cast<qint64>(lineNumber) * sizeof(record), sizeof(record));
+        if (data)
+            memcpy(&record, data, sizeof(record));
+        return record;
+    }
+
+    HistoryFileView _data;
+    HistoryFileView _index;
+    int _lineCount;
+    HistoryScrollFile::IndexRecord _lastLine;
+    bool _hasLastLine;
+    HistoryLineCodec _codec;
+};
+
+HistorySnapshot *HistoryScrollFile::snapshot() {
+    return new HistorySnapshotFile(*this);
+}
+
 HistoryScrollNone::HistoryScrollNone() : HistoryScroll(new HistoryTypeNone()) {}
 HistoryScrollNone::~HistoryScrollNone() {}
 bool HistoryScrollNone::hasScroll() { return false; }
@@ -196,6 +1094,30 @@ void HistoryScrollNone::getCells(int, int, int, Character[]) {}
 void HistoryScrollNone::addCells(const Character[], int) {}
 void HistoryScrollNone::addLine(bool) {}
 
+// Copies the last maxLines lines of one history into another one.
+static void copyHistory(HistoryScroll *from, HistoryScroll *to, unsigned int maxLines) {
+    int lines = from->getLines();
+    int startLine = 0;
+    if (lines > (int)maxLines)
+        startLine = lines - maxLines;
+
+    Character line[LINE_SIZE];
+    for (int i = startLine; i < lines; i++) {
+        int size = from->getLineLen(i);
+        if (size > LINE_SIZE) {
+            Character *tmp_line = new Character[size];
+            from->getCells(i, 0, size, tmp_line);
+            to->addCells(tmp_line, size);
+            to->addLine(from->isWrappedLine(i));
+            delete[] tmp_line;
+        } else {
+            from->getCells(i, 0, size, line);
+            to->addCells(line, size);
+            to->addLine(from->isWrappedLine(i));
+        }
+    }
+}
+
 HistoryType::HistoryType() {}
 HistoryType::~HistoryType() {}
 HistoryTypeNone::HistoryTypeNone() {}
@@ -219,28 +1141,45 @@ HistoryScroll *HistoryTypeBuffer::scroll(HistoryScroll *old) const {
         }
 
         HistoryScroll *newScroll = new HistoryScrollBuffer(m_nbLines);
-        int lines = old->getLines();
-        int startLine = 0;
-        if (lines > (int)m_nbLines)
-            startLine = lines - m_nbLines;
-
-        Character line[LINE_SIZE];
-        for (int i = startLine; i < lines; i++) {
-            int size = old->getLineLen(i);
-            if (size > LINE_SIZE) {
-                Character *tmp_line = new Character[size];
-                old->getCells(i, 0, size, tmp_line);
-                newScroll->addCells(tmp_line, size);
-                newScroll->addLine(old->isWrappedLine(i));
-                delete[] tmp_line;
-            } else {
-                old->getCells(i, 0, size, line);
-                newScroll->addCells(line, size);
-                newScroll->addLine(old->isWrappedLine(i));
-            }
-        }
+        copyHistory(old, newScroll, m_nbLines);
         delete old;
         return newScroll;
     }
     return new HistoryScrollBuffer(m_nbLines);
 }
+
+HistoryTypeCompact::HistoryTypeCompact(unsigned int nbLines)
+    : m_nbLines(nbLines) {}
+bool HistoryTypeCompact::isEnabled() const { return true; }
+int HistoryTypeCompact::maximumLineCount() const { return m_nbLines; }
+HistoryScroll *HistoryTypeCompact::scroll(HistoryScroll *old) const {
+    if (old) {
+        HistoryScrollCompact *oldCompact = dynamic_cast<HistoryScrollCompact *>(old);
+        if (oldCompact) {
+            oldCompact->setMaxNbLines(m_nbLines);
+            return oldCompact;
+        }
+
+        HistoryScroll *newScroll = new HistoryScrollCompact(m_nbLines);
+        copyHistory(old, newScroll, m_nbLines);
+        delete old;
+        return newScroll;
+    }
+    return new HistoryScrollCompact(m_nbLines);
+}
+
+HistoryTypeFile::HistoryTypeFile() {}
+bool HistoryTypeFile::isEnabled() const { return true; }
+int HistoryTypeFile::maximumLineCount() const { return 0; }
+HistoryScroll *HistoryTypeFile::scroll(HistoryScroll *old) const {
+    if (old) {
+        if (dynamic_cast<HistoryScrollFile *>(old))
+            return old;
+
+        HistoryScroll *newScroll = new HistoryScrollFile();
+        copyHistory(old, newScroll, old->getLines());
+        delete old;
+        return newScroll;
+    }
+    return new HistoryScrollFile();
+}
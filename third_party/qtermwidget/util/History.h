@@ -25,8 +25,33 @@
 #include <QVector>
 #include <QTemporaryFile>
 
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
 #include "Character.h"
 
+/**
+ * A read-only copy of a history scroll at one point in time.
+ *
+ * Snapshots share as much data with their scroll as possible and can be read
+ * on another thread while the scroll keeps changing on the GUI thread.  A
+ * snapshot itself must only be used by one thread at a time.
+ */
+class HistorySnapshot
+{
+public:
+    virtual ~HistorySnapshot() {}
+
+    virtual int  getLines() = 0;
+    virtual int  getLineLen(int lineno) = 0;
+    virtual void getCells(int lineno, int colno, int count, Character res[]) = 0;
+    virtual bool isWrappedLine(int lineno) = 0;
+};
+
 //////////////////////////////////////////////////////////////////////
 // Abstract base class for file and buffer versions
 //////////////////////////////////////////////////////////////////////
@@ -58,6 +83,25 @@ public:
 
     virtual void addLine(bool previousWrapped=false) = 0;
 
+    // memory accounting, see HistoryMemoryBudget
+    virtual qint64 memoryUsage() const { return 0; }
+    void markViewed();
+    /**
+     * Drops the oldest lines to free memory, but keeps at least
+     * @p minimumLines.  Returns the number of lines dropped, 0 if the history
+     * cannot be trimmed.
+     */
+    virtual int trimOldestPage(int minimumLines) { Q_UNUSED(minimumLines); return 0; }
+    /**
+     * Sets the function which is called with the number of lines the budget
+     * has trimmed, so that the owner can adjust its line numbers.
+     */
+    void setTrimmedHandler(std::function<void(int)> handler) { m_trimmedHandler = std::move(handler); }
+
+    // returns a snapshot of the current lines, the caller takes ownership.
+    // The default implementation copies all lines.
+    virtual HistorySnapshot *snapshot();
+
     //
     // FIXME:  Passing around constant references to HistoryType instances
     // is very unsafe, because those references will no longer
@@ -66,7 +110,15 @@ public:
     const HistoryType& getType() const { return *m_histType; }
 
 protected:
+    // reports memoryUsage() to the budget
+    void reportUsage();
+
     HistoryType* m_histType;
+
+private:
+    friend class HistoryMemoryBudget;
+
+    std::function<void(int)> m_trimmedHandler;
 };
 
 class HistoryScrollBuffer : public HistoryScroll
@@ -89,6 +141,10 @@ public:
     void setMaxNbLines(unsigned int nbLines);
     unsigned int maxNbLines() const { return _maxLineCount; }
 
+    qint64 memoryUsage() const override;
+
+    HistorySnapshot *snapshot() override;
+
 private:
     int bufferIndex(int lineNumber) const;
 
@@ -97,6 +153,320 @@ private:
     int _maxLineCount;
     int _usedLines;
     int _head;
+    qint64 _cellCount;
+    qint64 _reportedUsage;
+};
+
+/**
+ * Encodes history lines compactly and decodes them again.
+ *
+ * A line is encoded as the character values in (extended) UTF-8 followed by
+ * run-length encoded attribute spans which refer to a table of the distinct
+ * formats seen so far.  The table is capped at MAX_FORMATS entries; once it
+ * is full, new formats are stored inline in the span instead, so output with
+ * many distinct (e.g. true color) formats cannot grow the table, and the
+ * snapshots which copy it, without bound.  Trailing default cells are not
+ * stored.  An encoded line is self-delimiting and only valid together with
+ * the codec which produced it, since the format table is kept here.
+ */
+class HistoryLineCodec
+{
+public:
+    /** Replaces the contents of @p out with the encoding of @p count cells. */
+    void encode(const Character a[], int count, std::vector<char> &out);
+    /**
+     * Decodes @p count cells starting at @p startColumn of the line encoded
+     * at @p data into @p buffer.
+     */
+    void decode(const char *data, int startColumn, int count, Character buffer[]) const;
+
+    /** Returns the number of bytes used by the format table. */
+    qint64 memoryUsage() const;
+
+private:
+    struct Format {
+        CharacterColor fgColor;
+        CharacterColor bgColor;
+        quint8 rendition;
+
+        bool operator==(const Format &other) const {
+            return fgColor == other.fgColor && bgColor == other.bgColor && rendition == other.rendition;
+        }
+    };
+    friend size_t qHash(const Format &format, size_t seed);
+
+    static const int MAX_FORMATS = 1024;
+
+    // Returns the span reference of the format of @p c: its table index + 1,
+    // or 0 if the format has to be stored inline because the table is full.
+    quint32 formatReference(const Character &c);
+
+    QVector<Format> _formats;
+    QHash<Format, quint32> _formatIndex;
+};
+
+/**
+ * A history which keeps lines encoded by HistoryLineCodec instead of one
+ * QVector<Character> per line.
+ *
+ * The encoded lines are packed into large arena pages which are released as
+ * a whole once all of their lines have been dropped from the history.
+ * getCells() decodes the requested line on demand.
+ *
+ * Only the newest pages are kept as they are.  Older pages are compressed on
+ * a worker thread and inflated again when somebody scrolls or searches into
+ * them; a few recently inflated pages are cached.
+ */
+class HistoryScrollCompact : public HistoryScroll
+{
+public:
+    HistoryScrollCompact(unsigned int maxNbLines = 1000);
+    ~HistoryScrollCompact() override;
+
+    int  getLines() override;
+    int  getLineLen(int lineno) override;
+    void getCells(int lineno, int colno, int count, Character res[]) override;
+    bool isWrappedLine(int lineno) override;
+
+    void addCells(const Character a[], int count) override;
+    void addLine(bool previousWrapped=false) override;
+
+    void setMaxNbLines(unsigned int nbLines);
+    unsigned int maxNbLines() const { return _maxLineCount; }
+
+    /** Returns the number of bytes allocated for pages, line index and formats. */
+    qint64 memoryUsage() const override;
+    /**
+     * Returns the size of the compressed pages and stores the number of bytes
+     * they held before in @p uncompressedBytes, e.g. for a benchmark.
+     */
+    qint64 compressedBytes(qint64 *uncompressedBytes) const;
+
+    /** Shares the pages with the snapshot, only the line index is copied. */
+    HistorySnapshot *snapshot() override;
+
+    /**
+     * Drops the oldest lines until the oldest page has been released or only
+     * @p minimumLines are left.
+     */
+    int trimOldestPage(int minimumLines) override;
+
+private:
+    friend class HistorySnapshotCompact;
+
+    struct CompressJob {
+        std::shared_ptr<char[]> data;
+        int size;
+        QByteArray result;
+        std::atomic<bool> done{false};
+    };
+
+    struct Page {
+        std::shared_ptr<char[]> data;  // null once the page is compressed
+        QByteArray compressed;
+        std::shared_ptr<CompressJob> job;
+        int capacity;
+        int used;
+        int lineCount;  // lines in this page which are still in the history
+    };
+
+    struct InflatedPage {
+        quint32 page;
+        QByteArray data;
+    };
+
+    struct Line {
+        quint32 page;   // absolute page number, see _firstPage
+        quint32 offset;
+        quint32 cellCount : 31;
+        quint32 wrapped : 1;
+    };
+
+    char *allocate(int size, quint32 *page, quint32 *offset);
+    void dropOldestLine();
+    void compressPage(Page &page);
+    bool collectCompressedPages();
+    const char *pageData(quint32 page);
+
+    std::deque<Page> _pages;
+    quint32 _firstPage;
+    std::deque<Line> _lines;
+    int _maxLineCount;
+
+    int _runningJobs;
+    QVector<InflatedPage> _inflatedPages;  // most recently used first
+
+    HistoryLineCodec _codec;
+    std::vector<char> _encodeBuffer;
+};
+
+/**
+ * A memory budget which is shared by all histories of the process.
+ *
+ * Every history is registered and reports its usage when it changes notably,
+ * e.g. when a compact history allocates, compresses or releases a page.  Once
+ * the total is over the budget, the oldest lines of the histories which were
+ * viewed least recently are dropped page by page from the event loop, but no
+ * history is trimmed below minimumLines().  Histories which cannot be trimmed
+ * (buffer, file and none) only count towards the total.  Only used from the
+ * GUI thread.
+ */
+class HistoryMemoryBudget
+{
+public:
+    static HistoryMemoryBudget *instance();
+
+    /** Sets the budget in bytes, 0 means unlimited. */
+    void setBudget(qint64 bytes);
+    qint64 budget() const { return _budget; }
+
+    void setMinimumLines(int lines) { _minimumLines = lines; }
+    int minimumLines() const { return _minimumLines; }
+
+    /** Returns the number of bytes used by all histories together. */
+    qint64 usage() const { return _usage; }
+
+private:
+    friend class HistoryScroll;
+
+    struct Entry {
+        qint64 usage;
+        quint64 lastViewed;
+    };
+
+    void add(HistoryScroll *scroll);
+    void remove(HistoryScroll *scroll);
+    void touch(HistoryScroll *scroll);
+    void update(HistoryScroll *scroll, qint64 usage);
+    void scheduleEnforce();
+    void enforce();
+
+    QHash<HistoryScroll *, Entry> _scrolls;
+    // the histories ordered by Entry::lastViewed, least recently viewed first
+    std::map<quint64, HistoryScroll *> _leastRecentlyViewed;
+    qint64 _budget = 0;
+    int _minimumLines = 1000;
+    qint64 _usage = 0;
+    quint64 _clock = 0;
+    bool _enforcing = false;
+    bool _enforcePending = false;
+};
+
+/**
+ * An append-only file which is read back through a memory mapping.
+ *
+ * Appended data is collected in memory and written out in large blocks; the
+ * file is (re)mapped when a read reaches past the mapped part.  The file is a
+ * temporary file which is removed again when the object is destroyed.
+ */
+class HistoryFile
+{
+public:
+    HistoryFile();
+    ~HistoryFile();
+
+    /** Appends @p len bytes and returns the offset at which they were stored. */
+    qint64 add(const char *data, int len);
+    /**
+     * Returns a pointer to @p len bytes at @p offset.  The pointer is only
+     * valid until the next call to add() or get().  Returns nullptr if the
+     * bytes cannot be read back from the file.
+     */
+    const char *get(qint64 offset, int len);
+
+    qint64 size() const { return _writtenSize + _pending.size(); }
+    bool isValid() const { return _valid; }
+    /** Returns the number of bytes kept in memory. */
+    qint64 memoryUsage() const { return _pending.capacity() + _readBuffer.capacity(); }
+
+private:
+    friend class HistoryFileView;
+
+    void flush();
+
+    QTemporaryFile _file;
+    bool _valid;
+    qint64 _writtenSize;
+    QByteArray _pending;  // the hot tail which is not in the file yet
+    uchar *_map;
+    qint64 _mapSize;
+    QByteArray _readBuffer;  // used when the file cannot be mapped
+};
+
+/**
+ * A read-only view of the data which was added to a HistoryFile so far.
+ *
+ * The view opens the file on its own when it is created and keeps a copy of
+ * the pending tail, so it can be read on another thread while the file keeps
+ * growing.
+ */
+class HistoryFileView
+{
+public:
+    explicit HistoryFileView(const HistoryFile &file);
+    ~HistoryFileView();
+
+    /** See HistoryFile::get(). */
+    const char *get(qint64 offset, int len);
+
+private:
+    QFile _file;
+    qint64 _writtenSize;
+    QByteArray _pending;
+    uchar *_map;
+    QByteArray _readBuffer;
+};
+
+/**
+ * An unlimited history which spills encoded lines to a temporary file.
+ *
+ * Lines are encoded by HistoryLineCodec and appended to a data file; a second
+ * file holds one fixed size index record per line.  Both are read back
+ * through mmap, so only the recently written tail and the format table are
+ * kept in memory.
+ */
+class HistoryScrollFile : public HistoryScroll
+{
+public:
+    HistoryScrollFile();
+    ~HistoryScrollFile() override;
+
+    int  getLines() override;
+    int  getLineLen(int lineno) override;
+    void getCells(int lineno, int colno, int count, Character res[]) override;
+    bool isWrappedLine(int lineno) override;
+
+    void addCells(const Character a[], int count) override;
+    void addLine(bool previousWrapped=false) override;
+
+    /** Returns the number of bytes of the file tails and formats kept in memory. */
+    qint64 memoryUsage() const override;
+
+    /** Reads the files through HistoryFileView, only the tails are copied. */
+    HistorySnapshot *snapshot() override;
+
+private:
+    friend class HistorySnapshotFile;
+
+    struct IndexRecord {
+        qint64 offset;
+        quint32 length;
+        quint32 cellCount : 31;
+        quint32 wrapped : 1;
+    };
+
+    IndexRecord record(int lineno);
+
+    HistoryFile _data;
+    HistoryFile _index;
+    int _lineCount;
+    // the newest line is kept here until addLine() has set its wrap flag
+    IndexRecord _lastLine;
+    bool _hasLastLine;
+    qint64 _reportedUsage;
+
+    HistoryLineCodec _codec;
+    std::vector<char> _encodeBuffer;
 };
 
 class HistoryScrollNone : public HistoryScroll
@@ -192,4 +562,31 @@ protected:
   unsigned int m_nbLines;
 };
 
+class HistoryTypeCompact : public HistoryType
+{
+    friend class HistoryScrollCompact;
+
+public:
+    HistoryTypeCompact(unsigned int nbLines);
+
+    bool isEnabled() const override;
+    int maximumLineCount() const override;
+
+    HistoryScroll* scroll(HistoryScroll *) const override;
+
+protected:
+  unsigned int m_nbLines;
+};
+
+class HistoryTypeFile : public HistoryType
+{
+public:
+    HistoryTypeFile();
+
+    bool isEnabled() const override;
+    int maximumLineCount() const override;
+
+    HistoryScroll* scroll(HistoryScroll *) const override;
+};
+
 #endif // HISTORY_H
@@ -0,0 +1,264 @@
+#include "HistoryIndex.h"
+
+#include <cstring>
+
+#include "CharWidth.h"
+
+HistoryIndex::HistoryIndex() {
+    reset();
+}
+
+void HistoryIndex::reset() {
+    _blocks.clear();
+    _addedLines = 0;
+    _indexedFrom = 0;
+    _tailLength = 0;
+    _previousWrapped = false;
+}
+
+uint HistoryIndex::trigramBit(char32_t a, char32_t b, char32_t c) {
+    quint32 h = a * 0x9e3779b1u;
+    h ^= b + 0x7f4a7c15u + (h << 6) + (h >> 2);
+    h ^= c + 0x7f4a7c15u + (h << 6) + (h >> 2);
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    return h & (FILTER_BITS - 1);
+}
+
+void HistoryIndex::addLine(const Character *cells, int count, bool wrapped) {
+    const qint64 line = _addedLines++;
+
+    // only start a new block at the beginning of a logical line
+    if (_blocks.empty() || (!_previousWrapped && _blocks.back().lineCount >= BLOCK_LINES)) {
+        Block block;
+        memset(block.bits, 0, sizeof(block.bits));
+        block.firstLine = line;
+        block.lineCount = 0;
+        block.opaque = false;
+        _blocks.push_back(block);
+        if (_blocks.size() == 1)
+            _indexedFrom = line;
+    }
+
+    Block &block = _blocks.back();
+    block.lineCount++;
+
+    // the last two characters seen, continued from the previous line if
+    // that one was wrapped
+    if (!_previousWrapped)
+        _tailLength = 0;
+
+    // walk the cells the same way PlainTextDecoder does
+    for (int i = 0; i < count;) {
+        const Character &cell = cells[i];
+        if (cell.rendition & RE_EXTENDED_CHAR) {
+            block.opaque = true;
+            _tailLength = 0;
+            ++i;
+            continue;
+        }
+
+        const char32_t c = QChar::toCaseFolded(static_cast<char32_t>(cell.character));
+        if (_tailLength == 2) {
+            const uint bit = trigramBit(_tail[0], _tail[1], c);
+            block.bits[bit >> 6] |= quint64(1) << (bit & 63);
+        } else {
+            _tailLength++;
+        }
+        _tail[0] = _tail[1];
+        _tail[1] = c;
+
+        i += qMax(1, CharWidth::unicode_width(cell.character));
+    }
+    _previousWrapped = wrapped;
+
+    // cap the memory used by the index, older lines are simply not covered
+    while (_blocks.size() > 1 && _addedLines - _blocks.front().firstLine > MAX_LINES) {
+        _blocks.pop_front();
+        _indexedFrom = _blocks.front().firstLine;
+    }
+}
+
+void HistoryIndex::setHistoryLines(int lines) {
+    const qint64 firstLine = _addedLines - lines;
+    while (!_blocks.empty() && _blocks.front().firstLine + _blocks.front().lineCount <= firstLine) {
+        _blocks.pop_front();
+        _indexedFrom = _blocks.empty() ? _addedLines : _blocks.front().firstLine;
+    }
+}
+
+bool HistoryIndex::candidateLines(const QStringList &literals, int historyLines,
+                                  QVector<QPair<int, int>> *ranges) const {
+    QVector<uint> bits;
+    for (const QString &literal : literals) {
+        const QList<uint> chars = literal.toUcs4();
+        for (int i = 2; i < chars.size(); i++) {
+            bits.append(trigramBit(QChar::toCaseFolded(static_cast<char32_t>(chars[i - 2])),
+                                   QChar::toCaseFolded(static_cast<char32_t>(chars[i - 1])),
+                                   QChar::toCaseFolded(static_cast<char32_t>(chars[i]))));
+        }
+    }
+    if (bits.isEmpty())
+        return false;
+
+    ranges->clear();
+    const qint64 firstLine = _addedLines - historyLines;
+    auto addRange = [&](qint64 first, qint64 last) {
+        first = qMax(first, firstLine);
+        last = qMin(last, _addedLines - 1);
+        if (first > last)
+            return;
+        const int from = static_cast<int>(first - firstLine);
+        const int to = static_cast<int>(last - firstLine);
+        if (!ranges->isEmpty() && ranges->last().second + 1 >= from)
+            ranges->last().second = qMax(ranges->last().second, to);
+        else
+            ranges->append(qMakePair(from, to));
+    };
+
+    // lines the index does not know about have to be searched
+    addRange(firstLine, (_blocks.empty() ? _addedLines : _indexedFrom) - 1);
+
+    for (const Block &block : _blocks) {
+        bool candidate = true;
+        if (!block.opaque) {
+            for (uint bit : std::as_const(bits)) {
+                if (!(block.bits[bit >> 6] & (quint64(1) << (bit & 63)))) {
+                    candidate = false;
+                    break;
+                }
+            }
+        }
+        if (candidate)
+            addRange(block.firstLine, block.firstLine + block.lineCount - 1);
+    }
+    return true;
+}
+
+qint64 HistoryIndex::memoryUsage() const {
+    return static_cast<qint64>(_blocks.size()) * sizeof(Block);
+}
+
+QStringList HistoryIndex::requiredLiterals(const QRegularExpression &regExp) {
+    if (regExp.patternOptions() & (QRegularExpression::DotMatchesEverythingOption
+                                   | QRegularExpression::ExtendedPatternSyntaxOption))
+        return {};
+
+    const QString pattern = regExp.pattern();
+    // inline options and lookarounds could change the meaning of everything
+    if (pattern.contains(QLatin1String("(?")))
+        return {};
+
+    // escapes which are known not to match a line break
+    static const QString singleLineEscapes = QStringLiteral("dwbBAzZGh");
+
+    QStringList literals;
+    QString current;
+    auto flush = [&]() {
+        if (current.size() >= 3)
+            literals << current;
+        current.clear();
+    };
+
+    int depth = 0;
+    for (int i = 0; i < pattern.size(); i++) {
+        const QChar c = pattern.at(i);
+        switch (c.unicode()) {
+        case '\\': {
+            if (++i >= pattern.size())
+                return {};
+            const QChar next = pattern.at(i);
+            if (next == QLatin1Char('Q')) {
+                const int end = pattern.indexOf(QLatin1String("\\E"), i + 1);
+                const QString quoted = pattern.mid(i + 1, end < 0 ? -1 : end - i - 1);
+                if (quoted.contains(QLatin1Char('\n')))
+                    return {};
+                if (depth == 0)
+                    current += quoted;
+                i = end < 0 ? pattern.size() : end + 1;
+            } else if (next.unicode() < 0x80 && next.isLetterOrNumber()) {
+                if (!singleLineEscapes.contains(next))
+                    return {};
+                flush();
+            } else if (next == QLatin1Char('\n')) {
+                return {};
+            } else if (depth == 0) {
+                current += next;
+            }
+            break;
+        }
+        case '[': {
+            flush();
+            if (i + 1 < pattern.size() && pattern.at(i + 1) == QLatin1Char('^'))
+                return {};
+            // skip the class, a ']' right after '[' is a literal
+            int j = i + 1;
+            if (j < pattern.size() && pattern.at(j) == QLatin1Char(']'))
+                j++;
+            for (; j < pattern.size() && pattern.at(j) != QLatin1Char(']'); j++) {
+                if (pattern.at(j) == QLatin1Char('\\') && j + 1 < pattern.size()) {
+                    const QChar next = pattern.at(++j);
+                    if (next.unicode() < 0x80 && next.isLetterOrNumber() && !singleLineEscapes.contains(next))
+                        return {};
+                } else if (pattern.at(j) == QLatin1Char('[') && j + 1 < pattern.size()
+                           && (pattern.at(j + 1) == QLatin1Char(':') || pattern.at(j + 1) == QLatin1Char('=')
+                               || pattern.at(j + 1) == QLatin1Char('.'))) {
+                    // POSIX [:class:], [=equivalence=] and [.collating.] items
+                    // contain a ']' of their own
+                    const QString close = QString(pattern.at(j + 1)) + QLatin1Char(']');
+                    const int end = pattern.indexOf(close, j + 2);
+                    if (end < 0)
+                        return {};
+                    // like \s, these classes match a line break
+                    const QStringView item = QStringView(pattern).mid(j, end + 2 - j);
+                    if (item == QLatin1String("[:space:]") || item == QLatin1String("[:cntrl:]"))
+                        return {};
+                    j = end + 1;
+                }
+            }
+            if (j >= pattern.size())
+                return {};
+            i = j;
+            break;
+        }
+        case '|':
+            if (depth == 0)
+                return {};
+            break;
+        case '(':
+            flush();
+            depth++;
+            break;
+        case ')':
+            depth = qMax(0, depth - 1);
+            break;
+        case '*':
+        case '?':
+        case '{':
+            // the previous atom is optional
+            if (!current.isEmpty())
+                current.chop(1);
+            flush();
+            if (c == QLatin1Char('{')) {
+                const int end = pattern.indexOf(QLatin1Char('}'), i);
+                i = end < 0 ? pattern.size() : end;
+            }
+            break;
+        case '+':
+        case '.':
+        case '^':
+        case '$':
+            flush();
+            break;
+        case '\n':
+            return {};
+        default:
+            if (depth == 0)
+                current += c;
+            break;
+        }
+    }
+    flush();
+    return literals;
+}
@@ -0,0 +1,91 @@
+#ifndef HISTORYINDEX_H
+#define HISTORYINDEX_H
+
+#include <QPair>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QVector>
+
+#include <deque>
+
+#include "Character.h"
+
+/**
+ * A trigram index over the lines of a history scroll.
+ *
+ * Lines are grouped into blocks of about BLOCK_LINES lines and every block
+ * keeps a small bloom filter of the case folded trigrams which occur in it.
+ * A block only ends after a line which is not wrapped, so a logical line and
+ * all of its trigrams always belong to a single block.  A search for text
+ * containing a set of literals then only has to look at the blocks whose
+ * filter contains all trigrams of those literals.
+ *
+ * The index counts lines from the first line ever added, so it keeps working
+ * while the history drops its oldest lines.  It uses about 8 bytes per line
+ * and never covers more than MAX_LINES lines; older lines are reported as
+ * candidates unconditionally.
+ */
+class HistoryIndex
+{
+public:
+    HistoryIndex();
+
+    /** Forgets all lines. */
+    void reset();
+
+    /**
+     * Adds the next line which entered the history.  @p wrapped is true if
+     * the line continues in the next one.
+     */
+    void addLine(const Character *cells, int count, bool wrapped);
+
+    /** Drops the blocks of lines which are no longer in the history. */
+    void setHistoryLines(int lines);
+
+    /**
+     * Computes the ranges of history lines [first, last] which may contain
+     * a logical line with all of @p literals, in ascending order.  The
+     * history currently holds @p historyLines lines.  Returns false if the
+     * index cannot narrow down the search, e.g. because no literal is long
+     * enough.
+     */
+    bool candidateLines(const QStringList &literals, int historyLines,
+                        QVector<QPair<int, int>> *ranges) const;
+
+    /** Returns the number of bytes used by the index. */
+    qint64 memoryUsage() const;
+
+    /**
+     * Returns literal strings which every match of @p regExp has to contain
+     * within a single logical line, or an empty list if there are none or
+     * the expression might match across line breaks.
+     */
+    static QStringList requiredLiterals(const QRegularExpression &regExp);
+
+    static const int BLOCK_LINES = 64;
+    static const int MAX_LINES = 1024 * 1024;
+
+private:
+    static const int FILTER_BITS = 4096;
+
+    struct Block {
+        quint64 bits[FILTER_BITS / 64];
+        qint64 firstLine;  // absolute number of the first line
+        int lineCount;
+        // the block contains cells the index cannot represent (extended characters)
+        bool opaque;
+    };
+
+    static uint trigramBit(char32_t a, char32_t b, char32_t c);
+
+    std::deque<Block> _blocks;
+    qint64 _addedLines;   // lines added since the last reset
+    qint64 _indexedFrom;  // absolute number of the first line covered by _blocks
+
+    // the last characters of the line added last, _tail[1] is the latest
+    char32_t _tail[2];
+    int _tailLength;
+    bool _previousWrapped;
+};
+
+#endif // HISTORYINDEX_H
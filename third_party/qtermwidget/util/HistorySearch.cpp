@@ -18,131 +18,226 @@
 */
 #include <QApplication>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QRegularExpressionMatch>
 #include <QTextStream>
+#include <QThreadPool>
+
+#include <algorithm>
 
 #include "Emulation.h"
+#include "HistoryIndex.h"
 #include "HistorySearch.h"
 #include "TerminalCharacterDecoder.h"
 
+// We read the history in blocks of at most this many lines so that we do not
+// use unhealthy amounts of memory
+static const int SEARCH_BLOCK_LINES = 10000;
+// Progress is reported at most this often (in ms) while no matches are found
+static const int PROGRESS_INTERVAL = 100;
+
 HistorySearch::HistorySearch(EmulationPtr emulation,
                              const QRegularExpression &regExp, bool forwards,
                              int startColumn, int startLine, QObject *parent)
     : QObject(parent), m_emulation(emulation), m_regExp(regExp),
-      m_forwards(forwards), m_startColumn(startColumn), m_startLine(startLine) {
+      m_forwards(forwards), m_startColumn(startColumn), m_startLine(startLine),
+      m_literals(HistoryIndex::requiredLiterals(regExp)) {
 }
 
 HistorySearch::~HistorySearch() {
+    // the worker uses this object until it is done
+    m_cancelled.store(true);
+    if (m_started)
+        m_done.acquire();
 }
 
 void HistorySearch::search() {
-    bool found = false;
+    if (m_regExp.pattern().isEmpty() || !m_emulation) {
+        deleteLater();
+        return;
+    }
 
-    if (!m_regExp.pattern().isEmpty()) {
-        if (m_forwards) {
-        found =
-            search(m_startColumn, m_startLine, -1, m_emulation->lineCount()) ||
-            search(0, 0, m_startColumn, m_startLine);
-        } else {
-            found = search(0, 0, m_startColumn, m_startLine) ||
-                search(m_startColumn, m_startLine, -1, m_emulation->lineCount());
+    // the snapshot and the candidate lines have to be taken together, before
+    // any new output arrives
+    m_snapshot = m_emulation->snapshot();
+    if (m_literals.isEmpty() || !m_emulation->findCandidateLines(m_literals, &m_candidateRanges)) {
+        m_candidateRanges.clear();
+        m_candidateRanges.append(qMakePair(0, m_snapshot.getLines() - 1));
+    }
+
+    m_started = true;
+    QThreadPool::globalInstance()->start([this]() {
+        run();
+        m_done.release();
+    });
+}
+
+void HistorySearch::cancel() {
+    m_cancelled.store(true);
+    if (!m_started)
+        deleteLater();
+}
+
+void HistorySearch::run() {
+    const int lineCount = m_snapshot.getLines();
+    if (lineCount > 0) {
+        const int startLine = qBound(0, m_startLine, lineCount - 1);
+        const Segment after = {m_startColumn, startLine, -1, lineCount - 1};
+        const Segment before = {0, 0, m_startColumn, startLine};
+
+        for (const QPair<int, int> &range : std::as_const(m_candidateRanges)) {
+            m_linesToSearch += qMax(0, qMin(range.second, after.endLine) - qMax(range.first, after.startLine) + 1);
+            m_linesToSearch += qMax(0, qMin(range.second, before.endLine) - qMax(range.first, before.startLine) + 1);
         }
 
-        if (found) {
-            emit matchFound(m_foundStartColumn, m_foundStartLine, m_foundEndColumn,
-                        m_foundEndLine);
+        m_progressTimer.start();
+        if (m_forwards) {
+            searchSegment(after);
+            searchSegment(before);
         } else {
-            emit noMatchFound();
+            searchSegment(before);
+            searchSegment(after);
         }
     }
 
-    deleteLater();
+    QMetaObject::invokeMethod(this, [this]() { finish(); }, Qt::QueuedConnection);
 }
 
-bool HistorySearch::search(int startColumn, int startLine, int endColumn,
-                           int endLine) {
-    int linesRead = 0;
-    int linesToRead = endLine - startLine + 1;
-
-    // We read process history from (and including) startLine to (and including)
-    // endLine in blocks of at most 10K lines so that we do not use unhealthy
-    // amounts of memory
-    int blockSize;
-    while ((blockSize = qMin(10000, linesToRead - linesRead)) > 0) {
-        QString string;
-        QTextStream searchStream(&string);
-        PlainTextDecoder decoder;
-        decoder.begin(&searchStream);
-        decoder.setRecordLinePositions(true);
-
-        // Calculate lines to read and read them
-        int blockStartLine = m_forwards ? startLine + linesRead
-                                        : endLine - linesRead - blockSize + 1;
-        int chunkEndLine = blockStartLine + blockSize - 1;
-        m_emulation->writeToStream(&decoder, blockStartLine, chunkEndLine);
-
-        // We search between startColumn in the first line of the string and
-        // endColumn in the last line of the string. First we calculate the position
-        // (in the string) of endColumn in the last line of the string
-        int endPosition;
-
-        // The String that Emulator.writeToStream produces has a newline at the end,
-        // and so ends with an empty line - we ignore that.
-        int numberOfLinesInString = decoder.linePositions().size() - 1;
-        if (numberOfLinesInString > 0 && endColumn > -1) {
-            endPosition =
-                decoder.linePositions().at(numberOfLinesInString - 1) + endColumn;
-        } else {
-            endPosition = string.size();
-        }
+bool HistorySearch::stopped() const {
+    return m_cancelled.load(std::memory_order_relaxed) || m_matchCount >= MAX_MATCHES;
+}
 
-        // So now we can log for m_regExp in the string between startColumn and
-        // endPosition
-        int matchStart;
-        QRegularExpressionMatch match;
+void HistorySearch::searchSegment(const Segment &segment) {
+    for (int i = 0; i < m_candidateRanges.size() && !stopped(); i++) {
+        const QPair<int, int> &range = m_candidateRanges.at(m_forwards ? i : m_candidateRanges.size() - 1 - i);
+        const int first = qMax(range.first, segment.startLine);
+        const int last = qMin(range.second, segment.endLine);
+
+        // blocks end on logical line boundaries so that matches in wrapped
+        // lines are not cut apart
         if (m_forwards) {
-            matchStart = string.indexOf(m_regExp, startColumn, &match);
-        if (matchStart >= endPosition)
-            matchStart = -1;
+            for (int blockStart = first; blockStart <= last && !stopped();) {
+                int blockEnd = qMin(blockStart + SEARCH_BLOCK_LINES - 1, last);
+                while (blockEnd < last && m_snapshot.isWrappedLine(blockEnd))
+                    blockEnd++;
+                searchBlock(segment, blockStart, blockEnd);
+                blockStart = blockEnd + 1;
+            }
         } else {
-            matchStart = string.lastIndexOf(m_regExp, endPosition - 1, &match);
-            if (matchStart < startColumn)
-                matchStart = -1;
+            for (int blockEnd = last; blockEnd >= first && !stopped();) {
+                int blockStart = qMax(blockEnd - SEARCH_BLOCK_LINES + 1, first);
+                while (blockStart > first && m_snapshot.isWrappedLine(blockStart - 1))
+                    blockStart--;
+                searchBlock(segment, blockStart, blockEnd);
+                blockEnd = blockStart - 1;
+            }
         }
+    }
+}
 
-        if (matchStart > -1) {
-            int matchEnd = matchStart + match.capturedLength() - 1;
-            // qDebug() << "Found in string from" << matchStart << "to" << matchEnd;
-
-            // Translate startPos and endPos to startColum, startLine, endColumn and
-            // endLine in history.
-            int startLineNumberInString =
-                findLineNumberInString(decoder.linePositions(), matchStart);
-            m_foundStartColumn =
-                matchStart - decoder.linePositions().at(startLineNumberInString);
-            m_foundStartLine = startLineNumberInString + startLine + linesRead;
-
-            int endLineNumberInString =
-                findLineNumberInString(decoder.linePositions(), matchEnd);
-            m_foundEndColumn =
-                matchEnd - decoder.linePositions().at(endLineNumberInString);
-            m_foundEndLine = endLineNumberInString + startLine + linesRead;
-
-            return true;
-        }
+void HistorySearch::searchBlock(const Segment &segment, int firstLine, int lastLine) {
+    QString string;
+    QTextStream searchStream(&string);
+    PlainTextDecoder decoder;
+    decoder.begin(&searchStream);
+    decoder.setRecordLinePositions(true);
+
+    QVector<Character> cells;
+    for (int line = firstLine; line <= lastLine; line++) {
+        if (m_cancelled.load(std::memory_order_relaxed))
+            return;
+
+        const int length = m_snapshot.getLineLen(line);
+        const bool wrapped = m_snapshot.isWrappedLine(line);
+        cells.resize(length + 1);
+        m_snapshot.getCells(line, 0, length, cells.data());
+
+        int count = length;
+        if (!wrapped)
+            cells[count++] = '\n';
+        decoder.decodeLine(cells.constData(), count, wrapped ? LINE_WRAPPED : 0);
+    }
+    decoder.end();
+
+    // We search between startColumn in the first line of the segment and
+    // endColumn in its last line
+    const QList<int> linePositions = decoder.linePositions();
+    const int startPosition = firstLine == segment.startLine ? segment.startColumn : 0;
+    int endPosition = string.size();
+    if (lastLine == segment.endLine && segment.endColumn > -1 && !linePositions.isEmpty())
+        endPosition = linePositions.last() + segment.endColumn;
+
+    QVector<Match> matches;
+    QRegularExpressionMatchIterator iterator = m_regExp.globalMatch(string, startPosition);
+    while (iterator.hasNext() && m_matchCount + matches.size() < MAX_MATCHES) {
+        const QRegularExpressionMatch match = iterator.next();
+        const int matchStart = match.capturedStart();
+        if (matchStart >= endPosition)
+            break;
+        if (match.capturedLength() == 0)
+            continue;
+        const int matchEnd = matchStart + match.capturedLength() - 1;
+
+        // Translate the positions to columns and lines in the history
+        const int startLineNumberInString = findLineNumberInString(linePositions, matchStart);
+        const int endLineNumberInString = findLineNumberInString(linePositions, matchEnd);
+        matches.append({matchStart - linePositions.at(startLineNumberInString),
+                        firstLine + startLineNumberInString,
+                        matchEnd - linePositions.at(endLineNumberInString),
+                        firstLine + endLineNumberInString});
+    }
+    if (!m_forwards)
+        std::reverse(matches.begin(), matches.end());
+
+    m_linesSearched += lastLine - firstLine + 1;
+    m_matchCount += matches.size();
 
-        linesRead += blockSize;
+    if (!matches.isEmpty() || m_progressTimer.elapsed() - m_lastProgress >= PROGRESS_INTERVAL) {
+        m_lastProgress = m_progressTimer.elapsed();
+        deliver(matches, m_linesSearched);
     }
+}
+
+void HistorySearch::deliver(QVector<Match> matches, int linesSearched) {
+    QMetaObject::invokeMethod(this, [this, matches, linesSearched]() mutable {
+        if (m_cancelled.load())
+            return;
+
+        // the lines refer to the snapshot, map them to the screen as it is now
+        const int dropped = m_emulation ? m_emulation->droppedLinesSince(m_snapshot) : 0;
+        if (dropped > 0) {
+            for (Match &match : matches) {
+                match.startLine -= dropped;
+                match.endLine -= dropped;
+            }
+            matches.erase(std::remove_if(matches.begin(), matches.end(),
+                                         [](const Match &match) { return match.startLine < 0; }),
+                          matches.end());
+        }
 
-    return false;
+        if (!matches.isEmpty()) {
+            if (!m_firstMatchEmitted) {
+                m_firstMatchEmitted = true;
+                const Match &first = matches.first();
+                emit matchFound(first.startColumn, first.startLine, first.endColumn, first.endLine);
+            }
+            emit matchesFound(matches);
+        }
+        emit progress(linesSearched, m_linesToSearch);
+    }, Qt::QueuedConnection);
 }
 
-int HistorySearch::findLineNumberInString(QList<int> linePositions,
-                                          int position) {
-    int lineNum = 0;
-    while (lineNum + 1 < linePositions.size() &&
-            linePositions[lineNum + 1] <= position)
-        lineNum++;
+void HistorySearch::finish() {
+    if (!m_cancelled.load()) {
+        if (!m_firstMatchEmitted)
+            emit noMatchFound();
+        emit finished(m_matchCount);
+    }
+    deleteLater();
+}
 
-    return lineNum;
+int HistorySearch::findLineNumberInString(const QList<int> &linePositions, int position) {
+    // the last line which starts at or before position
+    auto it = std::upper_bound(linePositions.begin(), linePositions.end(), position);
+    return qMax(0, static_cast<int>(it - linePositions.begin()) - 1);
 }
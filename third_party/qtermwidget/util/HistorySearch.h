@@ -19,46 +19,115 @@
 #ifndef HISTOTYSEARCH_H
 #define	HISTOTYSEARCH_H
 
+#include <QElapsedTimer>
 #include <QObject>
 #include <QPointer>
 #include <QMap>
 #include <QRegularExpression>
+#include <QSemaphore>
+#include <QVector>
+
+#include <atomic>
 
 #include <ScreenWindow.h>
 
 #include "Emulation.h"
+#include "Screen.h"
 #include "TerminalCharacterDecoder.h"
 
 typedef QPointer<Emulation> EmulationPtr;
 
+/**
+ * Searches the output history for a regular expression.
+ *
+ * The search runs on a worker thread against a snapshot of the history which
+ * is taken by search(), so the terminal keeps rendering and receiving output
+ * meanwhile.  Starting at the given position it walks through all lines in
+ * the search direction, wrapping around at the end, and streams the matches
+ * back in that order.  Line numbers in the signals always refer to the screen
+ * at the time they are emitted.
+ *
+ * The object deletes itself once the search has finished or was cancelled.
+ */
 class HistorySearch : public QObject
 {
     Q_OBJECT
 
 public:
+    struct Match {
+        int startColumn;
+        int startLine;
+        int endColumn;
+        int endLine;
+    };
+
     explicit HistorySearch(EmulationPtr emulation, const QRegularExpression& regExp, bool forwards,
                            int startColumn, int startLine, QObject* parent);
     ~HistorySearch() override;
+
+    /** Takes the snapshot and starts the search on the thread pool. */
     void search();
+    /**
+     * Stops the search as soon as possible.  No further signals are emitted
+     * after this returns.
+     */
+    void cancel();
+
+    /** The search stops after this many matches. */
+    static const int MAX_MATCHES = 100000;
 
 signals:
+    /** The first match in search order. */
     void matchFound(int startColumn, int startLine, int endColumn, int endLine);
+    /** The next batch of matches in search order, starting with the first one. */
+    void matchesFound(const QVector<HistorySearch::Match> &matches);
+    void progress(int linesSearched, int lineCount);
     void noMatchFound();
+    void finished(int matchCount);
 
 private:
-    bool search(int startColumn, int startLine, int endColumn, int endLine);
-    int findLineNumberInString(QList<int> linePositions, int position);
+    struct Segment {
+        int startColumn;
+        int startLine;
+        int endColumn;  // -1 for the end of the line
+        int endLine;
+    };
+
+    void run();
+    bool stopped() const;
+    void searchSegment(const Segment &segment);
+    void searchBlock(const Segment &segment, int firstLine, int lastLine);
+    void deliver(QVector<Match> matches, int linesSearched);
+    void finish();
+    int findLineNumberInString(const QList<int> &linePositions, int position);
 
     EmulationPtr m_emulation;
     QRegularExpression m_regExp;
     bool m_forwards = false;
     int m_startColumn = 0;
     int m_startLine = 0;
+    // literals every match contains, used to skip lines with the history index
+    QStringList m_literals;
 
-    int m_foundStartColumn = 0;
-    int m_foundStartLine = 0;
-    int m_foundEndColumn = 0;
-    int m_foundEndLine = 0;
+    // taken by search(), only read by the worker afterwards
+    ScreenSnapshot m_snapshot;
+    QVector<QPair<int, int>> m_candidateRanges;
+
+    // worker state
+    int m_linesToSearch = 0;
+    int m_linesSearched = 0;
+    int m_matchCount = 0;
+    QElapsedTimer m_progressTimer;
+    qint64 m_lastProgress = 0;
+
+    std::atomic<bool> m_cancelled{false};
+    bool m_started = false;
+    QSemaphore m_done;
+
+    // GUI thread state
+    bool m_firstMatchEmitted = false;
 };
 
+Q_DECLARE_TYPEINFO(HistorySearch::Match, Q_PRIMITIVE_TYPE);
+
 #endif	/* HISTOTYSEARCH_H */
@@ -0,0 +1,90 @@
+#include "RingBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+RingBuffer::RingBuffer(int capacity)
+    : _buffer(nullptr)
+    , _capacity(1)
+    , _mask(0) {
+    // round up to a power of two so that positions can be masked instead of
+    // wrapped with a modulo
+    while (_capacity < static_cast<size_t>(qMax(capacity, 1)))
+        _capacity <<= 1;
+    _mask = _capacity - 1;
+    _buffer = new char[_capacity];
+}
+
+RingBuffer::~RingBuffer() {
+    delete[] _buffer;
+}
+
+int RingBuffer::write(const char *data, int len) {
+    if (len <= 0)
+        return 0;
+
+    const size_t head = _head.load(std::memory_order_relaxed);
+    const size_t tail = _tail.load(std::memory_order_acquire);
+    const size_t count = std::min(static_cast<size_t>(len), _capacity - (head - tail));
+    if (count == 0)
+        return 0;
+
+    const size_t offset = head & _mask;
+    const size_t first = std::min(count, _capacity - offset);
+    memcpy(_buffer + offset, data, first);
+    if (count > first)
+        memcpy(_buffer, data + first, count - first);
+
+    _head.store(head + count, std::memory_order_release);
+    return static_cast<int>(count);
+}
+
+bool RingBuffer::waitForSpace(int msecs) {
+    QMutexLocker locker(&_waitMutex);
+    _producerWaiting.store(true);
+    // re-check under the lock, the consumer may have drained us in between
+    if (size() < capacity()) {
+        _producerWaiting.store(false);
+        return true;
+    }
+    _spaceAvailable.wait(&_waitMutex, msecs);
+    _producerWaiting.store(false);
+    return size() < capacity();
+}
+
+int RingBuffer::peek(const char **data, int maxLen) const {
+    const size_t tail = _tail.load(std::memory_order_relaxed);
+    const size_t head = _head.load(std::memory_order_acquire);
+    const size_t offset = tail & _mask;
+    const size_t count = std::min({head - tail, _capacity - offset, static_cast<size_t>(qMax(maxLen, 0))});
+
+    *data = _buffer + offset;
+    return static_cast<int>(count);
+}
+
+void RingBuffer::consume(int len) {
+    if (len <= 0)
+        return;
+    _tail.store(_tail.load(std::memory_order_relaxed) + len);
+    wakeProducer();
+}
+
+void RingBuffer::clear() {
+    _tail.store(_head.load(std::memory_order_acquire));
+    wakeProducer();
+}
+
+int RingBuffer::size() const {
+    // sequentially consistent so that waitForSpace() and wakeProducer()
+    // cannot both miss each other's update
+    const size_t tail = _tail.load();
+    const size_t head = _head.load();
+    return static_cast<int>(head - tail);
+}
+
+void RingBuffer::wakeProducer() {
+    if (_producerWaiting.load()) {
+        QMutexLocker locker(&_waitMutex);
+        _spaceAvailable.wakeAll();
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * A bounded single-producer / single-consumer byte ring.
+ *
+ * The producer (a session I/O thread) calls write() and, when the ring is
+ * full, waitForSpace().  The consumer (the GUI thread) calls peek() to get a
+ * contiguous readable region and consume() once it has processed it.
+ * Neither side takes a lock on the fast path; the mutex is only used to park
+ * a producer which has run out of space.
+ */
+class RingBuffer
+{
+public:
+    /** Constructs a ring which can hold at least @p capacity bytes. */
+    explicit RingBuffer(int capacity);
+    ~RingBuffer();
+
+    RingBuffer(const RingBuffer &) = delete;
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
+    /**
+     * Copies up to @p len bytes into the ring.  Producer side only.
+     * Returns the number of bytes actually written, which is less than
+     * @p len when the ring is full.
+     */
+    int write(const char *data, int len);
+
+    /**
+     * Blocks the producer until the consumer has freed some space or
+     * @p msecs have elapsed.  Returns true if there is space available.
+     */
+    bool waitForSpace(int msecs);
+
+    /**
+     * Sets @p data to the start of the oldest unread bytes and returns the
+     * number of bytes which can be read contiguously from there (at most
+     * @p maxLen).  Consumer side only.
+     */
+    int peek(const char **data, int maxLen) const;
+
+    /** Marks @p len bytes returned by peek() as processed. Consumer side only. */
+    void consume(int len);
+
+    /** Drops everything which is currently queued. Consumer side only. */
+    void clear();
+
+    /** Returns the number of bytes currently queued. */
+    int size() const;
+    int capacity() const { return static_cast<int>(_capacity); }
+    bool isEmpty() const { return size() == 0; }
+
+private:
+    void wakeProducer();
+
+    char *_buffer;
+    size_t _capacity;
+    size_t _mask;
+
+    // _head is only written by the producer, _tail only by the consumer.
+    alignas(64) std::atomic<size_t> _head{0};
+    alignas(64) std::atomic<size_t> _tail{0};
+
+    std::atomic<bool> _producerWaiting{false};
+    QMutex _waitMutex;
+    QWaitCondition _spaceAvailable;
+};
+
+#endif // RINGBUFFER_H
@@ -27,6 +27,7 @@
 SearchBar::SearchBar(QWidget *parent) : QWidget(parent) {
     widget.setupUi(this);
     setAutoFillBackground(true); // make it always opaque, especially inside translucent windows
+    widget.statusLabel->hide();
  
     connect(widget.closeButton, &QToolButton::clicked, this, &SearchBar::hide);
     connect(widget.searchTextEdit, &QLineEdit::textChanged, this, &SearchBar::searchCriteriaChanged);
@@ -83,6 +84,7 @@ void SearchBar::show() {
 
 void SearchBar::hide() {
     QWidget::hide();
+    emit closed();
     if (QWidget *p = parentWidget())
     {
         p->setFocus(Qt::OtherFocusReason); // give the focus to the parent widget on hiding
@@ -95,6 +97,39 @@ void SearchBar::noMatchFound() {
     widget.searchTextEdit->setPalette(palette);
 }
 
+void SearchBar::setSearchProgress(int linesSearched, int lineCount) {
+    m_progress = lineCount > 0 ? static_cast<int>(qint64(linesSearched) * 100 / lineCount) : 100;
+    updateStatus();
+}
+
+void SearchBar::clearSearchProgress() {
+    m_progress = -1;
+    updateStatus();
+}
+
+void SearchBar::setMatchCount(int index, int count) {
+    m_matchIndex = index;
+    m_matchCount = count;
+    updateStatus();
+}
+
+void SearchBar::updateStatus() {
+    QString text;
+    if (m_matchCount > 0) {
+        // the search stops after MAX_MATCHES
+        const QString count = m_matchCount >= HistorySearch::MAX_MATCHES
+                                      ? QString::number(m_matchCount) + QLatin1Char('+')
+                                      : QString::number(m_matchCount);
+        text = tr("%1 of %2").arg(m_matchIndex + 1).arg(count);
+    }
+    if (m_progress >= 0)
+        text = text.isEmpty() ? tr("Searching... %1%").arg(m_progress)
+                              : tr("%1 (%2%)").arg(text).arg(m_progress);
+
+    widget.statusLabel->setText(text);
+    widget.statusLabel->setVisible(!text.isEmpty());
+}
+
 void SearchBar::keyReleaseEvent(QKeyEvent* keyEvent) {
     if (keyEvent->key() == Qt::Key_Return || keyEvent->key() == Qt::Key_Enter) {
         if (keyEvent->modifiers() == Qt::ShiftModifier) {
@@ -41,12 +41,18 @@ public:
 public slots:
     void noMatchFound();
     void hide();
+    /** Shows how far the running search has got. */
+    void setSearchProgress(int linesSearched, int lineCount);
+    void clearSearchProgress();
+    /** Shows "N of M" for match @p index of @p count matches, -1 hides it. */
+    void setMatchCount(int index, int count);
 
 signals:
     void searchCriteriaChanged();
     void highlightMatchesChanged(bool highlightMatches);
     void findNext();
     void findPrevious();
+    void closed();
 
 protected:
     void keyReleaseEvent(QKeyEvent* keyEvent) override;
@@ -54,11 +60,17 @@ protected:
 private slots:
     void clearBackgroundColor();
 
+private:
+    void updateStatus();
+
 private:
     Ui::SearchBar widget;
     QAction *m_matchCaseMenuEntry;
     QAction *m_useRegularExpressionMenuEntry;
     QAction *m_highlightMatchesMenuEntry;
+    int m_progress = -1;
+    int m_matchIndex = -1;
+    int m_matchCount = -1;
 };
 
 #endif	/* _SEARCHBAR_H */